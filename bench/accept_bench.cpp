@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// accepts/sec of a server which closes every connection right away, one
+//  acceptor on the base loop against one SO_REUSEPORT acceptor per io loop
+//  usage: accept_bench [seconds] [io_loops] [client_threads]
+
+namespace
+{
+const uint16_t kPort = 9879;
+
+// connects, waits for the server to close, closes
+void client(atomic<bool> &stop, atomic<long> &failed)
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (!stop.load(memory_order_relaxed))
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0)
+        {
+            failed.fetch_add(1, memory_order_relaxed);
+            ::close(fd);
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+        char c;
+        while (::read(fd, &c, 1) > 0)
+        {
+        }
+        ::close(fd);
+    }
+}
+
+void run(const char *name, TcpServer::Option option, double seconds, int io_loops, int clients)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "accept", option);
+    server.set_thread_num(io_loops);
+    atomic<long> accepted(0);
+    server.set_connection_callback([&accepted] (const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            accepted.fetch_add(1, memory_order_relaxed);
+            conn->force_close();
+        }
+    });
+    server.start();
+
+    atomic<bool> stop(false);
+    atomic<long> failed(0);
+    vector<thread> threads;
+    for (int i = 0; i < clients; ++i)
+    {
+        threads.emplace_back([&] { client(stop, failed); });
+    }
+
+    auto start = chrono::steady_clock::now();
+    loop.run_after(chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds)),
+                   [&] {
+        stop = true;
+        loop.quit();
+    });
+    loop.loop();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long total = accepted.load();
+
+    // let the clients see their last close
+    loop.run_after(chrono::milliseconds(200), [&loop] { loop.quit(); });
+    loop.loop();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    printf("%-22s %9.0f accepts/s  (%ld accepted, %ld connect failures)\n",
+           name, total / elapsed, total, failed.load());
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int io_loops = argc > 2 ? atoi(argv[2]) : 4;
+    int clients = argc > 3 ? atoi(argv[3]) : 8;
+
+    printf("io loops: %d, client threads: %d, cpus: %u\n", io_loops, clients, thread::hardware_concurrency());
+    run("single acceptor", TcpServer::kNoReusePort, seconds, io_loops, clients);
+    run("acceptor per loop", TcpServer::kReusePort, seconds, io_loops, clients);
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/connectiongroup.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// a publisher thread sends messages to subscribers spread over io
+//  loops, over unix socket pairs. one send per subscriber, a
+//  run_in_loop each, against one ConnectionGroup::broadcast per message.
+//  reports the wall and cpu time of a message reaching every subscriber.
+//  when the fd limit is too low for a count, as many subscribers as fit
+//  are used and the times are projected
+//  usage: broadcast_bench [loops] [messages] [subscribers...]
+
+namespace
+{
+double process_cpu_ms()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+         + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+size_t max_subscribers()
+{
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    // two fds per pair, some left for the loops
+    return (limit.rlim_cur - 64) / 2;
+}
+
+template <typename F>
+void in_loop(EventLoop *loop, F f)
+{
+    promise<void> done;
+    loop->queue_in_loop([&] {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// the peers hold every message, drained between two rounds
+void drain(const vector<int> &peers)
+{
+    char sink[4096];
+    for (int fd : peers)
+    {
+        while (::read(fd, sink, sizeof sink) > 0)
+        {
+        }
+    }
+}
+
+void run(const vector<EventLoop *> &loops, size_t wanted, int messages)
+{
+    size_t count = min(wanted, max_subscribers());
+    vector<TcpConnectionPtr> conns(count);
+    vector<int> peers(count);
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        in_loop(loops[i], [&] {
+            for (size_t j = i; j < count; j += loops.size())
+            {
+                int sv[2];
+                if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+                {
+                    abort();
+                }
+                conns[j] = make_shared<TcpConnection>(loops[i], "sub", sv[0], InetAddress(), InetAddress());
+                conns[j]->set_connection_callback([] (const TcpConnectionPtr &) {});
+                conns[j]->connect_established();
+                peers[j] = sv[1];
+            }
+        });
+    }
+    ConnectionGroup group;
+    for (auto &conn : conns)
+    {
+        group.add(conn);
+    }
+
+    auto settle = [&] {
+        for (auto loop : loops)
+        {
+            in_loop(loop, [] {});
+        }
+    };
+    auto payload = make_shared<const string>(64, 'q');
+    auto measure = [&] (auto publish) {
+        settle();
+        drain(peers);
+        double cpu_start = process_cpu_ms();
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < messages; ++i)
+        {
+            publish();
+        }
+        settle();
+        double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        double cpu = process_cpu_ms() - cpu_start;
+        drain(peers);
+        // per message to all wanted subscribers
+        double scale = static_cast<double>(wanted) / count / messages;
+        return make_pair(wall * scale, cpu * scale);
+    };
+
+    auto per_conn = measure([&] {
+        for (auto &conn : conns)
+        {
+            conn->send(payload);
+        }
+    });
+    auto batched = measure([&] {
+        group.broadcast(payload);
+    });
+    printf("%7zu subscribers%s  per connection %8.2f ms wall %8.2f ms cpu"
+           "  group %8.2f ms wall %8.2f ms cpu  %5.1fx\n",
+           wanted, count < wanted ? " (projected)" : "            ",
+           per_conn.first, per_conn.second, batched.first, batched.second,
+           per_conn.first / batched.first);
+    fflush(stdout);
+
+    for (auto &conn : conns)
+    {
+        group.remove(conn);
+        in_loop(conn->get_loop(), [&] {
+            conn->connect_destroyed();
+        });
+    }
+    conns.clear();
+    for (int fd : peers)
+    {
+        ::close(fd);
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int num_loops = argc > 1 ? atoi(argv[1]) : 4;
+    int messages = argc > 2 ? atoi(argv[2]) : 20;
+    vector<size_t> counts;
+    for (int i = 3; i < argc; ++i)
+    {
+        counts.push_back(atol(argv[i]));
+    }
+    if (counts.empty())
+    {
+        counts = {1000, 10000, 100000};
+    }
+
+    vector<unique_ptr<EventLoopThread>> threads;
+    vector<EventLoop *> loops;
+    for (int i = 0; i < num_loops; ++i)
+    {
+        threads.push_back(make_unique<EventLoopThread>());
+        loops.push_back(threads.back()->start_loop());
+    }
+
+    printf("%d io loops, %d messages of 64 B, time per message\n", num_loops, messages);
+    for (size_t count : counts)
+    {
+        run(loops, count, messages);
+    }
+
+    return 0;
+}
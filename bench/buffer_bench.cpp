@@ -0,0 +1,100 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/buffer.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// one large message read off a socket into a Buffer and held until it is
+//  complete, then written to another socket. contiguous against
+//  segmented buffers, reports the time and the peak buffer capacity
+//  usage: buffer_bench [MiB] [slab_KiB]
+
+namespace
+{
+void run(const char *name, size_t total, size_t slab_size)
+{
+    int in[2];
+    int out[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, in) < 0 || ::socketpair(AF_UNIX, SOCK_STREAM, 0, out) < 0)
+    {
+        abort();
+    }
+
+    thread writer([fd = in[0], total] {
+        vector<char> chunk(256 * 1024, 'x');
+        for (size_t sent = 0; sent < total; )
+        {
+            ssize_t n = ::write(fd, chunk.data(), min(chunk.size(), total - sent));
+            if (n <= 0)
+            {
+                abort();
+            }
+            sent += n;
+        }
+    });
+    thread sink([fd = out[1], total] {
+        vector<char> chunk(256 * 1024);
+        for (size_t received = 0; received < total; )
+        {
+            ssize_t n = ::read(fd, chunk.data(), chunk.size());
+            if (n <= 0)
+            {
+                abort();
+            }
+            received += n;
+        }
+    });
+
+    auto start = chrono::steady_clock::now();
+    Buffer buf;
+    buf.set_slab_size(slab_size);
+    size_t peak = 0;
+    int saved_errno = 0;
+    while (buf.readable_bytes() < total)
+    {
+        if (buf.read_fd(in[1], &saved_errno) <= 0)
+        {
+            abort();
+        }
+        peak = max(peak, buf.internal_capacity());
+    }
+    double read_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    while (buf.readable_bytes() > 0)
+    {
+        if (buf.write_fd(out[0], &saved_errno) <= 0)
+        {
+            abort();
+        }
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    writer.join();
+    sink.join();
+
+    printf("%-22s read %8.1f ms  total %8.1f ms  %8.1f MiB/s  peak capacity %8.1f MiB\n",
+           name, read_ms, ms, total / (1024.0 * 1024.0) / (ms / 1e3), peak / (1024.0 * 1024.0));
+    ::close(in[0]);
+    ::close(in[1]);
+    ::close(out[0]);
+    ::close(out[1]);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t mib = argc > 1 ? atoi(argv[1]) : 256;
+    size_t slab_kib = argc > 2 ? atoi(argv[2]) : 64;
+
+    printf("message: %zu MiB, slab: %zu KiB\n", mib, slab_kib);
+    run("contiguous", mib << 20, 0);
+    run("segmented", mib << 20, slab_kib << 10);
+
+    return 0;
+}
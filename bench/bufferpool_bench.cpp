@@ -0,0 +1,79 @@
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/bufferpool.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// connection churn at the Buffer level: every round is one short-lived
+//  connection whose input buffer takes a request and whose output buffer
+//  takes a response, then both are released as in connect_destroyed.
+//  the loop's BufferPool against plain heap storage (max_cached_bytes 0),
+//  reports the time per connection and the minor page faults
+//  usage: bufferpool_bench [connections] [request_bytes] [response_bytes]
+
+namespace
+{
+long minor_faults()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+void run(const char *name, size_t max_cached_bytes, int connections,
+         size_t request_size, size_t response_size)
+{
+    EventLoop loop;
+    loop.buffer_pool().set_max_cached_bytes(max_cached_bytes);
+    string request(request_size, 'q');
+    string response(response_size, 'r');
+    size_t checksum = 0;
+
+    long faults = minor_faults();
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < connections; ++i)
+    {
+        Buffer input;
+        Buffer output;
+        input.append(request);
+        output.append(response);
+        checksum += input.readable_bytes() + output.peek()[response_size - 1];
+        input.retrieve_all();
+        output.retrieve_all();
+        input.release();
+        output.release();
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    faults = minor_faults() - faults;
+
+    auto stats = loop.buffer_pool().stats();
+    printf("%-10s %10.1f ns/conn  %8.2f faults/conn  %10lu hits  %10lu misses\n",
+           name, ns / connections, static_cast<double>(faults) / connections,
+           static_cast<unsigned long>(stats.hits), static_cast<unsigned long>(stats.misses));
+    if (checksum == 0)
+    {
+        abort();
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? atoi(argv[1]) : 200000;
+    size_t request_size = argc > 2 ? atoi(argv[2]) : 512;
+    size_t response_size = argc > 3 ? atoi(argv[3]) : 256 * 1024;
+
+    printf("connections: %d, request: %zu bytes, response: %zu bytes\n",
+           connections, request_size, response_size);
+    run("pooled", BufferPool::kDefaultMaxCachedBytes, connections, request_size, response_size);
+    run("heap", 0, connections, request_size, response_size);
+
+    return 0;
+}
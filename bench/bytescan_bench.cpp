@@ -0,0 +1,139 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "../icarus/bytescan.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// scans a whole buffer the way a parser of pipelined requests does,
+//  one find after the other, for buffer sizes and delimiter densities.
+//  std::search, the old findCRLF, against every scan level, in GB/s
+//  usage: bytescan_bench [milliseconds_per_case]
+
+namespace
+{
+const char kCrlf[] = "\r\n";
+const char kHeaderEnd[] = "\r\n\r\n";
+
+// filler with a line break every gap bytes, an empty line every 8th,
+//  gap 0 has none at all
+string make_text(size_t size, size_t gap)
+{
+    string text(size, 'x');
+    for (size_t i = 0; i < size; ++i)
+    {
+        text[i] = static_cast<char>('a' + i % 23);
+    }
+    size_t line = 0;
+    for (size_t at = gap; gap > 0 && at + 4 <= size; at += gap, ++line)
+    {
+        memcpy(&text[at - 2], line % 8 == 7 ? kHeaderEnd : kCrlf, line % 8 == 7 ? 4 : 2);
+    }
+    return text;
+}
+
+template <typename Find>
+size_t count_all(const string &text, Find find, size_t step)
+{
+    size_t count = 0;
+    const char *end = text.data() + text.size();
+    for (const char *p = find(text.data(), end); p; p = find(p + step, end))
+    {
+        ++count;
+    }
+    return count;
+}
+
+// GB/s of running scan over text for about ms milliseconds
+template <typename Scan>
+double throughput(const string &text, int ms, Scan scan)
+{
+    size_t rounds = 0;
+    size_t sink = 0;
+    auto start = chrono::steady_clock::now();
+    auto until = start + chrono::milliseconds(ms);
+    do
+    {
+        for (int i = 0; i < 16; ++i, ++rounds)
+        {
+            sink += scan();
+        }
+    } while (chrono::steady_clock::now() < until);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 1)
+    {
+        printf(" ");
+    }
+    return text.size() * rounds / seconds / 1e9;
+}
+
+void run(size_t size, size_t gap, int ms)
+{
+    string text = make_text(size, gap);
+    vector<size_t> offsets;
+    offsets.reserve(size);
+
+    printf("%8zu B  gap %5zu ", size, gap);
+    double baseline = throughput(text, ms, [&] {
+        return count_all(text, [] (const char *begin, const char *end) -> const char * {
+            const char *p = search(begin, end, kCrlf, kCrlf + 2);
+            return p == end ? nullptr : p;
+        }, 2);
+    });
+    printf(" search %6.2f |", baseline);
+
+    for (auto level : {scan::Level::kScalar, scan::Level::kSse2, scan::Level::kAvx2})
+    {
+        if (level > scan::best_level())
+        {
+            continue;
+        }
+        scan::set_level(level);
+        double crlf = throughput(text, ms, [&] {
+            return count_all(text, scan::find_crlf, 2);
+        });
+        double eol = throughput(text, ms, [&] {
+            return count_all(text, [] (const char *begin, const char *end) {
+                return scan::find_byte(begin, end, '\n');
+            }, 1);
+        });
+        double header_end = throughput(text, ms, [&] {
+            return count_all(text, [] (const char *begin, const char *end) {
+                return scan::find_delimiter(begin, end, kHeaderEnd, 4);
+            }, 4);
+        });
+        double all_of = throughput(text, ms, [&] {
+            offsets.clear();
+            return scan::find_all_of(text.data(), text.data() + text.size(), "\r\n:", 3, 0, &offsets);
+        });
+        printf(" %s crlf %6.2f eol %6.2f hdr %6.2f set %6.2f |",
+               scan::level_name(level), crlf, eol, header_end, all_of);
+    }
+    printf("\n");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int ms = argc > 1 ? atoi(argv[1]) : 100;
+
+    printf("GB/s, best level: %s\n", scan::level_name(scan::best_level()));
+    for (size_t size : {64, 1024, 16 * 1024, 256 * 1024})
+    {
+        for (size_t gap : {0, 1024, 128, 32})
+        {
+            if (gap < size)
+            {
+                run(size, gap, ms);
+            }
+        }
+    }
+
+    return 0;
+}
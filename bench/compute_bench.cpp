@@ -0,0 +1,179 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/computepool.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// mixed io/cpu load: one io loop serves light requests ("L\n", answered at
+//  once) and heavy ones ("H\n", a cpu burn before the answer). the heavy
+//  work runs inline in the loop or offloaded to a ComputePool. reports
+//  light round trip percentiles and the heavy throughput
+//  usage: compute_bench [heavy_us] [seconds] [pool_threads]
+
+namespace
+{
+const uint16_t kPort = 9881;
+
+uint64_t burn(int us)
+{
+    uint64_t x = 88172645463325252ull;
+    auto until = chrono::steady_clock::now() + chrono::microseconds(us);
+    while (chrono::steady_clock::now() < until)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+    }
+    return x;
+}
+
+int connect_blocking()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        abort();
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+bool read_line(int fd)
+{
+    char c;
+    while (::read(fd, &c, 1) == 1)
+    {
+        if (c == '\n')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void run(const char *name, int heavy_us, int seconds, int pool_threads)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "compute");
+    server.set_thread_num(1);
+    unique_ptr<ComputePool> pool;
+    if (pool_threads > 0)
+    {
+        pool = make_unique<ComputePool>(pool_threads);
+    }
+
+    server.set_message_callback([&] (const TcpConnectionPtr &conn, Buffer *buf) {
+        while (const char *eol = buf->findEOL())
+        {
+            bool heavy = buf->peek()[0] == 'H';
+            buf->retrieve_until(eol + 1);
+            if (!heavy)
+            {
+                conn->send("l\n");
+            }
+            else if (!pool)
+            {
+                burn(heavy_us);
+                conn->send("h\n");
+            }
+            else
+            {
+                pool->submit(conn, [heavy_us, conn] () -> ComputePool::Completion {
+                    burn(heavy_us);
+                    return [conn] { conn->send("h\n"); };
+                });
+            }
+        }
+    });
+    server.start();
+
+    atomic<bool> done(false);
+    atomic<long> heavy_done(0);
+    vector<double> rtts;
+
+    // keeps a few heavy requests in flight
+    thread heavy([&] {
+        int fd = connect_blocking();
+        const int kWindow = 4;
+        for (int i = 0; i < kWindow; ++i)
+        {
+            ::write(fd, "H\n", 2);
+        }
+        while (!done && read_line(fd))
+        {
+            ++heavy_done;
+            ::write(fd, "H\n", 2);
+        }
+        ::close(fd);
+    });
+
+    thread light([&] {
+        int fd = connect_blocking();
+        auto end = chrono::steady_clock::now() + chrono::seconds(seconds);
+        while (chrono::steady_clock::now() < end)
+        {
+            auto start = chrono::steady_clock::now();
+            ::write(fd, "L\n", 2);
+            if (!read_line(fd))
+            {
+                break;
+            }
+            rtts.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+        done = true;
+        ::close(fd);
+        loop.queue_in_loop([&loop] { loop.quit(); });
+    });
+
+    loop.loop();
+    light.join();
+    heavy.join();
+
+    sort(rtts.begin(), rtts.end());
+    auto pct = [&rtts] (double p) {
+        return rtts.empty() ? 0.0 : rtts[static_cast<size_t>(p * (rtts.size() - 1))];
+    };
+    printf("%-10s light: %7zu reqs  p50 %8.1f us  p99 %8.1f us  max %9.1f us   heavy: %7.0f reqs/s\n",
+           name, rtts.size(), pct(0.5), pct(0.99), pct(1.0),
+           static_cast<double>(heavy_done.load()) / seconds);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int heavy_us = argc > 1 ? atoi(argv[1]) : 500;
+    int seconds = argc > 2 ? atoi(argv[2]) : 2;
+    int pool_threads = argc > 3 ? atoi(argv[3]) : 2;
+
+    printf("heavy request: %d us of cpu, %d s per run\n", heavy_us, seconds);
+    run("inline", heavy_us, seconds, 0);
+    run("offloaded", heavy_us, seconds, pool_threads);
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../icarus/task.hpp"
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpclient.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// small messages bounced over several connections through the echo of
+//  test/echo_server.cpp against the one of test/coroutine_echo_server.cpp,
+//  with and without the frame pool. then the bare cost of spawning a
+//  short task that awaits a child task
+//  usage: coroutine_bench [connections] [seconds] [message_size]
+
+namespace
+{
+const uint16_t kPort = 9883;
+
+enum class Mode
+{
+    kCallback,
+    kCoroutine,
+    kCoroutineNoPool
+};
+
+Task<> echo(TcpConnectionPtr conn)
+{
+    while (true)
+    {
+        size_t readable = co_await conn->read_some();
+        if (readable == 0)
+        {
+            break;
+        }
+        co_await conn->write(conn->input_buffer());
+    }
+}
+
+void run(const char *name, Mode mode, int connections, int seconds, size_t size)
+{
+    EventLoopThread server_thread;
+    EventLoop *server_loop = server_thread.start_loop();
+    unique_ptr<TcpServer> server;
+    atomic<bool> listening(false);
+    server_loop->run_in_loop([&] {
+        if (mode == Mode::kCoroutineNoPool)
+        {
+            server_loop->frame_pool().set_capacity(0);
+        }
+        server = make_unique<TcpServer>(server_loop, InetAddress(kPort, true), "echo");
+        if (mode == Mode::kCallback)
+        {
+            server->set_message_callback([] (const TcpConnectionPtr &conn, Buffer *buf) {
+                conn->send(buf);
+            });
+        }
+        else
+        {
+            server->set_connection_callback([] (const TcpConnectionPtr &conn) {
+                if (conn->connected())
+                {
+                    spawn(echo(conn));
+                }
+            });
+        }
+        server->start();
+        listening = true;
+    });
+    while (!listening)
+    {
+        this_thread::yield();
+    }
+
+    EventLoop loop;
+    string message(size, 'x');
+    long messages = 0;
+    bool counting = false;
+    vector<unique_ptr<TcpClient>> clients;
+    for (int i = 0; i < connections; ++i)
+    {
+        auto client = make_unique<TcpClient>(&loop, InetAddress(kPort, true), "client");
+        client->set_connection_callback([&message] (const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                conn->send(message);
+            }
+        });
+        client->set_message_callback([&, size] (const TcpConnectionPtr &conn, Buffer *buf) {
+            while (buf->readable_bytes() >= size)
+            {
+                buf->retrieve(size);
+                messages += counting;
+                conn->send(message);
+            }
+        });
+        client->connect();
+        clients.push_back(move(client));
+    }
+
+    loop.run_after(chrono::milliseconds(200), [&] { counting = true; });
+    loop.run_after(chrono::milliseconds(200) + chrono::seconds(seconds), [&] { loop.quit(); });
+    loop.loop();
+    printf("%-20s %12.0f msgs/s\n", name, static_cast<double>(messages) / seconds);
+
+    clients.clear();
+    loop.run_after(chrono::milliseconds(50), [&] { loop.quit(); });
+    loop.loop();
+    server_loop->run_in_loop([&] { server.reset(); });
+    while (server)
+    {
+        this_thread::yield();
+    }
+}
+
+Task<int> child(int i)
+{
+    co_return i;
+}
+
+Task<> parent(int i, long *total)
+{
+    int value = co_await child(i);
+    *total += value;
+}
+
+void spawn_cost(const char *name, size_t capacity, int rounds)
+{
+    EventLoop loop;
+    loop.frame_pool().set_capacity(capacity);
+    long total = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        spawn(parent(i, &total));
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    auto stats = loop.frame_pool().stats();
+    printf("%-20s %12.1f ns/spawn  %10lu pool hits  %10lu misses\n", name, ns / rounds,
+           static_cast<unsigned long>(stats.hits), static_cast<unsigned long>(stats.misses));
+    if (total < 0)
+    {
+        abort();
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 2;
+    size_t size = argc > 3 ? atoi(argv[3]) : 64;
+
+    printf("connections: %d, message size: %zu\n", connections, size);
+    run("callback echo", Mode::kCallback, connections, seconds, size);
+    run("coroutine echo", Mode::kCoroutine, connections, seconds, size);
+    run("coroutine, no pool", Mode::kCoroutineNoPool, connections, seconds, size);
+
+    const int kRounds = 1000000;
+    spawn_cost("spawn, pooled", FramePool::kDefaultCapacity, kRounds);
+    spawn_cost("spawn, heap", 0, kRounds);
+
+    return 0;
+}
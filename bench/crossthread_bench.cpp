@@ -0,0 +1,159 @@
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// a producer thread builds messages and sends them to a connection
+//  owned by a loop in another thread, a third thread reads the peer of
+//  the unix socket pair. the message is copied with send(string_view),
+//  or moved with send(std::string&&) and send(Buffer&&). reports the
+//  throughput and the cpu time of the whole process per GiB
+//  usage: crossthread_bench [mib_per_case] [message_bytes...]
+
+namespace
+{
+enum class Mode
+{
+    kCopy,
+    kMoveString,
+    kMoveBuffer
+};
+
+double process_cpu_ms()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+         + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+template <typename F>
+void in_loop(EventLoop *loop, F f)
+{
+    promise<void> done;
+    loop->queue_in_loop([&] {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void run(const char *name, Mode mode, size_t message_len, size_t total)
+{
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+    {
+        abort();
+    }
+    EventLoopThread io_thread;
+    EventLoop *loop = io_thread.start_loop();
+    TcpConnectionPtr conn;
+    in_loop(loop, [&] {
+        conn = make_shared<TcpConnection>(loop, "cross", sv[0], InetAddress(), InetAddress());
+        conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+        conn->connect_established();
+    });
+    size_t messages = total / message_len;
+    total = messages * message_len;
+
+    double cpu_start = process_cpu_ms();
+    auto start = chrono::steady_clock::now();
+    thread reader([fd = sv[1], total] {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        vector<char> sink(256 * 1024);
+        for (size_t got = 0; got < total; )
+        {
+            ssize_t n = ::read(fd, sink.data(), sink.size());
+            if (n <= 0)
+            {
+                abort();
+            }
+            got += n;
+        }
+    });
+
+    for (size_t i = 0; i < messages; ++i)
+    {
+        switch (mode)
+        {
+        case Mode::kCopy:
+        {
+            string message(message_len, 'c');
+            conn->send(message);
+            break;
+        }
+
+        case Mode::kMoveString:
+            conn->send(string(message_len, 's'));
+            break;
+
+        case Mode::kMoveBuffer:
+        {
+            Buffer message(message_len);
+            message.ensure_writable_bytes(message_len);
+            fill_n(message.begin_write(), message_len, 'b');
+            message.has_written(message_len);
+            conn->send(std::move(message));
+            break;
+        }
+        }
+    }
+    reader.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double cpu_ms = process_cpu_ms() - cpu_start;
+
+    printf("%8zu B  %-14s %9.1f MiB/s  %9.0f msg/s  %7.1f ms cpu/GiB\n",
+           message_len, name, total / seconds / (1024.0 * 1024.0), messages / seconds,
+           cpu_ms / (total / (1024.0 * 1024.0 * 1024.0)));
+    fflush(stdout);
+
+    in_loop(loop, [&] {
+        conn->connect_destroyed();
+        conn.reset();
+    });
+    ::close(sv[1]);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t total = (argc > 1 ? atol(argv[1]) : 256) * 1024 * 1024;
+    vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i)
+    {
+        sizes.push_back(atol(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {64, 4096, 65536, 1024 * 1024};
+    }
+
+    for (size_t size : sizes)
+    {
+        // small messages are bound by the queue, a smaller volume will do
+        size_t volume = size < 4096 ? total / 16 : total;
+        run("copy", Mode::kCopy, size, volume);
+        run("move string", Mode::kMoveString, size, volume);
+        run("move Buffer", Mode::kMoveBuffer, size, volume);
+    }
+
+    return 0;
+}
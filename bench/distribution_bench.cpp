@@ -0,0 +1,185 @@
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/channel.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/eventloopthreadpool.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// skewed load over 4 io loops: every 4th connection is heavy (2 ms of cpu
+//  per request), the rest are light and only measure their round trip.
+//  connections arrive one by one while earlier ones are already busy, each
+//  from its own 127.0.0.x so consistent hashing has something to hash
+//  usage: distribution_bench [seconds]
+
+namespace
+{
+const uint16_t kPort = 9878;
+const int kLoops = 4;
+const int kConnections = 32;
+const auto kHeavyCost = chrono::milliseconds(2);
+
+struct Client
+{
+    int fd;
+    bool heavy;
+    unique_ptr<Channel> channel;
+    chrono::steady_clock::time_point sent_at;
+};
+
+int connect_from(int i)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(0x7f000001 + i);
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&local), sizeof local) < 0)
+    {
+        abort();
+    }
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+void run(const char *name, LoopSelection selection, double seconds)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort, true), "distribution");
+    server.set_thread_num(kLoops);
+    server.set_loop_selection(selection);
+
+    mutex mutex;
+    map<EventLoop *, int> heavy_per_loop;
+    server.set_message_callback([&] (const TcpConnectionPtr &conn, Buffer *buf) {
+        while (buf->readable_bytes() > 0)
+        {
+            char c = *buf->peek();
+            buf->retrieve(1);
+            if (c == 'H')
+            {
+                if (!conn->get_context().has_value())
+                {
+                    conn->set_context(true);
+                    lock_guard<std::mutex> lock(mutex);
+                    ++heavy_per_loop[conn->get_loop()];
+                }
+                auto until = chrono::steady_clock::now() + kHeavyCost;
+                while (chrono::steady_clock::now() < until)
+                {
+                }
+            }
+            conn->send(string_view(&c, 1));
+        }
+    });
+    server.start();
+
+    vector<double> rtts;
+    vector<unique_ptr<Client>> clients;
+    EventLoopThread client_thread;
+    EventLoop *client_loop = client_thread.start_loop();
+    bool measuring = false;
+
+    thread connector([&] {
+        for (int i = 0; i < kConnections; ++i)
+        {
+            int fd = connect_from(i);
+            client_loop->run_in_loop([&, fd, i] {
+                auto client = make_unique<Client>();
+                client->fd = fd;
+                client->heavy = i % kLoops == 0;
+                client->channel = make_unique<Channel>(client_loop, fd);
+                Client *c = client.get();
+                c->channel->set_read_callback([&, c] {
+                    char reply;
+                    while (::read(c->fd, &reply, 1) == 1)
+                    {
+                        auto now = chrono::steady_clock::now();
+                        if (!c->heavy && measuring)
+                        {
+                            rtts.push_back(chrono::duration<double, micro>(now - c->sent_at).count());
+                        }
+                        c->sent_at = now;
+                        ::write(c->fd, c->heavy ? "H" : "L", 1);
+                    }
+                });
+                c->channel->enable_reading();
+                c->sent_at = chrono::steady_clock::now();
+                ::write(fd, c->heavy ? "H" : "L", 1);
+                clients.push_back(std::move(client));
+            });
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+        client_loop->run_in_loop([&] { measuring = true; });
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        client_loop->run_in_loop([&] {
+            measuring = false;
+            for (auto &client : clients)
+            {
+                client->channel->disable_all();
+                client->channel->remove();
+                ::close(client->fd);
+            }
+            clients.clear();
+        });
+        loop.run_after(chrono::milliseconds(100), [&loop] { loop.quit(); });
+    });
+    loop.loop();
+    connector.join();
+
+    int max_heavy = 0;
+    for (auto &pair : heavy_per_loop)
+    {
+        max_heavy = max(max_heavy, pair.second);
+    }
+    sort(rtts.begin(), rtts.end());
+    if (rtts.empty())
+    {
+        rtts.push_back(0);
+    }
+    printf("%-20s light p50 %8.0f us  p99 %8.0f us  p99.9 %8.0f us  max heavy/loop %d of %d\n",
+           name, rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100],
+           rtts[rtts.size() * 999 / 1000], max_heavy, kConnections / kLoops);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+    run("round-robin", LoopSelection::kRoundRobin, seconds);
+    run("least-connections", LoopSelection::kLeastConnections, seconds);
+    run("least-pending-work", LoopSelection::kLeastPendingWork, seconds);
+    run("power-of-two", LoopSelection::kPowerOfTwoChoices, seconds);
+    run("consistent-hash", LoopSelection::kConsistentHash, seconds);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../icarus/poller.hpp"
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// bulk stream through an echo server, level-triggered against
+//  edge-triggered connections. the poll(2) backend has no EPOLLET
+//  and only gets the drain loops
+//  usage: echo_bench [MiB] [poll|epoll|io_uring]
+
+namespace
+{
+const uint16_t kPort = 9877;
+
+int connect_blocking()
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return fd;
+}
+
+void stream(size_t total)
+{
+    int fd = connect_blocking();
+    thread writer([fd, total] {
+        vector<char> chunk(64 * 1024, 'x');
+        for (size_t sent = 0; sent < total; )
+        {
+            ssize_t n = ::write(fd, chunk.data(), min(chunk.size(), total - sent));
+            if (n <= 0)
+            {
+                abort();
+            }
+            sent += n;
+        }
+    });
+
+    vector<char> chunk(256 * 1024);
+    for (size_t received = 0; received < total; )
+    {
+        ssize_t n = ::read(fd, chunk.data(), chunk.size());
+        if (n <= 0)
+        {
+            abort();
+        }
+        received += n;
+    }
+    writer.join();
+    ::close(fd);
+}
+
+void run(PollerBackend backend, bool edge_triggered, size_t total)
+{
+    EventLoop loop(backend);
+    TcpServer server(&loop, InetAddress(kPort, true), "echo bench");
+    server.set_edge_triggered(edge_triggered);
+    server.set_message_callback([] (const TcpConnectionPtr &conn, Buffer *buf) {
+        conn->send(buf);
+    });
+    server.start();
+
+    auto start = chrono::steady_clock::now();
+    thread client([&] {
+        stream(total);
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    auto stats = loop.poller_stats();
+    double mib = static_cast<double>(total) / (1024 * 1024);
+    printf("%-16s %12.1f %16.1f %16.1f\n", edge_triggered ? "edge" : "level",
+           mib / seconds, stats.polls / mib, static_cast<double>(stats.events) / stats.polls);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t mib = argc > 1 ? atoi(argv[1]) : 1024;
+    string name = argc > 2 ? argv[2] : "epoll";
+    PollerBackend backend = name == "poll" ? PollerBackend::kPoll
+                          : name == "io_uring" ? PollerBackend::kIoUring
+                          : PollerBackend::kEpoll;
+
+    printf("%-16s %12s %16s %16s\n", "mode", "MiB/s", "polls/MiB", "events/poll");
+    run(backend, false, mib * 1024 * 1024);
+    run(backend, true, mib * 1024 * 1024);
+}
@@ -0,0 +1,177 @@
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// one message sent to every connection of a loop, over unix socket
+//  pairs whose peers do not read, so whatever the socket does not take
+//  stays queued. copied with send(std::string_view) against queued by
+//  reference with send(PayloadPtr), from the loop thread and from
+//  another thread. every case runs in its own process and reports the
+//  cpu time of the fan-out and the growth of its RSS. when the fd limit
+//  is too low, as many connections as fit are used and the memory is
+//  projected
+//  usage: fanout_bench [connections] [payload_kib]
+
+namespace
+{
+double process_cpu_ms()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+         + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+long rss_bytes()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm || fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    {
+        abort();
+    }
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+size_t max_connections()
+{
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    // two fds per pair, some left for the loops
+    return (limit.rlim_cur - 64) / 2;
+}
+
+// runs f in the loop and waits for it
+template <typename F>
+void in_loop(EventLoop *loop, F f)
+{
+    promise<void> done;
+    loop->run_in_loop([&] {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void run(const char *name, bool by_reference, bool cross_thread, size_t wanted, size_t payload_size)
+{
+    size_t count = min(wanted, max_connections());
+    EventLoopThread thread;
+    EventLoop *loop = thread.start_loop();
+    vector<TcpConnectionPtr> conns;
+    vector<int> peers;
+    conns.reserve(count);
+    peers.reserve(count);
+    in_loop(loop, [&] {
+        for (size_t i = 0; i < count; ++i)
+        {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+            {
+                abort();
+            }
+            auto conn = make_shared<TcpConnection>(loop, "fanout#" + to_string(i), sv[0],
+                                                   InetAddress(), InetAddress());
+            conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+            conn->connect_established();
+            conns.push_back(move(conn));
+            peers.push_back(sv[1]);
+        }
+    });
+
+    string message(payload_size, 'm');
+    auto payload = make_shared<const string>(message);
+    auto fan_out = [&] {
+        for (auto &conn : conns)
+        {
+            if (by_reference)
+            {
+                conn->send(payload);
+            }
+            else
+            {
+                conn->send(message);
+            }
+        }
+    };
+
+    long before = rss_bytes();
+    double cpu_start = process_cpu_ms();
+    if (cross_thread)
+    {
+        fan_out();
+        // queued behind every send
+        in_loop(loop, [] {});
+    }
+    else
+    {
+        in_loop(loop, fan_out);
+    }
+    double cpu_ms = process_cpu_ms() - cpu_start;
+    double per_conn = static_cast<double>(rss_bytes() - before) / count;
+
+    printf("%-28s %6zu conns  %8.1f ms cpu  %8.0f B/conn  RSS for %zu: %8.1f MiB%s\n",
+           name, count, cpu_ms * wanted / count, per_conn, wanted,
+           per_conn * wanted / (1024.0 * 1024.0), count < wanted ? " (projected)" : "");
+    fflush(stdout);
+
+    in_loop(loop, [&] {
+        for (auto &conn : conns)
+        {
+            conn->connect_destroyed();
+        }
+        conns.clear();
+    });
+    for (int fd : peers)
+    {
+        ::close(fd);
+    }
+}
+
+void run_in_child(const char *name, bool by_reference, bool cross_thread, size_t wanted, size_t payload_size)
+{
+    fflush(stdout);
+    pid_t pid = ::fork();
+    if (pid == 0)
+    {
+        run(name, by_reference, cross_thread, wanted, payload_size);
+        _exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? atol(argv[1]) : 10000;
+    size_t payload_size = (argc > 2 ? atol(argv[2]) : 256) * 1024;
+
+    printf("1 message of %zu KiB to %zu connections\n", payload_size / 1024, count);
+    run_in_child("copied, in loop", false, false, count, payload_size);
+    run_in_child("by reference, in loop", true, false, count, payload_size);
+    run_in_child("copied, cross-thread", false, true, count, payload_size);
+    run_in_child("by reference, cross-thread", true, true, count, payload_size);
+
+    return 0;
+}
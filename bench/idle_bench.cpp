@@ -0,0 +1,166 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// user-space memory per idle connection: established connections over
+//  unix socket pairs, either never used or idle after one request and
+//  reply, with buffers kept or released once drained. every case runs
+//  in its own process and reports the growth of its RSS. when the fd
+//  limit is too low for a count, as many connections as fit are opened
+//  and the total is projected from the per-connection cost
+//  usage: idle_bench [connections...]
+
+namespace
+{
+enum class Mode
+{
+    kNeverUsed,
+    kKeep,
+    kRelease
+};
+
+long rss_bytes()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm || fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    {
+        abort();
+    }
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+size_t max_connections()
+{
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    // two fds per pair, some left for the loop
+    return (limit.rlim_cur - 64) / 2;
+}
+
+void run(const char *name, Mode mode, size_t wanted)
+{
+    size_t count = min(wanted, max_connections());
+    EventLoop loop;
+    vector<TcpConnectionPtr> conns;
+    vector<int> peers;
+    conns.reserve(count);
+    peers.reserve(count);
+    size_t replied = 0;
+
+    long before = rss_bytes();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+        {
+            abort();
+        }
+        auto conn = make_shared<TcpConnection>(&loop, "idle#" + to_string(i), sv[0],
+                                               InetAddress(), InetAddress());
+        conn->set_buffer_release_threshold(mode == Mode::kRelease ? 0 : TcpConnection::kKeepBuffers);
+        conn->set_connection_callback(TcpConnection::default_connection_callback);
+        conn->set_message_callback([&] (const TcpConnectionPtr &c, Buffer *buf) {
+            c->send(buf);
+            if (++replied == count)
+            {
+                loop.quit();
+            }
+        });
+        conn->connect_established();
+        conns.push_back(move(conn));
+        peers.push_back(sv[1]);
+    }
+
+    if (mode != Mode::kNeverUsed)
+    {
+        for (int fd : peers)
+        {
+            if (::write(fd, "ping", 4) != 4)
+            {
+                abort();
+            }
+        }
+        loop.loop();
+        char reply[4];
+        for (int fd : peers)
+        {
+            if (::read(fd, reply, sizeof reply) != 4)
+            {
+                abort();
+            }
+        }
+    }
+    double per_conn = static_cast<double>(rss_bytes() - before) / count;
+    auto stats = loop.buffer_pool().stats();
+
+    printf("%-22s %9zu conns  %8.0f B/conn  RSS for %zu: %9.1f MiB%s  pool cached %6.1f MiB\n",
+           name, count, per_conn, wanted, per_conn * wanted / (1024.0 * 1024.0),
+           count < wanted ? " (projected)" : "",
+           stats.cached_bytes / (1024.0 * 1024.0));
+    fflush(stdout);
+
+    for (auto &conn : conns)
+    {
+        conn->connect_destroyed();
+    }
+    for (int fd : peers)
+    {
+        ::close(fd);
+    }
+}
+
+void run_in_child(const char *name, Mode mode, size_t wanted)
+{
+    fflush(stdout);
+    pid_t pid = ::fork();
+    if (pid == 0)
+    {
+        run(name, mode, wanted);
+        _exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> counts;
+    for (int i = 1; i < argc; ++i)
+    {
+        counts.push_back(atol(argv[i]));
+    }
+    if (counts.empty())
+    {
+        counts = {100000, 1000000};
+    }
+
+    printf("sizeof(TcpConnection): %zu, sizeof(Buffer): %zu\n", sizeof(TcpConnection), sizeof(Buffer));
+    for (size_t count : counts)
+    {
+        run_in_child("never used", Mode::kNeverUsed, count);
+        run_in_child("one exchange, kept", Mode::kKeep, count);
+        run_in_child("one exchange, released", Mode::kRelease, count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/channel.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthread.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// one byte bounced between two loops over a socketpair, blocking
+//  against spinning against adaptive busy polling. reports round trip
+//  percentiles and the cpu burnt by both loops during an idle second
+//  usage: pingpong_bench [rounds] [window_us]
+
+namespace
+{
+double process_cpu_ms()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+         + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+void run(const char *name, BusyPollMode mode, chrono::microseconds window, int rounds)
+{
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+    {
+        abort();
+    }
+
+    // echo side
+    unique_ptr<Channel> echo_channel;
+    EventLoopThread echo_thread([&echo_channel, mode, window, fd = sv[1]] (EventLoop *loop) {
+        loop->set_busy_poll(mode, window);
+        echo_channel = make_unique<Channel>(loop, fd);
+        echo_channel->set_read_callback([fd] {
+            char c;
+            while (::read(fd, &c, 1) == 1)
+            {
+                ::write(fd, &c, 1);
+            }
+        });
+        echo_channel->enable_reading();
+    });
+    EventLoop *echo_loop = echo_thread.start_loop();
+
+    // ping side
+    EventLoop loop;
+    loop.set_busy_poll(mode, window);
+    vector<double> rtts;
+    rtts.reserve(rounds);
+    const int warmup = rounds / 10;
+    int count = 0;
+    auto sent_at = chrono::steady_clock::now();
+
+    Channel channel(&loop, sv[0]);
+    channel.set_read_callback([&] {
+        char c;
+        while (::read(sv[0], &c, 1) == 1)
+        {
+            auto now = chrono::steady_clock::now();
+            if (count++ >= warmup)
+            {
+                rtts.push_back(chrono::duration<double, micro>(now - sent_at).count());
+            }
+            if (count == rounds + warmup)
+            {
+                loop.quit();
+                return;
+            }
+            sent_at = now;
+            ::write(sv[0], "x", 1);
+        }
+    });
+    channel.enable_reading();
+    loop.run_in_loop([&] { ::write(sv[0], "x", 1); });
+    loop.loop();
+
+    // both loops idle now, blocking ones sleep and adaptive ones stop spinning
+    double cpu_start = process_cpu_ms();
+    loop.run_after(chrono::seconds(1), [&loop] { loop.quit(); });
+    loop.loop();
+    double idle_cpu_ms = process_cpu_ms() - cpu_start;
+
+    channel.disable_all();
+    channel.remove();
+    echo_loop->run_in_loop([&echo_channel, fd = sv[1]] {
+        echo_channel->disable_all();
+        echo_channel->remove();
+        echo_channel.reset();
+        ::close(fd);
+    });
+
+    sort(rtts.begin(), rtts.end());
+    printf("%-9s p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  idle cpu %5.1f%%\n", name,
+           rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100], rtts[rtts.size() * 999 / 1000],
+           idle_cpu_ms / 10.0);
+    ::close(sv[0]);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    const chrono::microseconds window(argc > 2 ? atoi(argv[2]) : 50);
+
+    printf("rounds: %d, window: %ld us, cpus: %u\n", rounds, static_cast<long>(window.count()),
+           thread::hardware_concurrency());
+    run("blocking", BusyPollMode::kBlocking, window, rounds);
+    run("spin", BusyPollMode::kSpin, window, rounds);
+    run("adaptive", BusyPollMode::kAdaptive, window, rounds);
+
+    return 0;
+}
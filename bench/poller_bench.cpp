@@ -0,0 +1,133 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "../icarus/poller.hpp"
+#include "../icarus/channel.hpp"
+#include "../icarus/eventloop.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// dispatch cost per ready event of every poller backend as the number of
+//  registered fds grows, a fixed number of fds stays readable while the
+//  rest are idle
+//  usage: poller_bench [num_active]
+
+namespace
+{
+rlim_t raise_fd_limit()
+{
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    return limit.rlim_cur;
+}
+
+struct Result
+{
+    PollerBackend backend;
+    double ns_per_event;
+    PollerStats stats;
+};
+
+const char *backend_name(PollerBackend backend)
+{
+    switch (backend)
+    {
+    case PollerBackend::kPoll:
+        return "poll";
+    case PollerBackend::kEpoll:
+        return "epoll";
+    case PollerBackend::kIoUring:
+        return "io_uring";
+    }
+    return "?";
+}
+
+Result run(PollerBackend backend, int num_fds, int num_active, int num_iterations)
+{
+    EventLoop loop(backend);
+    vector<int> fds;
+    vector<unique_ptr<Channel>> channels;
+    long dispatched = 0;
+    const long target = static_cast<long>(num_active) * num_iterations;
+
+    for (int i = 0; i < num_fds; ++i)
+    {
+        int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0)
+        {
+            perror("eventfd");
+            exit(1);
+        }
+        fds.push_back(fd);
+        channels.push_back(make_unique<Channel>(&loop, fd));
+        channels.back()->set_read_callback([&] {
+            if (++dispatched == target)
+            {
+                loop.quit();
+            }
+        });
+        channels.back()->enable_reading();
+    }
+
+    // spread the active fds over the table, they are never drained
+    //  so they stay readable on every poll
+    uint64_t one = 1;
+    for (int i = 0; i < num_active; ++i)
+    {
+        ::write(fds[static_cast<size_t>(i) * num_fds / num_active], &one, sizeof one);
+    }
+
+    auto start = chrono::steady_clock::now();
+    loop.loop();
+    auto elapsed = chrono::steady_clock::now() - start;
+    auto stats = loop.poller_stats();
+
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        channels[i]->disable_all();
+        channels[i]->remove();
+        ::close(fds[i]);
+    }
+    return { loop.poller_backend(), chrono::duration<double, nano>(elapsed).count() / dispatched, stats };
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int num_active = argc > 1 ? atoi(argv[1]) : 64;
+    const rlim_t max_fds = raise_fd_limit();
+
+    printf("%10s %10s %10s %16s %16s %16s\n",
+           "backend", "fds", "active", "ns/event", "events/poll", "event list");
+    for (auto backend : { PollerBackend::kPoll, PollerBackend::kEpoll, PollerBackend::kIoUring })
+    {
+        for (int num_fds : { 100, 1000, 10000, 50000 })
+        {
+            if (static_cast<rlim_t>(num_fds) + 64 > max_fds)
+            {
+                printf("%10s %10d %10s %16s\n", backend_name(backend), num_fds, "-", "RLIMIT_NOFILE");
+                continue;
+            }
+            int active = num_active < num_fds ? num_active : num_fds;
+            auto result = run(backend, num_fds, active, 2000);
+            if (result.backend != backend)
+            {
+                printf("%10s %10s\n", backend_name(backend), "unsupported, fell back");
+                break;
+            }
+            printf("%10s %10d %10d %16.1f %16.1f %16zu\n", backend_name(backend), num_fds, active,
+                   result.ns_per_event, static_cast<double>(result.stats.events) / result.stats.polls,
+                   result.stats.event_list_size);
+        }
+    }
+}
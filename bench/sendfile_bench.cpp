@@ -0,0 +1,187 @@
+#include <ctime>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// a static file served over loopback tcp, again and again, by a loop
+//  in its own thread to a blocking reader. the buffered path preads a
+//  chunk into a Buffer and sends it, the next chunk once it is out, the
+//  other hands the whole file to send_file. reports the throughput and
+//  the cpu time of the serving thread per GiB
+//  usage: sendfile_bench [file_mib] [rounds]
+
+namespace
+{
+constexpr size_t kChunk = 256 * 1024;
+
+double thread_cpu_ms()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int temp_file(size_t size)
+{
+    char path[] = "/tmp/sendfile_benchXXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+    {
+        abort();
+    }
+    ::unlink(path);
+    string chunk(kChunk, 'x');
+    for (size_t written = 0; written < size; written += chunk.size())
+    {
+        if (::write(fd, chunk.data(), chunk.size()) != static_cast<ssize_t>(chunk.size()))
+        {
+            abort();
+        }
+    }
+    return fd;
+}
+
+// a connected pair over loopback, the server side non-blocking
+void tcp_pair(int *server, int *client)
+{
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    if (::bind(listener, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0
+        || ::listen(listener, 1) < 0
+        || ::getsockname(listener, reinterpret_cast<struct sockaddr *>(&addr), &len) < 0)
+    {
+        abort();
+    }
+    *client = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(*client, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) < 0)
+    {
+        abort();
+    }
+    *server = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (*server < 0)
+    {
+        abort();
+    }
+    ::close(listener);
+}
+
+void run(const char *name, bool use_sendfile, int file, size_t size, int rounds)
+{
+    int server = 0;
+    int client = 0;
+    tcp_pair(&server, &client);
+
+    auto thread = make_unique<EventLoopThread>();
+    EventLoop *loop = thread->start_loop();
+    TcpConnectionPtr conn;
+    double cpu_start = 0;
+    double cpu_ms = 0;
+    int round = 0;
+    off_t offset = 0;
+
+    // queues the next piece once the previous one is out
+    auto serve = [&, use_sendfile] (const TcpConnectionPtr &c) {
+        if (round == rounds)
+        {
+            return;
+        }
+        if (use_sendfile)
+        {
+            ++round;
+            c->send_file(file, 0, size);
+            return;
+        }
+        Buffer chunk;
+        chunk.ensure_writable_bytes(kChunk);
+        ssize_t n = ::pread(file, chunk.begin_write(), kChunk, offset);
+        if (n <= 0)
+        {
+            abort();
+        }
+        chunk.has_written(n);
+        offset += n;
+        if (static_cast<size_t>(offset) == size)
+        {
+            offset = 0;
+            ++round;
+        }
+        c->send(&chunk);
+    };
+
+    loop->run_in_loop([&] {
+        conn = make_shared<TcpConnection>(loop, "file", server, InetAddress(), InetAddress());
+        conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+        conn->set_write_complete_callback(serve);
+        conn->connect_established();
+        cpu_start = thread_cpu_ms();
+        serve(conn);
+    });
+
+    auto start = chrono::steady_clock::now();
+    vector<char> sink(kChunk);
+    size_t total = size * rounds;
+    for (size_t got = 0; got < total; )
+    {
+        ssize_t n = ::read(client, sink.data(), sink.size());
+        if (n <= 0)
+        {
+            abort();
+        }
+        got += n;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    promise<void> done;
+    loop->run_in_loop([&] {
+        cpu_ms = thread_cpu_ms() - cpu_start;
+        conn->connect_destroyed();
+        conn.reset();
+        done.set_value();
+    });
+    done.get_future().wait();
+    thread.reset();
+    ::close(client);
+
+    double gib = total / (1024.0 * 1024.0 * 1024.0);
+    printf("%-10s %8.1f MiB/s  serving thread %7.1f ms cpu/GiB\n",
+           name, total / seconds / (1024.0 * 1024.0), cpu_ms / gib);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t mib = argc > 1 ? atol(argv[1]) : 64;
+    int rounds = argc > 2 ? atoi(argv[2]) : 8;
+    size_t size = mib * 1024 * 1024;
+    int file = temp_file(size);
+
+    printf("%zu MiB file, %d rounds, %zu KiB chunks on the buffered path\n", mib, rounds, kChunk / 1024);
+    for (int i = 0; i < 2; ++i)
+    {
+        run("buffered", false, file, size, rounds);
+        run("send_file", true, file, size, rounds);
+    }
+
+    ::close(file);
+    return 0;
+}
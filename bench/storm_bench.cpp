@@ -0,0 +1,132 @@
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// connection storm: a full backlog is waiting when the server loop starts,
+//  timed until every connection is established on its io loop, for
+//  several accept batch sizes. then the same storm with the fd limit
+//  lowered so accept fails with EMFILE, the listener must not spin
+//  usage: storm_bench [connections] [io_loops]
+
+namespace
+{
+const uint16_t kPort = 9880;
+
+vector<int> storm(int n)
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    vector<int> fds;
+    for (int i = 0; i < n; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+        {
+            break;
+        }
+        ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+        fds.push_back(fd);
+    }
+    return fds;
+}
+
+void run(int batch, int connections, int io_loops)
+{
+    EventLoop loop(PollerBackend::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort, true), "storm");
+    server.set_thread_num(io_loops);
+    server.set_accept_batch(batch);
+    atomic<int> established(0);
+    server.set_connection_callback([&] (const TcpConnectionPtr &conn) {
+        if (conn->connected() && established.fetch_add(1) + 1 == connections)
+        {
+            loop.queue_in_loop([&loop] { loop.quit(); });
+        }
+    });
+    server.start();
+
+    vector<int> fds = storm(connections);
+    auto polls = loop.poller_stats().polls;
+    auto start = chrono::steady_clock::now();
+    loop.run_after(chrono::seconds(10), [&loop] { loop.quit(); });
+    loop.loop();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    printf("batch %3d: %6d established in %7.1f ms  %8.0f conns/s  %6lu listener polls\n",
+           batch, established.load(), ms, established.load() / ms * 1e3,
+           static_cast<unsigned long>(loop.poller_stats().polls - polls));
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+}
+
+void run_emfile(int connections, int io_loops)
+{
+    EventLoop loop(PollerBackend::kEpoll);
+    TcpServer server(&loop, InetAddress(kPort, true), "storm");
+    server.set_thread_num(io_loops);
+    atomic<int> established(0);
+    server.set_connection_callback([&] (const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            established.fetch_add(1);
+        }
+    });
+    server.start();
+    vector<int> fds = storm(connections);
+
+    // room for a few dozen more fds only
+    struct rlimit saved;
+    ::getrlimit(RLIMIT_NOFILE, &saved);
+    int probe = ::dup(0);
+    ::close(probe);
+    struct rlimit lowered = saved;
+    lowered.rlim_cur = probe + 32;
+    ::setrlimit(RLIMIT_NOFILE, &lowered);
+
+    auto polls = loop.poller_stats().polls;
+    loop.run_after(chrono::milliseconds(500), [&loop] { loop.quit(); });
+    loop.loop();
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+
+    printf("EMFILE:    %6d established, %6lu dropped, %6lu listener polls in 500 ms\n",
+           established.load(), static_cast<unsigned long>(server.dropped_connections()),
+           static_cast<unsigned long>(loop.poller_stats().polls - polls));
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? atoi(argv[1]) : 2000;
+    int io_loops = argc > 2 ? atoi(argv[2]) : 4;
+
+    printf("connections: %d, io loops: %d\n", connections, io_loops);
+    for (int batch : { 1, 16, 64 })
+    {
+        run(batch, connections, io_loops);
+    }
+    run_emfile(connections, io_loops);
+
+    return 0;
+}
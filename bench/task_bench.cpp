@@ -0,0 +1,117 @@
+#include <array>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/uniquefunction.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// measures tasks/sec of the loop's functor queue, single-threaded and
+//  cross-thread, and the raw cost of std::function against UniqueFunction
+//  for a capture too large for std::function's small buffer
+//  usage: task_bench [num_tasks]
+
+namespace
+{
+double wall_ns()
+{
+    return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// 48 bytes, a typical capture of a few pointers and sizes
+struct Payload
+{
+    array<long, 6> words;
+};
+
+template <typename Function>
+double raw_ns(int num_tasks)
+{
+    long sum = 0;
+    Payload payload{};
+    double start = wall_ns();
+    for (int i = 0; i < num_tasks; ++i)
+    {
+        payload.words[0] = i;
+        Function f([payload, &sum] { sum += payload.words[0]; });
+        Function g(std::move(f));
+        g();
+    }
+    double elapsed = wall_ns() - start;
+    if (sum != static_cast<long>(num_tasks) * (num_tasks - 1) / 2)
+    {
+        abort();
+    }
+    return elapsed;
+}
+
+double single_thread_ns(int num_tasks)
+{
+    EventLoop loop;
+    long count = 0;
+    double start = 0;
+    loop.run_in_loop([&] {
+        start = wall_ns();
+        Payload payload{};
+        for (int i = 0; i < num_tasks; ++i)
+        {
+            loop.queue_in_loop([payload, &count] { count += payload.words[0] + 1; });
+        }
+        loop.queue_in_loop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    double elapsed = wall_ns() - start;
+    if (count != num_tasks)
+    {
+        abort();
+    }
+    return elapsed;
+}
+
+double cross_thread_ns(int num_tasks)
+{
+    EventLoop loop;
+    long count = 0;
+    double start = wall_ns();
+    thread producer([&] {
+        Payload payload{};
+        for (int i = 0; i < num_tasks; ++i)
+        {
+            loop.queue_in_loop([payload, &count] { count += payload.words[0] + 1; });
+        }
+        loop.queue_in_loop([&loop] { loop.quit(); });
+    });
+    loop.loop();
+    double elapsed = wall_ns() - start;
+    producer.join();
+    if (count != num_tasks)
+    {
+        abort();
+    }
+    return elapsed;
+}
+
+void report(const char *name, int num_tasks, double ns)
+{
+    printf("%-26s %8.1f ns/task  %6.2f Mtasks/s\n", name, ns / num_tasks, num_tasks / ns * 1e3);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int num_tasks = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    printf("tasks: %d, capture: %zu bytes\n", num_tasks, sizeof(Payload) + sizeof(void *));
+    report("std::function", num_tasks, raw_ns<function<void()>>(num_tasks));
+    report("UniqueFunction", num_tasks, raw_ns<UniqueFunction<void()>>(num_tasks));
+    report("queue_in_loop same thread", num_tasks, single_thread_ns(num_tasks));
+    report("queue_in_loop cross thread", num_tasks, cross_thread_ns(num_tasks));
+
+    return 0;
+}
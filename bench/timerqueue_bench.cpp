@@ -0,0 +1,70 @@
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../icarus/eventloop.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// measures insert, cancel and fire cost of the timing wheel
+//  usage: timerqueue_bench [num_timers]
+
+namespace
+{
+double thread_cpu_ns()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+double wall_ns()
+{
+    return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int num_timers = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int max_delay_ms = 2000;
+
+    EventLoop loop;
+    mt19937 rng(42);
+    uniform_int_distribution<int> delay(1, max_delay_ms);
+    vector<TimerId> ids;
+    ids.reserve(num_timers);
+    long fired = 0;
+
+    double start = wall_ns();
+    for (int i = 0; i < num_timers; ++i)
+    {
+        ids.push_back(loop.run_after(chrono::milliseconds(delay(rng)), [&fired] { ++fired; }));
+    }
+    double insert_ns = wall_ns() - start;
+
+    start = wall_ns();
+    for (int i = 0; i < num_timers; i += 2)
+    {
+        loop.cancel(ids[i]);
+    }
+    double cancel_ns = wall_ns() - start;
+    const int cancelled = (num_timers + 1) / 2;
+
+    loop.run_after(chrono::milliseconds(max_delay_ms + 100), [&loop] { loop.quit(); });
+    double cpu_start = thread_cpu_ns();
+    loop.loop();
+    double fire_cpu_ns = thread_cpu_ns() - cpu_start;
+
+    printf("timers:  %d\n", num_timers);
+    printf("insert:  %.1f ns/timer\n", insert_ns / num_timers);
+    printf("cancel:  %.1f ns/timer\n", cancel_ns / cancelled);
+    printf("fire:    %.1f ns/timer (loop cpu time, %ld fired)\n", fire_cpu_ns / fired, fired);
+
+    return fired == num_timers - cancelled ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// a message of 2 to 16 fragments sent over a unix socket pair, joined
+//  into a temporary string and sent against handed to send as iovecs.
+//  batches of up to 32 messages or 64 KiB, the peer drained after each, so both go
+//  out directly. ns per message
+//  usage: writev_bench [messages] [fragment_bytes...]
+
+namespace
+{
+// sent between two drains, well inside the socket buffer, which also
+//  counts the overhead of every message
+constexpr size_t kBatchBytes = 64 * 1024;
+constexpr size_t kMaxBatch = 32;
+
+void drain(int fd, size_t len)
+{
+    static char sink[64 * 1024];
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, sink, min(len, sizeof sink));
+        if (n <= 0)
+        {
+            abort();
+        }
+        len -= n;
+    }
+}
+
+template <typename Send>
+double ns_per_message(const TcpConnectionPtr &conn, int peer, size_t message_len, int messages, Send send)
+{
+    int batch = static_cast<int>(clamp<size_t>(kBatchBytes / message_len, 1, kMaxBatch));
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < messages; i += batch)
+    {
+        for (int j = 0; j < batch; ++j)
+        {
+            send(conn);
+        }
+        drain(peer, message_len * batch);
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / messages;
+}
+
+void run(EventLoop *loop, size_t fragment_len, int fragments, int messages)
+{
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+    {
+        abort();
+    }
+    auto conn = make_shared<TcpConnection>(loop, "writev", sv[0], InetAddress(), InetAddress());
+    conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+    conn->connect_established();
+
+    vector<string> parts(fragments, string(fragment_len, 'f'));
+    vector<struct iovec> iov;
+    for (auto &part : parts)
+    {
+        iov.push_back({part.data(), part.size()});
+    }
+    size_t message_len = fragment_len * fragments;
+
+    double joined = ns_per_message(conn, sv[1], message_len, messages, [&] (const TcpConnectionPtr &c) {
+        string message;
+        for (const auto &part : parts)
+        {
+            message += part;
+        }
+        c->send(message);
+    });
+    double gathered = ns_per_message(conn, sv[1], message_len, messages, [&] (const TcpConnectionPtr &c) {
+        c->send(iov);
+    });
+    printf("%6zu B x %2d  joined %8.0f ns  writev %8.0f ns  %5.2fx\n",
+           fragment_len, fragments, joined, gathered, joined / gathered);
+
+    conn->connect_destroyed();
+    ::close(sv[1]);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int messages = argc > 1 ? atoi(argv[1]) : 200000;
+    vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i)
+    {
+        sizes.push_back(atol(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {64, 1024, 4096};
+    }
+
+    EventLoop loop;
+    for (size_t size : sizes)
+    {
+        for (int fragments : {2, 4, 8, 16})
+        {
+            run(&loop, size, fragments, messages);
+        }
+    }
+
+    return 0;
+}
@@ -1,3 +1,8 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
 #include "acceptor.hpp"
 #include "socketsfunc.hpp"
 #include "eventloop.hpp"
@@ -6,24 +11,57 @@
 namespace icarus
 {
 
-Acceptor::Acceptor(EventLoop *loop, const InetAddress &listen_addr)
+Acceptor::Acceptor(EventLoop *loop, const InetAddress &listen_addr, bool reuse_port)
   : loop_(loop),
     accept_socket_(sockets::create_nonblocking_or_die()),
     accept_channel_(loop, accept_socket_.fd()),
-    listenning_(false)
+    listenning_(false),
+    accept_batch_(kDefaultAcceptBatch),
+    idle_fd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    dropped_(0)
 {
     accept_socket_.set_reuse_addr(true);
+    accept_socket_.set_reuse_port(reuse_port);
     accept_socket_.bind_address(listen_addr);
     accept_channel_.set_read_callback([this] () {
        this->handle_read();
     });
 }
 
+Acceptor::~Acceptor()
+{
+    if (listenning_)
+    {
+        loop_->assert_in_loop_thread();
+        accept_channel_.disable_all();
+        accept_channel_.remove();
+    }
+    if (idle_fd_ >= 0)
+    {
+        ::close(idle_fd_);
+    }
+}
+
 void Acceptor::set_new_connection_callback(NewConnectionCallback cb)
 {
     new_connection_callback_ = std::move(cb);
 }
 
+void Acceptor::set_new_connections_callback(NewConnectionsCallback cb)
+{
+    new_connections_callback_ = std::move(cb);
+}
+
+void Acceptor::set_accept_batch(int batch)
+{
+    accept_batch_ = batch > 0 ? batch : 1;
+}
+
+std::uint64_t Acceptor::dropped_connections() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
 bool Acceptor::listenning() const
 {
     return listenning_;
@@ -40,19 +78,70 @@ void Acceptor::listen()
 void Acceptor::handle_read()
 {
     loop_->assert_in_loop_thread();
-    InetAddress peer_addr(0);
-    int connfd = accept_socket_.accept(&peer_addr);
-    if (connfd >= 0)
+    batch_.clear();
+    for (int i = 0; i < accept_batch_; ++i)
     {
-        if (new_connection_callback_)
+        InetAddress peer_addr(0);
+        int connfd = accept_socket_.accept(&peer_addr);
+        if (connfd >= 0)
         {
-            new_connection_callback_(connfd, peer_addr);
+            batch_.emplace_back(connfd, peer_addr);
         }
-        else
+        else if (errno == EMFILE || errno == ENFILE)
         {
-            sockets::close(connfd);
+            if (!drop_with_idle_fd())
+            {
+                break;
+            }
         }
+        else if (errno != ECONNABORTED && errno != EINTR && errno != EPROTO && errno != EPERM)
+        {
+            // EAGAIN, the backlog is drained
+            break;
+        }
+    }
+
+    if (batch_.empty())
+    {
+        return;
+    }
+    if (new_connections_callback_)
+    {
+        new_connections_callback_(batch_);
+    }
+    else
+    {
+        for (auto &connection : batch_)
+        {
+            if (new_connection_callback_)
+            {
+                new_connection_callback_(connection.first, connection.second);
+            }
+            else
+            {
+                sockets::close(connection.first);
+            }
+        }
+    }
+    batch_.clear();
+}
+
+// returns false when there was nothing left to drop
+bool Acceptor::drop_with_idle_fd()
+{
+    if (idle_fd_ < 0)
+    {
+        return false;
+    }
+    ::close(idle_fd_);
+    int connfd = ::accept(accept_socket_.fd(), nullptr, nullptr);
+    if (connfd >= 0)
+    {
+        ::close(connfd);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
     }
+    idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return connfd >= 0;
 }
 
 } // namespace icarus
@@ -1,11 +1,16 @@
 #ifndef ICARUS_ACCEPTOR_HPP
 #define ICARUS_ACCEPTOR_HPP
 
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <utility>
 #include <functional>
 
 #include "noncopyable.hpp"
 #include "channel.hpp"
 #include "socket.hpp"
+#include "inetaddress.hpp"
 
 namespace icarus
 {
@@ -16,21 +21,49 @@ class Acceptor
     using NewConnectionCallback = std::function<void (int sockfd,
                                                       const InetAddress&)>;
 
-    Acceptor(EventLoop* loop, const InetAddress& listen_addr);
+    using NewConnection = std::pair<int, InetAddress>;
+    // everything one readiness event accepted, takes over the fds
+    using NewConnectionsCallback = std::function<void (std::vector<NewConnection>&)>;
+
+    // connections accepted per readiness event at most
+    static constexpr int kDefaultAcceptBatch = 16;
+
+    // with reuse_port several acceptors can bind the same address and
+    //  the kernel spreads incoming connections over them
+    Acceptor(EventLoop* loop, const InetAddress& listen_addr, bool reuse_port = false);
+    ~Acceptor();
 
     void set_new_connection_callback(NewConnectionCallback cb);
 
+    // preferred over the single connection callback when set
+    void set_new_connections_callback(NewConnectionsCallback cb);
+
+    void set_accept_batch(int batch);
+
+    // connections accepted and closed right away because fds ran out,
+    //  thread safe
+    std::uint64_t dropped_connections() const;
+
     bool listenning() const;
     void listen();
 
   private:
     void handle_read();
+    bool drop_with_idle_fd();
 
     EventLoop* loop_;
     Socket accept_socket_;
     Channel accept_channel_;
     NewConnectionCallback new_connection_callback_;
+    NewConnectionsCallback new_connections_callback_;
     bool listenning_;
+    int accept_batch_;
+    // kept open to be given up when accept fails with EMFILE, so the
+    //  pending connection can be taken and closed instead of waking
+    //  the level-triggered listener again and again
+    int idle_fd_;
+    std::atomic<std::uint64_t> dropped_;
+    std::vector<NewConnection> batch_;
 };
 
 } // namespace icarus
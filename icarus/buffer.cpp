@@ -1,39 +1,86 @@
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
+#include <sys/uio.h>
 
+#include "bytescan.hpp"
 #include "socketsfunc.hpp"
 #include "buffer.hpp"
 
 namespace icarus
 {
-const char Buffer::kCRLF[] = "\r\n";
+namespace
+{
+// slabs flushed by one write_fd
+constexpr int kMaxWriteSegments = 64;
+
+size_t initial_read_hint(size_t initial_size)
+{
+    return std::clamp(initial_size, Buffer::kMinReadSize, Buffer::kMaxReadSize);
+}
+
+// what begin() points into while there is no storage, never written
+char g_no_storage[Buffer::kCheapPrepend];
+} // namespace
 
 Buffer::Buffer(size_t initialize_size)
-  : buffer_(kCheapPrepend + initialize_size),
-    reader_index_(kCheapPrepend),
-    writer_index_(kCheapPrepend)
+  : reader_index_(kCheapPrepend),
+    writer_index_(kCheapPrepend),
+    initial_size_(initialize_size),
+    read_hint_(initial_read_hint(initialize_size)),
+    small_reads_(0),
+    slab_size_(0),
+    slab_bytes_(0)
 {
     assert(readable_bytes() == 0);
-    assert(writable_bytes() == initialize_size);
     assert(prependable_bytes() == kCheapPrepend);
 }
 
+Buffer::Buffer(Buffer&& rhs) noexcept
+  : reader_index_(kCheapPrepend),
+    writer_index_(kCheapPrepend),
+    initial_size_(rhs.initial_size_),
+    read_hint_(initial_read_hint(rhs.initial_size_)),
+    small_reads_(0),
+    slab_size_(0),
+    slab_bytes_(0)
+{
+    swap(rhs);
+}
+
+Buffer& Buffer::operator=(Buffer&& rhs) noexcept
+{
+    Buffer moved(std::move(rhs));
+    swap(moved);
+    return *this;
+}
+
 void Buffer::swap(Buffer& rhs)
 {
-    buffer_.swap(rhs.buffer_);
+    std::swap(head_, rhs.head_);
     std::swap(reader_index_, rhs.reader_index_);
     std::swap(writer_index_, rhs.writer_index_);
+    std::swap(initial_size_, rhs.initial_size_);
+    std::swap(read_hint_, rhs.read_hint_);
+    std::swap(small_reads_, rhs.small_reads_);
+    std::swap(slab_size_, rhs.slab_size_);
+    slabs_.swap(rhs.slabs_);
+    std::swap(slab_bytes_, rhs.slab_bytes_);
 }
 
 size_t Buffer::readable_bytes() const
 {
-    return writer_index_ - reader_index_;
+    return head_bytes() + slab_bytes_;
 }
 
 size_t Buffer::writable_bytes() const
 {
-    return buffer_.size() - writer_index_;
+    if (slabs_.empty())
+    {
+        return head_writable();
+    }
+    return slabs_.back().block.capacity() - slabs_.back().write;
 }
 
 size_t Buffer::prependable_bytes() const
@@ -43,54 +90,97 @@ size_t Buffer::prependable_bytes() const
 
 const char* Buffer::peek() const
 {
-    return begin() + reader_index_;
+    if (head_bytes() > 0 || slabs_.empty())
+    {
+        return begin() + reader_index_;
+    }
+    return slabs_.front().block.data() + slabs_.front().read;
 }
 
 const char* Buffer::findCRLF() const
 {
-    const char* crlf = std::search(peek(), begin_write(), kCRLF, kCRLF + 2);
-    return crlf == begin_write() ? nullptr : crlf;
+    return scan::find_crlf(peek(), peek() + contiguous_bytes());
 }
 
 const char* Buffer::findCRLF(const char* start) const
 {
+    const char* end = peek() + contiguous_bytes();
     assert(peek() <= start);
-    assert(start <= begin_write());
-    const char* crlf = std::search(start, begin_write(), kCRLF, kCRLF + 2);
-    return crlf == begin_write() ? nullptr : crlf;
+    assert(start <= end);
+    return scan::find_crlf(start, end);
 }
 
 const char* Buffer::findEOL() const
 {
-    const void* eol = memchr(peek(), '\n', readable_bytes());
-    return static_cast<const char*>(eol);
+    return scan::find_byte(peek(), peek() + contiguous_bytes(), '\n');
 }
 
 const char* Buffer::findEOL(const char* start) const
 {
+    const char* end = peek() + contiguous_bytes();
+    assert(peek() <= start);
+    assert(start <= end);
+    return scan::find_byte(start, end, '\n');
+}
+
+const char* Buffer::find(const std::string_view& delimiter) const
+{
+    return find(peek(), delimiter);
+}
+
+const char* Buffer::find(const char* start, const std::string_view& delimiter) const
+{
+    const char* end = peek() + contiguous_bytes();
     assert(peek() <= start);
-    assert(start <= begin_write());
-    const void* eol = memchr(start, '\n', begin_write() - start);
-    return static_cast<const char*>(eol);
+    assert(start <= end);
+    return scan::find_delimiter(start, end, delimiter.data(), delimiter.size());
+}
+
+size_t Buffer::find_all_of(const std::string_view& set, std::vector<size_t>* offsets) const
+{
+    size_t found = 0;
+    size_t base = 0;
+    if (head_bytes() > 0)
+    {
+        const char* begin_read = begin() + reader_index_;
+        found += scan::find_all_of(begin_read, begin_read + head_bytes(),
+                                   set.data(), set.size(), base, offsets);
+        base += head_bytes();
+    }
+    for (const auto& slab : slabs_)
+    {
+        const char* begin_read = slab.block.data() + slab.read;
+        found += scan::find_all_of(begin_read, begin_read + (slab.write - slab.read),
+                                   set.data(), set.size(), base, offsets);
+        base += slab.write - slab.read;
+    }
+    return found;
 }
 
 void Buffer::retrieve(size_t len)
 {
     assert(len <= readable_bytes());
-    if (len < readable_bytes())
+    if (len < head_bytes())
     {
         reader_index_ += len;
     }
-    else
+    else if (slabs_.empty() || len == readable_bytes())
     {
         retrieve_all();
     }
+    else
+    {
+        len -= head_bytes();
+        reader_index_ = kCheapPrepend;
+        writer_index_ = kCheapPrepend;
+        retrieve_from_slabs(len);
+    }
 }
 
 void Buffer::retrieve_until(const char* end)
 {
     assert(peek() <= end);
-    assert(end <= begin_write());
+    assert(end <= peek() + contiguous_bytes());
     retrieve(end - peek());
 }
 
@@ -118,6 +208,8 @@ void Buffer::retrieve_all()
 {
     reader_index_ = kCheapPrepend;
     writer_index_ = kCheapPrepend;
+    slabs_.clear();
+    slab_bytes_ = 0;
 }
 
 std::string Buffer::retrieve_all_as_string()
@@ -128,14 +220,23 @@ std::string Buffer::retrieve_all_as_string()
 std::string Buffer::retrieve_as_string(size_t len)
 {
     assert(len <= readable_bytes());
-    std::string result(peek(), len);
+    std::string result;
+    if (len <= contiguous_bytes())
+    {
+        result.assign(peek(), len);
+    }
+    else
+    {
+        result.resize(len);
+        peek_bytes(result.data(), len);
+    }
     retrieve(len);
     return result;
 }
 
 std::string_view Buffer::to_string_view() const
 {
-    return std::string_view(peek(), readable_bytes());
+    return std::string_view(peek(), contiguous_bytes());
 }
 
 void Buffer::append(const std::string_view& str)
@@ -145,6 +246,11 @@ void Buffer::append(const std::string_view& str)
 
 void Buffer::append(const char* data, size_t len)
 {
+    if (slab_size_ > 0 && (!slabs_.empty() || !head_fits(len)))
+    {
+        append_to_slabs(data, len);
+        return;
+    }
     ensure_writable_bytes(len);
     std::copy(data, data+len, begin_write());
     has_written(len);
@@ -157,6 +263,14 @@ void Buffer::append(const void* data, size_t len)
 
 void Buffer::ensure_writable_bytes(size_t len)
 {
+    if (slab_size_ > 0 && (!slabs_.empty() || !head_fits(len)))
+    {
+        if (slabs_.empty() || writable_bytes() < len)
+        {
+            slabs_.push_back(new_slab(len));
+        }
+        return;
+    }
     if (writable_bytes() < len)
     {
         make_space(len);
@@ -166,24 +280,50 @@ void Buffer::ensure_writable_bytes(size_t len)
 
 char* Buffer::begin_write()
 {
-    return begin() + writer_index_;
+    if (slabs_.empty())
+    {
+        return begin() + writer_index_;
+    }
+    return slabs_.back().block.data() + slabs_.back().write;
 }
 
 const char* Buffer::begin_write() const
 {
-    return begin() + writer_index_;
+    if (slabs_.empty())
+    {
+        return begin() + writer_index_;
+    }
+    return slabs_.back().block.data() + slabs_.back().write;
 }
 
 void Buffer::has_written(size_t len)
 {
     assert(len <= writable_bytes());
-    writer_index_ += len;
+    if (slabs_.empty())
+    {
+        writer_index_ += len;
+    }
+    else
+    {
+        slabs_.back().write += len;
+        slab_bytes_ += len;
+    }
 }
 
+// only reaches back into the last slab
 void Buffer::unwrite(size_t len)
 {
-    assert(len <= readable_bytes());
-    writer_index_ -= len;
+    if (slabs_.empty())
+    {
+        assert(len <= readable_bytes());
+        writer_index_ -= len;
+    }
+    else
+    {
+        assert(len <= slabs_.back().write - slabs_.back().read);
+        slabs_.back().write -= len;
+        slab_bytes_ -= len;
+    }
 }
 
 void Buffer::append_int64(int64_t x)
@@ -241,7 +381,7 @@ int64_t Buffer::peek_int64() const
 {
     assert(readable_bytes() >= sizeof(int64_t));
     int64_t be64 = 0;
-    ::memcpy(&be64, peek(), sizeof(be64));
+    peek_bytes(&be64, sizeof(be64));
     return sockets::network_to_host64(be64);
 }
 
@@ -249,7 +389,7 @@ int32_t Buffer::peek_int32() const
 {
     assert(readable_bytes() >= sizeof(int32_t));
     int32_t be32 = 0;
-    ::memcpy(&be32, peek(), sizeof(be32));
+    peek_bytes(&be32, sizeof(be32));
     return sockets::network_to_host32(be32);
 }
 
@@ -257,7 +397,7 @@ int16_t Buffer::peek_int16() const
 {
     assert(readable_bytes() >= sizeof(int16_t));
     int16_t be16 = 0;
-    ::memcpy(&be16, peek(), sizeof(be16));
+    peek_bytes(&be16, sizeof(be16));
     return sockets::network_to_host16(be16);
 }
 
@@ -295,6 +435,10 @@ void Buffer::prepend_int8(int8_t x)
 void Buffer::prepend(const void* data, size_t len)
 {
     assert(len <= prependable_bytes());
+    if (!head_)
+    {
+        make_space(0);
+    }
     reader_index_ -= len;
     const char* d = static_cast<const char*>(data);
     std::copy(d, d+len, begin()+reader_index_);
@@ -304,31 +448,55 @@ void Buffer::shrink(size_t reserve)
 {
     Buffer other;
     other.ensure_writable_bytes(readable_bytes() + reserve);
-    other.append(to_string_view());
+    peek_bytes(other.begin_write(), readable_bytes());
+    other.has_written(readable_bytes());
+    other.slab_size_ = slab_size_;
     swap(other);
 }
 
 size_t Buffer::internal_capacity() const
 {
-    return buffer_.capacity();
+    size_t capacity = head_.capacity();
+    for (const auto& slab : slabs_)
+    {
+        capacity += slab.block.capacity();
+    }
+    return capacity;
+}
+
+void Buffer::release()
+{
+    retrieve_all();
+    head_.reset();
 }
 
 ssize_t Buffer::read_fd(int fd, int* saved_errno)
 {
-    char extrabuf[65536];
+    if (slab_size_ > 0)
+    {
+        return read_fd_segmented(fd, saved_errno);
+    }
+
+    if (writable_bytes() < read_hint_)
+    {
+        make_space(read_hint_);
+    }
+
+    char* overflow = BufferPool::overflow_area();
     struct iovec vec[2];
     const size_t writable = writable_bytes();
 
     vec[0].iov_base = begin() + writer_index_;
     vec[0].iov_len = writable;
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    vec[1].iov_base = overflow;
+    vec[1].iov_len = BufferPool::kOverflowSize;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < BufferPool::kOverflowSize) ? 2 : 1;
     const ssize_t n = sockets::readv(fd, vec, iovcnt);
     if (n < 0)
     {
         *saved_errno = errno;
+        return n;
     }
     else if (static_cast<size_t>(n) <= writable)
     {
@@ -336,40 +504,327 @@ ssize_t Buffer::read_fd(int fd, int* saved_errno)
     }
     else
     {
-        writer_index_ = buffer_.size();
-        append(extrabuf, n-writable);
+        writer_index_ += writable;
+        append(overflow, n-writable);
+        BufferPool::count_overflow(n-writable);
+    }
+    adapt_read_size(n, writable);
+
+    return n;
+}
+
+size_t Buffer::read_size_hint() const
+{
+    return read_hint_;
+}
+
+ssize_t Buffer::write_fd(int fd, int* saved_errno, size_t max_bytes)
+{
+    const size_t len = std::min(readable_bytes(), max_bytes);
+    ssize_t n = 0;
+    if (len <= contiguous_bytes())
+    {
+        n = sockets::write(fd, peek(), len);
+    }
+    else
+    {
+        struct iovec vec[kMaxWriteSegments];
+        int count = readable_segments(vec, kMaxWriteSegments);
+        size_t total = 0;
+        int used = 0;
+        for (; used < count && total < len; ++used)
+        {
+            vec[used].iov_len = std::min(vec[used].iov_len, len - total);
+            total += vec[used].iov_len;
+        }
+        n = sockets::writev(fd, vec, used);
     }
 
+    if (n < 0)
+    {
+        *saved_errno = errno;
+    }
+    else
+    {
+        retrieve(n);
+    }
     return n;
 }
 
+void Buffer::set_slab_size(size_t slab_size)
+{
+    assert(slabs_.empty());
+    slab_size_ = slab_size;
+}
+
+size_t Buffer::slab_size() const
+{
+    return slab_size_;
+}
+
+size_t Buffer::slab_count() const
+{
+    return slabs_.size();
+}
+
+size_t Buffer::contiguous_bytes() const
+{
+    if (head_bytes() > 0 || slabs_.empty())
+    {
+        return head_bytes();
+    }
+    return slabs_.front().write - slabs_.front().read;
+}
+
+void Buffer::peek_bytes(void* dst, size_t len, size_t offset) const
+{
+    assert(offset + len <= readable_bytes());
+    char* out = static_cast<char*>(dst);
+    if (offset < head_bytes())
+    {
+        size_t n = std::min(len, head_bytes() - offset);
+        ::memcpy(out, begin() + reader_index_ + offset, n);
+        out += n;
+        len -= n;
+        offset = 0;
+    }
+    else
+    {
+        offset -= head_bytes();
+    }
+
+    for (auto it = slabs_.begin(); len > 0; ++it)
+    {
+        size_t available = it->write - it->read;
+        if (offset >= available)
+        {
+            offset -= available;
+            continue;
+        }
+        size_t n = std::min(len, available - offset);
+        ::memcpy(out, it->block.data() + it->read + offset, n);
+        out += n;
+        len -= n;
+        offset = 0;
+    }
+}
+
+const char* Buffer::pullup(size_t len)
+{
+    assert(len <= readable_bytes());
+    if (len <= contiguous_bytes())
+    {
+        return peek();
+    }
+
+    // moves the missing bytes from the slabs into the head
+    size_t missing = len - head_bytes();
+    if (head_writable() < missing)
+    {
+        make_space(missing);
+    }
+    peek_bytes(begin() + writer_index_, missing, head_bytes());
+    writer_index_ += missing;
+    retrieve_from_slabs(missing);
+    return peek();
+}
+
+int Buffer::readable_segments(struct iovec* iov, int max_iov) const
+{
+    int count = 0;
+    if (head_bytes() > 0 && count < max_iov)
+    {
+        iov[count].iov_base = const_cast<char*>(begin() + reader_index_);
+        iov[count].iov_len = head_bytes();
+        ++count;
+    }
+    for (auto it = slabs_.begin(); it != slabs_.end() && count < max_iov; ++it)
+    {
+        if (it->write > it->read)
+        {
+            iov[count].iov_base = it->block.data() + it->read;
+            iov[count].iov_len = it->write - it->read;
+            ++count;
+        }
+    }
+    return count;
+}
+
 char* Buffer::begin()
 {
-    return buffer_.data();
+    return head_ ? head_.data() : g_no_storage;
 }
 
 const char* Buffer::begin() const
 {
-    return buffer_.data();
+    return head_ ? head_.data() : g_no_storage;
 }
 
+// only ever grows the head, slabs never move
 void Buffer::make_space(size_t len)
 {
-    if (writable_bytes() + prependable_bytes() < len + kCheapPrepend)
+    if (!head_)
     {
-        buffer_.resize(writer_index_+len);
+        head_ = BufferBlock(kCheapPrepend + std::max(len, initial_size_));
+        reader_index_ = kCheapPrepend;
+        writer_index_ = kCheapPrepend;
+    }
+    else if (head_writable() + prependable_bytes() < len + kCheapPrepend)
+    {
+        // twice the size at least, like vector growth, the readable
+        //  bytes move to the front of the new block
+        size_t readable = head_bytes();
+        BufferBlock block(std::max(2 * head_.capacity(), kCheapPrepend + readable + len));
+        ::memcpy(block.data() + kCheapPrepend, begin() + reader_index_, readable);
+        head_ = std::move(block);
+        reader_index_ = kCheapPrepend;
+        writer_index_ = reader_index_ + readable;
     }
     else
     {
         assert(kCheapPrepend < reader_index_);
-        size_t readable = readable_bytes();
+        size_t readable = head_bytes();
         std::copy(begin()+reader_index_,
                   begin()+writer_index_,
                   begin()+kCheapPrepend);
         reader_index_ = kCheapPrepend;
         writer_index_ = reader_index_ + readable;
-        assert(readable == readable_bytes());
+        assert(readable == head_bytes());
+    }
+}
+
+size_t Buffer::head_bytes() const
+{
+    return writer_index_ - reader_index_;
+}
+
+size_t Buffer::head_writable() const
+{
+    return head_ ? head_.capacity() - writer_index_ : 0;
+}
+
+// the head grows up to one slab
+bool Buffer::head_fits(size_t len) const
+{
+    return head_writable() >= len
+        || head_bytes() + len + kCheapPrepend <= std::max(head_.capacity(), kCheapPrepend + slab_size_);
+}
+
+void Buffer::append_to_slabs(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        if (slabs_.empty() || slabs_.back().write == slabs_.back().block.capacity())
+        {
+            slabs_.push_back(new_slab(slab_size_));
+        }
+        Slab& tail = slabs_.back();
+        size_t n = std::min(len, tail.block.capacity() - tail.write);
+        ::memcpy(tail.block.data() + tail.write, data, n);
+        tail.write += n;
+        slab_bytes_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void Buffer::retrieve_from_slabs(size_t len)
+{
+    assert(len <= slab_bytes_);
+    slab_bytes_ -= len;
+    while (!slabs_.empty())
+    {
+        Slab& front = slabs_.front();
+        size_t n = std::min(len, front.write - front.read);
+        front.read += n;
+        len -= n;
+        if (front.read < front.write)
+        {
+            break;
+        }
+        slabs_.pop_front();
+    }
+    assert(len == 0);
+}
+
+Buffer::Slab Buffer::new_slab(size_t min_capacity)
+{
+    Slab slab;
+    slab.block = BufferBlock(std::max(min_capacity, slab_size_));
+    return slab;
+}
+
+void Buffer::adapt_read_size(size_t n, size_t offered)
+{
+    if (n >= offered)
+    {
+        read_hint_ = std::min(std::max(2 * read_hint_, n), kMaxReadSize);
+        small_reads_ = 0;
+    }
+    else if (n < read_hint_ / 2)
+    {
+        if (++small_reads_ >= 2)
+        {
+            read_hint_ = std::max(read_hint_ / 2, kMinReadSize);
+            small_reads_ = 0;
+        }
+    }
+    else
+    {
+        small_reads_ = 0;
+    }
+}
+
+/**
+ * the tail and one fresh slab with readv. when the total still fits in
+ *  a slab the new bytes are moved into the head, so small messages stay
+ *  contiguous just like with the stack buffer of read_fd
+*/
+ssize_t Buffer::read_fd_segmented(int fd, int* saved_errno)
+{
+    Slab fresh = new_slab(slab_size_);
+    struct iovec vec[2];
+    const size_t writable = writable_bytes();
+    int iovcnt = 0;
+    if (writable > 0)
+    {
+        vec[iovcnt].iov_base = begin_write();
+        vec[iovcnt].iov_len = writable;
+        ++iovcnt;
+    }
+    vec[iovcnt].iov_base = fresh.block.data();
+    vec[iovcnt].iov_len = fresh.block.capacity();
+    ++iovcnt;
+
+    const ssize_t n = sockets::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saved_errno = errno;
+        return n;
+    }
+
+    const size_t in_tail = std::min(static_cast<size_t>(n), writable);
+    has_written(in_tail);
+    fresh.write = n - in_tail;
+    if (fresh.write == 0)
+    {
+        // unused, back to the pool when it goes out of scope
     }
+    else if (slabs_.empty() && head_fits(fresh.write))
+    {
+        if (head_writable() < fresh.write)
+        {
+            make_space(fresh.write);
+        }
+        ::memcpy(begin() + writer_index_, fresh.block.data(), fresh.write);
+        writer_index_ += fresh.write;
+    }
+    else
+    {
+        slab_bytes_ += fresh.write;
+        slabs_.push_back(std::move(fresh));
+    }
+    return n;
 }
 
 } // namespace icarus
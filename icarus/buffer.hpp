@@ -1,10 +1,16 @@
 #ifndef ICARUS_BUFFER_HPP
 #define ICARUS_BUFFER_HPP
 
+#include <list>
 #include <vector>
 #include <string>
 #include <string_view>
 #include <cstdint>
+#include <sys/types.h>
+
+#include "bufferpool.hpp"
+
+struct iovec;
 
 namespace icarus
 {
@@ -13,9 +19,19 @@ class Buffer
   public:
     static constexpr size_t kCheapPrepend = 8;
     static constexpr size_t kInitialSize = 1024;
+    static constexpr size_t kDefaultSlabSize = 64 * 1024;
+
+    // bounds of the read size read_fd learns, see read_size_hint
+    static constexpr size_t kMinReadSize = 256;
+    static constexpr size_t kMaxReadSize = BufferPool::kOverflowSize;
 
+    // no storage until the first write, which takes at least
+    //  initial_size bytes from the BufferPool
     explicit Buffer(size_t initial_size = kInitialSize);
 
+    Buffer(Buffer&& rhs) noexcept;
+    Buffer& operator=(Buffer&& rhs) noexcept;
+
     void swap(Buffer& rhs);
 
     size_t readable_bytes() const;
@@ -29,6 +45,14 @@ class Buffer
     const char* findEOL() const;
     const char* findEOL(const char* start) const;
 
+    // first occurrence of delimiter, like the finds above
+    const char* find(const std::string_view& delimiter) const;
+    const char* find(const char* start, const std::string_view& delimiter) const;
+
+    // appends the offset from peek() of every readable byte that is one
+    //  of the bytes in set, slabs included, returns how many were found
+    size_t find_all_of(const std::string_view& set, std::vector<size_t>* offsets) const;
+
     void retrieve(size_t len);
     void retrieve_until(const char* end);
     void retrieve_int64();
@@ -78,19 +102,88 @@ class Buffer
 
     size_t internal_capacity() const;
 
+    // drops the content and hands all storage back to the BufferPool of
+    //  the calling thread's loop, the next write allocates again
+    void release();
+
+    /**
+     * reads into the writable bytes, what does not fit lands in the loop's
+     *  overflow area and is appended from there, see BufferPool
+     *
+     * each read first makes room for read_size_hint bytes. the hint
+     *  doubles, or jumps to the read size, whenever a read fills all that
+     *  was offered, and halves after two reads in a row below half of it,
+     *  so in steady state a message goes straight into the buffer
+    */
     ssize_t read_fd(int fd, int* saved_errno);
+    size_t read_size_hint() const;
+
+    // writes out up to max_bytes readable bytes and retrieves what the
+    //  kernel took
+    ssize_t write_fd(int fd, int* saved_errno, size_t max_bytes = SIZE_MAX);
+
+    /**
+     * segmented mode, on while slab_size is not 0
+     *
+     * the contiguous part stops growing at one slab, bytes beyond it go
+     *  to a chain of fixed-size slabs. read_fd reads into fresh slabs
+     *  with readv, write_fd flushes several with one writev and nothing
+     *  is ever reallocated. while less than a slab is buffered read_fd
+     *  keeps everything contiguous and the buffer behaves as before.
+     *  beyond that peek() reaches contiguous_bytes() only, and so do the
+     *  find functions and to_string_view. retrieve, the int readers and
+     *  peek_bytes work across slab boundaries, pullup joins a prefix.
+    */
+    // only while empty
+    void set_slab_size(size_t slab_size);
+    size_t slab_size() const;
+    size_t slab_count() const;
+
+    // bytes readable at peek() in one piece
+    size_t contiguous_bytes() const;
+
+    // copies len bytes starting offset bytes past peek()
+    void peek_bytes(void* dst, size_t len, size_t offset = 0) const;
+
+    // makes the first len readable bytes contiguous, returns peek()
+    const char* pullup(size_t len);
+
+    // readable bytes as up to max_iov pieces in order, returns the count
+    int readable_segments(struct iovec* iov, int max_iov) const;
 
   private:
+    struct Slab
+    {
+        BufferBlock block;
+        size_t read = 0;
+        size_t write = 0;
+    };
+
     char* begin();
     const char* begin() const;
     void make_space(size_t len);
 
+    size_t head_bytes() const;
+    size_t head_writable() const;
+    bool head_fits(size_t len) const;
+    void append_to_slabs(const char* data, size_t len);
+    void retrieve_from_slabs(size_t len);
+    Slab new_slab(size_t min_capacity);
+    ssize_t read_fd_segmented(int fd, int* saved_errno);
+    void adapt_read_size(size_t n, size_t offered);
+
   private:
-    std::vector<char> buffer_;
+    BufferBlock head_;          // empty until written, and after release
     size_t reader_index_;
     size_t writer_index_;
-
-    static const char kCRLF[];
+    size_t initial_size_;
+    size_t read_hint_;
+    int small_reads_;           // in a row, below half of read_hint_
+
+    size_t slab_size_;
+    std::list<Slab> slabs_;     // bytes after the contiguous part, a
+                                //  deque would allocate even while empty
+    size_t slab_bytes_;         // readable bytes in slabs_
 };
 } // namespace icarus
 
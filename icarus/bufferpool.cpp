@@ -0,0 +1,271 @@
+#include <new>
+#include <cassert>
+#include <utility>
+#include <unistd.h>
+
+#include "eventloop.hpp"
+#include "bufferpool.hpp"
+
+using namespace icarus;
+
+namespace
+{
+// octave of kMinBlockSize
+constexpr int kMinShift = 8;
+
+BufferPool *current_pool()
+{
+    EventLoop *loop = EventLoop::get_event_loop_of_current_thread();
+    return loop ? &loop->buffer_pool() : nullptr;
+}
+
+// overflow area of threads without a loop
+thread_local std::unique_ptr<char[]> t_overflow;
+
+void bump(std::atomic<std::uint64_t> &counter, std::int64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+} // namespace
+
+void BufferPoolStats::merge(const BufferPoolStats &other)
+{
+    hits += other.hits;
+    misses += other.misses;
+    cached_blocks += other.cached_blocks;
+    cached_bytes += other.cached_bytes;
+    overflow_copies += other.overflow_copies;
+    overflow_bytes += other.overflow_bytes;
+}
+
+BufferPool::BufferPool()
+  : max_cached_bytes_(kDefaultMaxCachedBytes),
+    hits_(0),
+    misses_(0),
+    cached_blocks_(0),
+    cached_bytes_(0),
+    overflow_copies_(0),
+    overflow_bytes_(0)
+{
+    static_assert(kMinBlockSize == 1u << kMinShift);
+}
+
+BufferPool::~BufferPool()
+{
+    for (auto &blocks : free_)
+    {
+        for (char *block : blocks)
+        {
+            ::operator delete(block);
+        }
+    }
+}
+
+std::size_t BufferPool::block_size(std::size_t size)
+{
+    return size > kMaxBlockSize ? size : class_size(class_of(size));
+}
+
+char *BufferPool::allocate(std::size_t size, std::size_t *capacity)
+{
+    if (size > kMaxBlockSize)
+    {
+        *capacity = size;
+        return static_cast<char *>(::operator new(size));
+    }
+
+    std::size_t size_class = class_of(size);
+    *capacity = class_size(size_class);
+    BufferPool *pool = current_pool();
+    if (pool)
+    {
+        if (char *block = pool->pop(size_class))
+        {
+            return block;
+        }
+    }
+    return static_cast<char *>(::operator new(*capacity));
+}
+
+void BufferPool::deallocate(char *block, std::size_t capacity)
+{
+    if (capacity <= kMaxBlockSize)
+    {
+        BufferPool *pool = current_pool();
+        if (pool && pool->push(class_of(capacity), block))
+        {
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+char *BufferPool::overflow_area()
+{
+    BufferPool *pool = current_pool();
+    std::unique_ptr<char[]> &area = pool ? pool->overflow_ : t_overflow;
+    if (!area)
+    {
+        area.reset(new char[kOverflowSize]);
+    }
+    return area.get();
+}
+
+void BufferPool::count_overflow(std::size_t bytes)
+{
+    if (BufferPool *pool = current_pool())
+    {
+        bump(pool->overflow_copies_, 1);
+        bump(pool->overflow_bytes_, static_cast<std::int64_t>(bytes));
+    }
+}
+
+void BufferPool::set_max_cached_bytes(std::size_t bytes)
+{
+    max_cached_bytes_ = bytes;
+    for (std::size_t size_class = kClasses; size_class-- > 0; )
+    {
+        auto &free = free_[size_class];
+        while (!free.empty() && cached_bytes_.load(std::memory_order_relaxed) > max_cached_bytes_)
+        {
+            ::operator delete(free.back());
+            free.pop_back();
+            bump(cached_blocks_, -1);
+            bump(cached_bytes_, -static_cast<std::int64_t>(class_size(size_class)));
+        }
+    }
+}
+
+std::size_t BufferPool::max_cached_bytes() const
+{
+    return max_cached_bytes_;
+}
+
+void BufferPool::prefault(std::size_t size, std::size_t count)
+{
+    if (size > kMaxBlockSize)
+    {
+        return;
+    }
+    std::size_t size_class = class_of(size);
+    std::size_t bytes = class_size(size_class);
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        char *block = static_cast<char *>(::operator new(bytes));
+        for (std::size_t offset = 0; offset < bytes; offset += page)
+        {
+            // volatile so the stores are not dropped
+            static_cast<volatile char *>(block)[offset] = 0;
+        }
+        static_cast<volatile char *>(block)[bytes - 1] = 0;
+        if (!push(size_class, block))
+        {
+            ::operator delete(block);
+            break;
+        }
+    }
+}
+
+BufferPoolStats BufferPool::stats() const
+{
+    BufferPoolStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.cached_blocks = cached_blocks_.load(std::memory_order_relaxed);
+    stats.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+    stats.overflow_copies = overflow_copies_.load(std::memory_order_relaxed);
+    stats.overflow_bytes = overflow_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// class 0 holds kMinBlockSize, then four classes per power of two,
+//  the n-th of which ends n quarters above it: 320, 384, 448, 512, 640 ...
+std::size_t BufferPool::class_of(std::size_t size)
+{
+    if (size <= kMinBlockSize)
+    {
+        return 0;
+    }
+    int octave = 63 - __builtin_clzll(size - 1);
+    std::size_t base = std::size_t(1) << octave;
+    std::size_t quarter = (size - 1 - base) / (base / 4);
+    return (octave - kMinShift) * 4 + quarter + 1;
+}
+
+std::size_t BufferPool::class_size(std::size_t size_class)
+{
+    if (size_class == 0)
+    {
+        return kMinBlockSize;
+    }
+    std::size_t base = std::size_t(1) << (kMinShift + (size_class - 1) / 4);
+    return base + ((size_class - 1) % 4 + 1) * (base / 4);
+}
+
+char *BufferPool::pop(std::size_t size_class)
+{
+    auto &free = free_[size_class];
+    if (free.empty())
+    {
+        bump(misses_, 1);
+        return nullptr;
+    }
+    char *block = free.back();
+    free.pop_back();
+    bump(hits_, 1);
+    bump(cached_blocks_, -1);
+    bump(cached_bytes_, -static_cast<std::int64_t>(class_size(size_class)));
+    return block;
+}
+
+bool BufferPool::push(std::size_t size_class, char *block)
+{
+    std::size_t bytes = class_size(size_class);
+    if (cached_bytes_.load(std::memory_order_relaxed) + bytes > max_cached_bytes_)
+    {
+        return false;
+    }
+    free_[size_class].push_back(block);
+    bump(cached_blocks_, 1);
+    bump(cached_bytes_, static_cast<std::int64_t>(bytes));
+    return true;
+}
+
+BufferBlock::BufferBlock(std::size_t size)
+{
+    // in the body, the initializer of capacity_ would run after data_'s
+    data_ = BufferPool::allocate(size, &capacity_);
+}
+
+BufferBlock::BufferBlock(BufferBlock &&rhs) noexcept
+  : data_(std::exchange(rhs.data_, nullptr)),
+    capacity_(std::exchange(rhs.capacity_, 0))
+{
+}
+
+BufferBlock &BufferBlock::operator=(BufferBlock &&rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        reset();
+        data_ = std::exchange(rhs.data_, nullptr);
+        capacity_ = std::exchange(rhs.capacity_, 0);
+    }
+    return *this;
+}
+
+BufferBlock::~BufferBlock()
+{
+    reset();
+}
+
+void BufferBlock::reset()
+{
+    if (data_)
+    {
+        BufferPool::deallocate(data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+}
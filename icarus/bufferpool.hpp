@@ -0,0 +1,130 @@
+#ifndef ICARUS_BUFFERPOOL_HPP
+#define ICARUS_BUFFERPOOL_HPP
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.hpp"
+
+namespace icarus
+{
+struct BufferPoolStats
+{
+    std::uint64_t hits = 0;          // served from the free lists
+    std::uint64_t misses = 0;        // went to operator new
+    std::uint64_t cached_blocks = 0;
+    std::uint64_t cached_bytes = 0;
+    std::uint64_t overflow_copies = 0;  // reads that spilled past a Buffer
+    std::uint64_t overflow_bytes = 0;   // and the bytes copied back
+
+    void merge(const BufferPoolStats &other);
+};
+
+/**
+ * size-class free lists for Buffer storage, one pool per EventLoop
+ *
+ * classes go from 256 bytes to 4 MiB in four steps per power of two,
+ *  larger blocks always use the heap. like FramePool every block is a
+ *  plain operator new allocation, allocate and deallocate use the pool
+ *  of the loop running in the calling thread, or the heap when there is
+ *  none, so a block may be freed in any thread.
+*/
+class BufferPool : noncopyable
+{
+  public:
+    static constexpr std::size_t kMinBlockSize = 256;
+    static constexpr std::size_t kMaxBlockSize = 4 * 1024 * 1024;
+    static constexpr std::size_t kDefaultMaxCachedBytes = 64 * 1024 * 1024;
+    static constexpr std::size_t kOverflowSize = 64 * 1024;
+
+    BufferPool();
+    ~BufferPool();
+
+    // capacity of the block allocate(size) returns
+    static std::size_t block_size(std::size_t size);
+
+    static char *allocate(std::size_t size, std::size_t *capacity);
+    static void deallocate(char *block, std::size_t capacity);
+
+    // kOverflowSize bytes of scratch space that Buffer::read_fd reads
+    //  into past the end of a buffer, shared by all buffers of the calling
+    //  thread's loop. the bytes must be copied out before returning to it
+    static char *overflow_area();
+
+    // records a read that spilled bytes into the overflow area
+    static void count_overflow(std::size_t bytes);
+
+    // bytes kept in the free lists, loop thread only
+    void set_max_cached_bytes(std::size_t bytes);
+    std::size_t max_cached_bytes() const;
+
+    // puts count blocks for size into the free lists with every page
+    //  touched, as far as max_cached_bytes allows. loop thread only
+    void prefault(std::size_t size, std::size_t count);
+
+    // thread safe
+    BufferPoolStats stats() const;
+
+  private:
+    static constexpr std::size_t kClasses = 57;
+
+    static std::size_t class_of(std::size_t size);
+    static std::size_t class_size(std::size_t size_class);
+
+    char *pop(std::size_t size_class);
+    bool push(std::size_t size_class, char *block);
+
+    std::size_t max_cached_bytes_;
+    std::array<std::vector<char *>, kClasses> free_;
+    // written by the loop thread only
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> cached_blocks_;
+    std::atomic<std::uint64_t> cached_bytes_;
+    std::atomic<std::uint64_t> overflow_copies_;
+    std::atomic<std::uint64_t> overflow_bytes_;
+    std::unique_ptr<char[]> overflow_;   // allocated on first use
+};
+
+// move-only owner of one block of pool storage
+class BufferBlock
+{
+  public:
+    BufferBlock() = default;
+
+    // at least size bytes
+    explicit BufferBlock(std::size_t size);
+
+    BufferBlock(BufferBlock &&rhs) noexcept;
+    BufferBlock &operator=(BufferBlock &&rhs) noexcept;
+    ~BufferBlock();
+
+    char *data() const
+    {
+        return data_;
+    }
+
+    std::size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    explicit operator bool() const
+    {
+        return data_ != nullptr;
+    }
+
+    // back to the pool of the calling thread's loop
+    void reset();
+
+  private:
+    char *data_ = nullptr;
+    std::size_t capacity_ = 0;
+};
+} // namespace icarus
+
+#endif // ICARUS_BUFFERPOOL_HPP
@@ -0,0 +1,357 @@
+#include <cstring>
+#include <cstdint>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "bytescan.hpp"
+
+namespace icarus::scan
+{
+namespace
+{
+struct Kernels
+{
+    const char *(*find_delimiter)(const char *, const char *, const char *, std::size_t);
+    std::size_t (*find_all_of)(const char *, const char *, const char *, std::size_t,
+                               std::size_t, std::vector<std::size_t> *);
+};
+
+// sets up to this size are compared byte by byte in the vector kernels,
+//  larger ones go through the table of the scalar kernel
+constexpr std::size_t kMaxVectorSet = 16;
+
+// delimiters up to this size, "\r\n" among them, are found faster with
+//  memchr and a compare than with the vector kernels, bytescan_bench
+constexpr std::size_t kMaxScalarDelimiter = 2;
+
+const char *find_delimiter_scalar(const char *begin, const char *end,
+                                  const char *delim, std::size_t len)
+{
+    if (len == 0)
+    {
+        return begin;
+    }
+    if (static_cast<std::size_t>(end - begin) < len)
+    {
+        return nullptr;
+    }
+    const char *last = end - len;
+    for (const char *p = begin; p <= last; ++p)
+    {
+        p = static_cast<const char *>(::memchr(p, delim[0], last - p + 1));
+        if (!p)
+        {
+            return nullptr;
+        }
+        if (::memcmp(p + 1, delim + 1, len - 1) == 0)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t find_all_of_scalar(const char *begin, const char *end,
+                               const char *set, std::size_t set_len,
+                               std::size_t base, std::vector<std::size_t> *offsets)
+{
+    bool in_set[256] = {};
+    for (std::size_t i = 0; i < set_len; ++i)
+    {
+        in_set[static_cast<unsigned char>(set[i])] = true;
+    }
+    std::size_t found = 0;
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (in_set[static_cast<unsigned char>(*p)])
+        {
+            offsets->push_back(base + (p - begin));
+            ++found;
+        }
+    }
+    return found;
+}
+
+constexpr Kernels kScalarKernels = {
+    find_delimiter_scalar,
+    find_all_of_scalar
+};
+
+#if defined(__x86_64__)
+
+// every set bit of mask is a match at base plus its index
+std::size_t push_matches(std::uint32_t mask, std::size_t base, std::vector<std::size_t> *offsets)
+{
+    std::size_t found = 0;
+    while (mask)
+    {
+        offsets->push_back(base + __builtin_ctz(mask));
+        mask &= mask - 1;
+        ++found;
+    }
+    return found;
+}
+
+// SSE2 is part of x86-64, no dispatch needed
+
+/**
+ * candidates are the positions whose first and last byte both match,
+ *  only those are compared in full. a block tests the 16 candidates at p
+ *  with loads up to p + 15 + len - 1. a block without any first byte
+ *  hands over to memchr, vectorized by the libc already, so sparse text
+ *  goes at memchr speed and dense text a block at a time
+*/
+const char *find_delimiter_sse2(const char *begin, const char *end,
+                                const char *delim, std::size_t len)
+{
+    if (len <= kMaxScalarDelimiter)
+    {
+        return find_delimiter_scalar(begin, end, delim, len);
+    }
+    const __m128i first = _mm_set1_epi8(delim[0]);
+    const __m128i last = _mm_set1_epi8(delim[len - 1]);
+    const char *p = begin;
+    while (static_cast<std::size_t>(end - p) >= 16 + len - 1)
+    {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i starts = _mm_cmpeq_epi8(head, first);
+        if (_mm_movemask_epi8(starts) == 0)
+        {
+            // nothing here, memchr finds the next first byte faster
+            p = static_cast<const char *>(::memchr(p + 16, delim[0], end - p - 16 - (len - 1)));
+            if (!p)
+            {
+                return nullptr;
+            }
+            continue;
+        }
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + len - 1));
+        std::uint32_t mask = _mm_movemask_epi8(_mm_and_si128(starts, _mm_cmpeq_epi8(tail, last)));
+        for (; mask; mask &= mask - 1)
+        {
+            int i = __builtin_ctz(mask);
+            if (::memcmp(p + i + 1, delim + 1, len - 2) == 0)
+            {
+                return p + i;
+            }
+        }
+        p += 16;
+    }
+    return find_delimiter_scalar(p, end, delim, len);
+}
+
+std::size_t find_all_of_sse2(const char *begin, const char *end,
+                             const char *set, std::size_t set_len,
+                             std::size_t base, std::vector<std::size_t> *offsets)
+{
+    if (set_len == 0 || set_len > kMaxVectorSet)
+    {
+        return find_all_of_scalar(begin, end, set, set_len, base, offsets);
+    }
+    __m128i needles[kMaxVectorSet];
+    for (std::size_t i = 0; i < set_len; ++i)
+    {
+        needles[i] = _mm_set1_epi8(set[i]);
+    }
+    std::size_t found = 0;
+    const char *p = begin;
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+        for (std::size_t i = 1; i < set_len; ++i)
+        {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+        }
+        found += push_matches(_mm_movemask_epi8(hits), base + (p - begin), offsets);
+    }
+    return found + find_all_of_scalar(p, end, set, set_len, base + (p - begin), offsets);
+}
+
+constexpr Kernels kSse2Kernels = {
+    find_delimiter_sse2,
+    find_all_of_sse2
+};
+
+// the same with two 32 byte blocks at a time, only called when the cpu
+//  has AVX2
+
+__attribute__((target("avx2")))
+const char *find_delimiter_avx2(const char *begin, const char *end,
+                                const char *delim, std::size_t len)
+{
+    if (len <= kMaxScalarDelimiter)
+    {
+        return find_delimiter_scalar(begin, end, delim, len);
+    }
+    const __m256i first = _mm256_set1_epi8(delim[0]);
+    const __m256i last = _mm256_set1_epi8(delim[len - 1]);
+    const char *p = begin;
+    while (static_cast<std::size_t>(end - p) >= 64 + len - 1)
+    {
+        __m256i starts[2];
+        for (int half = 0; half < 2; ++half)
+        {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32 * half));
+            starts[half] = _mm256_cmpeq_epi8(head, first);
+        }
+        __m256i any = _mm256_or_si256(starts[0], starts[1]);
+        if (_mm256_testz_si256(any, any))
+        {
+            // nothing here, memchr finds the next first byte faster
+            p = static_cast<const char *>(::memchr(p + 64, delim[0], end - p - 64 - (len - 1)));
+            if (!p)
+            {
+                return nullptr;
+            }
+            continue;
+        }
+        for (int half = 0; half < 2; ++half)
+        {
+            const char *at = p + 32 * half;
+            __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at + len - 1));
+            std::uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(starts[half],
+                                                                       _mm256_cmpeq_epi8(tail, last)));
+            for (; mask; mask &= mask - 1)
+            {
+                int i = __builtin_ctz(mask);
+                if (::memcmp(at + i + 1, delim + 1, len - 2) == 0)
+                {
+                    return at + i;
+                }
+            }
+        }
+        p += 64;
+    }
+    return find_delimiter_sse2(p, end, delim, len);
+}
+
+__attribute__((target("avx2")))
+std::size_t find_all_of_avx2(const char *begin, const char *end,
+                             const char *set, std::size_t set_len,
+                             std::size_t base, std::vector<std::size_t> *offsets)
+{
+    if (set_len == 0 || set_len > kMaxVectorSet)
+    {
+        return find_all_of_scalar(begin, end, set, set_len, base, offsets);
+    }
+    __m256i needles[kMaxVectorSet];
+    for (std::size_t i = 0; i < set_len; ++i)
+    {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+    std::size_t found = 0;
+    const char *p = begin;
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i hits = _mm256_cmpeq_epi8(block, needles[0]);
+        for (std::size_t i = 1; i < set_len; ++i)
+        {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[i]));
+        }
+        found += push_matches(_mm256_movemask_epi8(hits), base + (p - begin), offsets);
+    }
+    return found + find_all_of_sse2(p, end, set, set_len, base + (p - begin), offsets);
+}
+
+constexpr Kernels kAvx2Kernels = {
+    find_delimiter_avx2,
+    find_all_of_avx2
+};
+
+#endif // __x86_64__
+
+const Kernels *kernels_of(Level level)
+{
+#if defined(__x86_64__)
+    switch (level)
+    {
+    case Level::kAvx2:
+        return &kAvx2Kernels;
+
+    case Level::kSse2:
+        return &kSse2Kernels;
+
+    case Level::kScalar:
+    default:
+        return &kScalarKernels;
+    }
+#else
+    return &kScalarKernels;
+#endif
+}
+
+Level g_level = best_level();
+const Kernels *g_kernels = kernels_of(g_level);
+} // namespace
+
+Level level()
+{
+    return g_level;
+}
+
+Level best_level()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? Level::kAvx2 : Level::kSse2;
+#else
+    return Level::kScalar;
+#endif
+}
+
+Level set_level(Level level)
+{
+    if (level > best_level())
+    {
+        level = best_level();
+    }
+    g_level = level;
+    g_kernels = kernels_of(level);
+    return g_level;
+}
+
+const char *level_name(Level level)
+{
+    switch (level)
+    {
+    case Level::kAvx2:
+        return "avx2";
+
+    case Level::kSse2:
+        return "sse2";
+
+    case Level::kScalar:
+    default:
+        return "scalar";
+    }
+}
+
+// a hand-written loop did not get near the libc's memchr, which picks
+//  its own vector width at runtime
+const char *find_byte(const char *begin, const char *end, char c)
+{
+    return static_cast<const char *>(::memchr(begin, c, end - begin));
+}
+
+const char *find_crlf(const char *begin, const char *end)
+{
+    return g_kernels->find_delimiter(begin, end, "\r\n", 2);
+}
+
+const char *find_delimiter(const char *begin, const char *end,
+                           const char *delim, std::size_t len)
+{
+    return g_kernels->find_delimiter(begin, end, delim, len);
+}
+
+std::size_t find_all_of(const char *begin, const char *end,
+                        const char *set, std::size_t set_len,
+                        std::size_t base, std::vector<std::size_t> *offsets)
+{
+    return g_kernels->find_all_of(begin, end, set, set_len, base, offsets);
+}
+
+} // namespace icarus::scan
@@ -0,0 +1,62 @@
+#ifndef ICARUS_BYTESCAN_HPP
+#define ICARUS_BYTESCAN_HPP
+
+#include <vector>
+#include <cstddef>
+
+namespace icarus
+{
+
+/**
+ * delimiter search over [begin, end) for Buffer
+ *
+ * AVX2 and SSE2 kernels on x86-64, picked once at startup from what the
+ *  cpu supports, plain loops everywhere else. single bytes and "\r\n"
+ *  go through the libc's memchr at every level, it beat the kernels in
+ *  bytescan_bench. every level gives the same results, set_level exists
+ *  for tests and benchmarks.
+*/
+namespace scan
+{
+
+enum class Level
+{
+    kScalar,
+    kSse2,
+    kAvx2
+};
+
+// the level in use
+Level level();
+
+// best level the cpu supports
+Level best_level();
+
+// falls back to best_level() when level is not supported, returns the
+//  level in use. not thread safe, call it before any scanning starts
+Level set_level(Level level);
+
+const char *level_name(Level level);
+
+// first c, or nullptr
+const char *find_byte(const char *begin, const char *end, char c);
+
+// first "\r\n", or nullptr
+const char *find_crlf(const char *begin, const char *end);
+
+// first occurrence of the len bytes at delim, or nullptr. begin when
+//  len is 0
+const char *find_delimiter(const char *begin, const char *end,
+                           const char *delim, std::size_t len);
+
+// appends base plus the offset from begin of every byte that is one of
+//  the set_len bytes at set, in order, returns how many were found
+std::size_t find_all_of(const char *begin, const char *end,
+                        const char *set, std::size_t set_len,
+                        std::size_t base, std::vector<std::size_t> *offsets);
+
+} // namespace scan
+
+} // namespace icarus
+
+#endif // ICARUS_BYTESCAN_HPP
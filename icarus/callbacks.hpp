@@ -2,8 +2,11 @@
 #define ICARUS_CALLBACKS_HPP
 
 #include <memory>
+#include <string>
 #include <functional>
 
+#include "uniquefunction.hpp"
+
 namespace icarus
 {
 
@@ -11,10 +14,14 @@ class TcpConnection;
 class Buffer;
 
 using TcpConnectionPtr      = std::shared_ptr<TcpConnection>;
-using TimerCallback         = std::function<void()>;
+// immutable bytes shared by every connection they are sent to,
+//  std::make_shared<const std::string>(...)
+using PayloadPtr            = std::shared_ptr<const std::string>;
+using TimerCallback         = UniqueFunction<void()>;
 using ConnectionCallback    = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback         = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
+using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
 using MessageCallback       = std::function<void (const TcpConnectionPtr&,
                                                   Buffer* /*,
                                                   Timestamp*/)>;
@@ -17,7 +17,8 @@ Channel::Channel(EventLoop* loop, int fd)
     fd_(fd),
     events_(0),
     revents_(0),
-    event_handling_(false)
+    event_handling_(false),
+    edge_triggered_(false)
 {
     // ...
 }
@@ -147,6 +148,17 @@ bool Channel::is_reading() const
     return events_ & kReadEvent;
 }
 
+void Channel::set_edge_triggered(bool on)
+{
+    assert(index_ < 0);
+    edge_triggered_ = on;
+}
+
+bool Channel::edge_triggered() const
+{
+    return edge_triggered_;
+}
+
 int Channel::index()
 {
     return index_;
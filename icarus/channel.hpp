@@ -1,9 +1,8 @@
 #ifndef ICARUS_CHANNEL_HPP
 #define ICARUS_CHANNEL_HPP
 
-#include <functional>
-
 #include "noncopyable.hpp"
+#include "uniquefunction.hpp"
 
 namespace icarus
 {
@@ -12,7 +11,7 @@ class EventLoop;
 class Channel : noncopyable
 {
   public:
-    using EventCallback = std::function<void()>;
+    using EventCallback = UniqueFunction<void()>;
 
     Channel(EventLoop *loop, int fd);
     ~Channel();
@@ -37,6 +36,11 @@ class Channel : noncopyable
     bool is_writing() const;
     bool is_reading() const;
 
+    // registers with EPOLLET, ignored by the poll(2) backend.
+    //  must be set before the channel is first enabled
+    void set_edge_triggered(bool on);
+    bool edge_triggered() const;
+
     // for Poller
     int index();
     void set_index(int index);
@@ -58,6 +62,7 @@ class Channel : noncopyable
     short      revents_;
 
     bool event_handling_;
+    bool edge_triggered_;
     EventCallback read_callback_;
     EventCallback write_callback_;
     EventCallback close_callback_;
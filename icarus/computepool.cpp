@@ -0,0 +1,263 @@
+#include <cassert>
+#include <utility>
+
+#include "eventloop.hpp"
+#include "computepool.hpp"
+#include "tcpconnection.hpp"
+
+using namespace icarus;
+
+struct ComputePool::LoopCompletions
+{
+    struct Item
+    {
+        TcpConnectionPtr conn;
+        std::uint64_t seq = 0;
+        Completion completion;
+    };
+
+    explicit LoopCompletions(EventLoop *l)
+      : loop(l),
+        count(0)
+    {
+    }
+
+    // runs in loop, count is the number of items pushed but not yet run
+    static void drain(const std::shared_ptr<LoopCompletions> &self)
+    {
+        std::size_t n = self->count.load(std::memory_order_acquire);
+        Item item;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            while (!self->queue.try_pop(item))
+            {
+                // counted but not linked yet
+                std::this_thread::yield();
+            }
+            deliver(item);
+        }
+        item = Item();
+
+        // items pushed meanwhile found count non-zero and left them to us
+        if (self->count.fetch_sub(n, std::memory_order_acq_rel) != n)
+        {
+            self->loop->queue_in_loop([self] { drain(self); });
+        }
+    }
+
+    static void deliver(Item &item)
+    {
+        if (!item.conn)
+        {
+            if (item.completion)
+            {
+                item.completion();
+            }
+            return;
+        }
+
+        TcpConnection &conn = *item.conn;
+        if (item.seq != conn.compute_completed_)
+        {
+            // an earlier task of this connection is still running
+            conn.compute_early_.emplace(item.seq, std::move(item.completion));
+            return;
+        }
+
+        Completion completion = std::move(item.completion);
+        while (true)
+        {
+            ++conn.compute_completed_;
+            if (completion)
+            {
+                completion();
+            }
+            auto it = conn.compute_early_.begin();
+            if (it == conn.compute_early_.end() || it->first != conn.compute_completed_)
+            {
+                break;
+            }
+            completion = std::move(it->second);
+            conn.compute_early_.erase(it);
+        }
+    }
+
+    EventLoop *loop;
+    MpscQueue<Item> queue;
+    std::atomic<std::size_t> count;
+};
+
+ComputePool::ComputePool(int num_threads)
+  : next_worker_(0),
+    queued_(0),
+    steals_(0),
+    sleepers_(0),
+    stopping_(false)
+{
+    assert(num_threads > 0);
+    for (int i = 0; i < num_threads; ++i)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+        workers_[i]->thread = std::thread([this, i] { worker_func(i); });
+    }
+}
+
+ComputePool::~ComputePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cond_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker->thread.join();
+    }
+}
+
+void ComputePool::submit(EventLoop *loop, Work work)
+{
+    loop->assert_in_loop_thread();
+    push(Task{ std::move(work), completions_of(loop), nullptr, 0 });
+}
+
+void ComputePool::submit(const TcpConnectionPtr &conn, Work work)
+{
+    EventLoop *loop = conn->get_loop();
+    loop->assert_in_loop_thread();
+    std::uint64_t seq = conn->compute_submitted_++;
+    push(Task{ std::move(work), completions_of(loop), conn, seq });
+}
+
+int ComputePool::num_threads() const
+{
+    return static_cast<int>(workers_.size());
+}
+
+std::uint64_t ComputePool::steals() const
+{
+    return steals_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<ComputePool::LoopCompletions> ComputePool::completions_of(EventLoop *loop)
+{
+    // submit runs in the loop thread, remember the last lookup there
+    thread_local const ComputePool *cached_pool = nullptr;
+    thread_local std::shared_ptr<LoopCompletions> cached;
+    if (cached_pool == this && cached && cached->loop == loop)
+    {
+        return cached;
+    }
+
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    std::shared_ptr<LoopCompletions> found;
+    for (auto &completions : loops_)
+    {
+        if (completions->loop == loop)
+        {
+            found = completions;
+            break;
+        }
+    }
+    if (!found)
+    {
+        found = std::make_shared<LoopCompletions>(loop);
+        loops_.push_back(found);
+    }
+    cached_pool = this;
+    cached = found;
+    return found;
+}
+
+void ComputePool::push(Task task)
+{
+    auto &worker = *workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // pairs with the sleepers_ increment in worker_func, one of the two
+    //  sides sees the other
+    queued_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cond_.notify_one();
+    }
+}
+
+// own deque from the front, others from the back
+bool ComputePool::take(std::size_t self, Task &task)
+{
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+        auto &worker = *workers_[(self + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+        {
+            continue;
+        }
+        if (i == 0)
+        {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+        }
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ComputePool::worker_func(std::size_t self)
+{
+    Task task;
+    while (true)
+    {
+        if (take(self, task))
+        {
+            Completion completion = task.work();
+            complete(task, std::move(completion));
+            task = Task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        if (queued_.load(std::memory_order_seq_cst) == 0)
+        {
+            if (stopping_)
+            {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            sleep_cond_.wait(lock);
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ComputePool::complete(Task &task, Completion completion)
+{
+    auto &target = task.target;
+    LoopCompletions::Item item;
+    item.conn = std::move(task.conn);
+    item.seq = task.seq;
+    item.completion = std::move(completion);
+    target->queue.push(std::move(item));
+
+    // only the first completion of a burst wakes the loop
+    if (target->count.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        target->loop->queue_in_loop([target = target] { LoopCompletions::drain(target); });
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef ICARUS_COMPUTEPOOL_HPP
+#define ICARUS_COMPUTEPOOL_HPP
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include "noncopyable.hpp"
+#include "callbacks.hpp"
+#include "mpscqueue.hpp"
+#include "uniquefunction.hpp"
+
+namespace icarus
+{
+class EventLoop;
+
+/**
+ * work-stealing thread pool for cpu heavy parts of message handling
+ *
+ * a Work runs on a worker and returns the Completion which runs back in
+ *  the loop it was submitted from, an empty Completion is fine. each worker
+ *  has its own deque and idle workers steal from the others. completions
+ *  for one loop share one queue, a burst of them costs one queue_in_loop.
+ *  completions of work submitted for the same TcpConnection run in
+ *  submission order, although the work itself runs in parallel.
+*/
+class ComputePool : noncopyable
+{
+  public:
+    using Completion = UniqueFunction<void()>;
+    using Work = UniqueFunction<Completion()>;
+
+    explicit ComputePool(int num_threads);
+
+    // runs the work still queued, then joins the workers
+    ~ComputePool();
+
+    // must be called in loop's thread, the completion runs there
+    void submit(EventLoop *loop, Work work);
+
+    // must be called in conn's loop thread, completions of one
+    //  connection run in the order of submission
+    void submit(const TcpConnectionPtr &conn, Work work);
+
+    int num_threads() const;
+
+    // tasks taken from another worker's deque, thread safe
+    std::uint64_t steals() const;
+
+  private:
+    struct LoopCompletions;
+
+    struct Task
+    {
+        Work work;
+        std::shared_ptr<LoopCompletions> target;
+        TcpConnectionPtr conn;
+        std::uint64_t seq = 0;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::shared_ptr<LoopCompletions> completions_of(EventLoop *loop);
+    void push(Task task);
+    bool take(std::size_t self, Task &task);
+    void worker_func(std::size_t self);
+    static void complete(Task &task, Completion completion);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::size_t> next_worker_;
+    std::atomic<std::size_t> queued_;
+    std::atomic<std::uint64_t> steals_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cond_;
+    std::atomic<int> sleepers_;
+    bool stopping_;
+
+    std::mutex loops_mutex_;
+    std::vector<std::shared_ptr<LoopCompletions>> loops_;
+};
+} // namespace icarus
+
+#endif // ICARUS_COMPUTEPOOL_HPP
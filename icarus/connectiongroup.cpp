@@ -0,0 +1,175 @@
+#include <atomic>
+#include <string>
+#include <utility>
+#include <unordered_map>
+
+#include "eventloop.hpp"
+#include "tcpconnection.hpp"
+#include "connectiongroup.hpp"
+
+using namespace icarus;
+
+// the members of one loop, only touched in that loop's thread apart
+//  from the counters, which only it writes
+struct ConnectionGroup::LoopMembers
+{
+    explicit LoopMembers(EventLoop *l)
+      : loop(l),
+        count(0),
+        skipped(0)
+    {
+    }
+
+    struct Member
+    {
+        TcpConnection *key;
+        std::weak_ptr<TcpConnection> conn;
+    };
+
+    void add(const TcpConnectionPtr &conn)
+    {
+        auto [it, added] = index.emplace(conn.get(), members.size());
+        if (added)
+        {
+            members.push_back({ conn.get(), conn });
+            count.store(members.size(), std::memory_order_relaxed);
+        }
+        else if (members[it->second].conn.expired())
+        {
+            // a member gone before it was pruned, its address reused
+            members[it->second].conn = conn;
+        }
+    }
+
+    void remove(TcpConnection *conn)
+    {
+        auto it = index.find(conn);
+        if (it != index.end())
+        {
+            remove_at(it->second);
+        }
+    }
+
+    // the last member takes the place of the removed one
+    void remove_at(std::size_t i)
+    {
+        index.erase(members[i].key);
+        if (i + 1 < members.size())
+        {
+            members[i] = std::move(members.back());
+            index[members[i].key] = i;
+        }
+        members.pop_back();
+        count.store(members.size(), std::memory_order_relaxed);
+    }
+
+    void send(const PayloadPtr &payload)
+    {
+        std::uint64_t missed = 0;
+        for (std::size_t i = 0; i < members.size(); )
+        {
+            TcpConnectionPtr conn = members[i].conn.lock();
+            if (!conn || !conn->connected())
+            {
+                remove_at(i);
+                continue;
+            }
+            if (conn->over_high_water_mark())
+            {
+                ++missed;
+            }
+            else
+            {
+                conn->send(payload);
+            }
+            ++i;
+        }
+        if (missed > 0)
+        {
+            skipped.store(skipped.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+        }
+    }
+
+    EventLoop *loop;
+    std::vector<Member> members;
+    std::unordered_map<TcpConnection *, std::size_t> index;
+    std::atomic<std::size_t> count;
+    std::atomic<std::uint64_t> skipped;
+};
+
+ConnectionGroup::ConnectionGroup() = default;
+
+ConnectionGroup::~ConnectionGroup() = default;
+
+void ConnectionGroup::add(const TcpConnectionPtr &conn)
+{
+    auto members = members_of(conn->get_loop());
+    members->loop->run_in_loop([members, conn] () {
+        members->add(conn);
+    });
+}
+
+void ConnectionGroup::remove(const TcpConnectionPtr &conn)
+{
+    auto members = members_of(conn->get_loop());
+    members->loop->run_in_loop([members, conn] () {
+        members->remove(conn.get());
+    });
+}
+
+void ConnectionGroup::broadcast(PayloadPtr payload)
+{
+    // sending may call back into the group, no lock held while it runs
+    std::vector<std::shared_ptr<LoopMembers>> loops;
+    {
+        std::lock_guard<std::mutex> lock(loops_mutex_);
+        loops = loops_;
+    }
+    for (auto &members : loops)
+    {
+        members->loop->run_in_loop([members, payload] () {
+            members->send(payload);
+        });
+    }
+}
+
+void ConnectionGroup::broadcast(const std::string_view &message)
+{
+    broadcast(std::make_shared<const std::string>(message));
+}
+
+std::size_t ConnectionGroup::size() const
+{
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    std::size_t total = 0;
+    for (auto &members : loops_)
+    {
+        total += members->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::uint64_t ConnectionGroup::skipped() const
+{
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    std::uint64_t total = 0;
+    for (auto &members : loops_)
+    {
+        total += members->skipped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::shared_ptr<ConnectionGroup::LoopMembers> ConnectionGroup::members_of(EventLoop *loop)
+{
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    for (auto &members : loops_)
+    {
+        if (members->loop == loop)
+        {
+            return members;
+        }
+    }
+    loops_.push_back(std::make_shared<LoopMembers>(loop));
+    return loops_.back();
+}
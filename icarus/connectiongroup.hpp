@@ -0,0 +1,58 @@
+#ifndef ICARUS_CONNECTIONGROUP_HPP
+#define ICARUS_CONNECTIONGROUP_HPP
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include "noncopyable.hpp"
+#include "callbacks.hpp"
+
+namespace icarus
+{
+class EventLoop;
+
+/**
+ * connections that receive the same messages, tracked per loop
+ *
+ * a broadcast costs one queue_in_loop per loop however many members it
+ *  has, every loop sends to its own members in its own thread. a member
+ *  over its high water mark, see TcpConnection::set_high_water_mark_callback,
+ *  misses that message. members are held weakly, the group never keeps
+ *  a connection alive, those that closed are dropped on the next
+ *  broadcast. all of it is thread safe, adds, removes and broadcasts
+ *  reach a loop in the order they were made.
+*/
+class ConnectionGroup : noncopyable
+{
+  public:
+    ConnectionGroup();
+    ~ConnectionGroup();
+
+    void add(const TcpConnectionPtr &conn);
+    void remove(const TcpConnectionPtr &conn);
+
+    void broadcast(PayloadPtr payload);
+
+    // copied once, shared by all members
+    void broadcast(const std::string_view &message);
+
+    // members once their add or remove ran in their loop
+    std::size_t size() const;
+
+    // messages members missed for being over their high water mark
+    std::uint64_t skipped() const;
+
+  private:
+    struct LoopMembers;
+
+    std::shared_ptr<LoopMembers> members_of(EventLoop *loop);
+
+    mutable std::mutex loops_mutex_;
+    std::vector<std::shared_ptr<LoopMembers>> loops_;
+};
+} // namespace icarus
+
+#endif // ICARUS_CONNECTIONGROUP_HPP
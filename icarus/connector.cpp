@@ -9,7 +9,7 @@ namespace icarus
 {
 Connector::Connector(EventLoop *loop, const InetAddress &server_addr)
   : loop_(loop), server_addr_(server_addr)
-  , connect_(false), state_(kDisconnected)
+  , connect_(false), retry_(true), state_(kDisconnected)
 {
     // ...
 }
@@ -24,10 +24,20 @@ void Connector::set_new_connection_callback(NewConnectionCallback cb)
     new_connection_callback_ = std::move(cb);
 }
 
+void Connector::set_error_callback(ErrorCallback cb)
+{
+    error_callback_ = std::move(cb);
+}
+
+void Connector::set_retry(bool on)
+{
+    retry_ = on;
+}
+
 void Connector::start()
 {
     connect_ = true;
-    loop_->run_in_loop([this]{ this->start_in_loop(); });
+    loop_->run_in_loop([self = shared_from_this()] { self->start_in_loop(); });
 }
 
 void Connector::restart()
@@ -41,7 +51,7 @@ void Connector::restart()
 void Connector::stop()
 {
     connect_ = false;
-    loop_->queue_in_loop([this]{ this->stop_in_loop(); });
+    loop_->queue_in_loop([self = shared_from_this()] { self->stop_in_loop(); });
 }
 
 const InetAddress &Connector::server_addr() const
@@ -57,9 +67,12 @@ void Connector::set_state(States state)
 void Connector::start_in_loop()
 {
     loop_->assert_in_loop_thread();
-    assert(connect_);
     assert(state_ == kDisconnected);
-    connect();
+    // stopped while the attempt was queued
+    if (connect_)
+    {
+        connect();
+    }
 }
 
 void Connector::stop_in_loop()
@@ -103,11 +116,11 @@ void Connector::connect()
     case EBADF:
     case EFAULT:
     case ENOTSOCK:
-        close(sockfd);
+        fail(sockfd);
         break;
 
     default:
-        close(sockfd);
+        fail(sockfd);
         break;
     }
 }
@@ -125,7 +138,12 @@ void Connector::connecting(int sockfd)
 
 void Connector::handle_write()
 {
-    assert(state_ == kConnecting);
+    // a refused connect reports POLLERR with POLLOUT, handle_error of the
+    //  same wakeup has already dealt with it
+    if (state_ != kConnecting)
+    {
+        return;
+    }
 
     int sockfd = detach();
     int err = sockets::get_socket_error(sockfd);
@@ -170,11 +188,30 @@ void Connector::close(int sockfd)
 }
 
 void Connector::retry(int sockfd)
+{
+    if (!retry_)
+    {
+        fail(sockfd);
+        return;
+    }
+    close(sockfd);
+    if (connect_)
+    {
+        loop_->queue_in_loop([self = shared_from_this()] { self->start_in_loop(); });
+    }
+}
+
+// gives up, a stopped connector has nobody to tell
+void Connector::fail(int sockfd)
 {
     close(sockfd);
     if (connect_)
     {
-        loop_->queue_in_loop([this] { this->start_in_loop(); });
+        connect_ = false;
+        if (error_callback_)
+        {
+            error_callback_();
+        }
     }
 }
 
@@ -187,7 +224,7 @@ int Connector::detach()
      * this is unsafe because it may be executed before `return sockfd`
      *  and we are inside Channel::handle_event
     */
-    loop_->queue_in_loop([this]{ this->reset_channel(); });
+    loop_->queue_in_loop([self = shared_from_this()] { self->reset_channel(); });
     return sockfd;
 }
 
@@ -12,17 +12,27 @@ namespace icarus
 class Channel;
 class EventLoop;
 
+// shared, queued work keeps it alive after its TcpClient is gone
 class Connector : noncopyable
+                , public std::enable_shared_from_this<Connector>
 {
   public:
     using NewConnectionCallback
         = std::function<void (int sockfd)>;
+    using ErrorCallback = std::function<void ()>;
 
     Connector(EventLoop *loop, const InetAddress &server_addr);
     ~Connector();
 
     void set_new_connection_callback(NewConnectionCallback cb);
 
+    // called in the loop thread when a connect fails for good, that is
+    //  with a hard error or with retry off
+    void set_error_callback(ErrorCallback cb);
+
+    // a refused or failed connect is tried again, on by default
+    void set_retry(bool on);
+
     void start();
     void restart();
     void stop();
@@ -41,15 +51,18 @@ class Connector : noncopyable
     void handle_error();
     void close(int sockfd);
     void retry(int sockfd);
+    void fail(int sockfd);
     int detach();
     void reset_channel();
 
     EventLoop *loop_;
     InetAddress server_addr_;
     bool connect_;
+    bool retry_;
     States state_;
     std::unique_ptr<Channel> channel_;
     NewConnectionCallback new_connection_callback_;
+    ErrorCallback error_callback_;
 };
 } // namespace icarus
 
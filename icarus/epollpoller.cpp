@@ -0,0 +1,163 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "channel.hpp"
+#include "epollpoller.hpp"
+
+using namespace icarus;
+
+EPollPoller::EPollPoller(EventLoop *loop)
+  : Poller(loop),
+    epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)),
+    epoll_events_(kInitEventListSize),
+    idle_polls_(0)
+{
+    if (epoll_fd_ == -1)
+    {
+        abort();
+    }
+}
+
+EPollPoller::~EPollPoller()
+{
+    ::close(epoll_fd_);
+}
+
+std::chrono::system_clock::time_point EPollPoller::poll(int timeout_ms, ChannelList *active_channels)
+{
+    int num_events = ::epoll_wait(epoll_fd_, epoll_events_.data(),
+                                  static_cast<int>(epoll_events_.size()), timeout_ms);
+    auto now = std::chrono::system_clock::now();
+
+    if (num_events > 0)
+    {
+        fill_active_channels(num_events, active_channels);
+    }
+    else if (num_events < 0 && errno != EINTR)
+    {
+        abort();
+    }
+
+    std::size_t n = num_events > 0 ? num_events : 0;
+    bool full = n == epoll_events_.size();
+    resize_event_list(n);
+    record_poll(n, full, epoll_events_.size());
+    return now;
+}
+
+void EPollPoller::update_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    int index = channel->index();
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            add_channel(channel);
+        }
+        else
+        {
+            assert(has_channel(channel));
+        }
+        if (!channel->is_none_event())
+        {
+            channel->set_index(kAdded);
+            epoll_update(EPOLL_CTL_ADD, channel);
+        }
+        else
+        {
+            channel->set_index(kDeleted);
+        }
+    }
+    else
+    {
+        // update existing one
+        assert(has_channel(channel));
+        assert(index == kAdded);
+        if (channel->is_none_event())
+        {
+            epoll_update(EPOLL_CTL_DEL, channel);
+            channel->set_index(kDeleted);
+        }
+        else
+        {
+            epoll_update(EPOLL_CTL_MOD, channel);
+        }
+    }
+}
+
+void EPollPoller::remove_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    assert(has_channel(channel));
+    assert(channel->is_none_event());
+    int index = channel->index();
+    assert(index == kAdded || index == kDeleted);
+    if (index == kAdded)
+    {
+        epoll_update(EPOLL_CTL_DEL, channel);
+    }
+    channel->set_index(kNew);
+    erase_channel(channel);
+}
+
+PollerBackend EPollPoller::backend() const
+{
+    return PollerBackend::kEpoll;
+}
+
+void EPollPoller::fill_active_channels(int num_events, ChannelList *active_channels) const
+{
+    for (int i = 0; i < num_events; ++i)
+    {
+        auto channel = static_cast<Channel *>(epoll_events_[i].data.ptr);
+        assert(has_channel(channel));
+        channel->set_revents(epoll_events_[i].events);
+        active_channels->push_back(channel);
+    }
+}
+
+void EPollPoller::resize_event_list(std::size_t num_events)
+{
+    std::size_t size = epoll_events_.size();
+    if (num_events == size)
+    {
+        idle_polls_ = 0;
+        if (size < kMaxEventListSize)
+        {
+            epoll_events_.resize(size * 2);
+        }
+    }
+    else if (size > kInitEventListSize && num_events < size / 4)
+    {
+        // give the memory back only after a sustained quiet period
+        if (++idle_polls_ >= kShrinkAfterPolls)
+        {
+            EpollEventList(size / 2).swap(epoll_events_);
+            idle_polls_ = 0;
+        }
+    }
+    else
+    {
+        idle_polls_ = 0;
+    }
+}
+
+void EPollPoller::epoll_update(int operation, Channel *channel)
+{
+    epoll_event event = {};
+    event.events = channel->events();
+    if (channel->edge_triggered())
+    {
+        event.events |= EPOLLET;
+    }
+    event.data.ptr = channel;
+    if (::epoll_ctl(epoll_fd_, operation, channel->fd(), &event) == -1)
+    {
+        abort();
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef ICARUS_EPOLLPOLLER_HPP
+#define ICARUS_EPOLLPOLLER_HPP
+
+#include <vector>
+
+#include "poller.hpp"
+
+struct epoll_event;
+
+namespace icarus
+{
+// epoll(7) backend
+class EPollPoller : public Poller
+{
+  public:
+    explicit EPollPoller(EventLoop *loop);
+    ~EPollPoller() override;
+
+    std::chrono::system_clock::time_point poll(int timeout_ms, ChannelList *active_channels) override;
+
+    void update_channel(Channel *channel) override;
+    void remove_channel(Channel *channel) override;
+
+    PollerBackend backend() const override;
+
+  private:
+    using EpollEventList = std::vector<epoll_event>;
+
+    // the event list grows while polls come back full and shrinks
+    //  after kShrinkAfterPolls polls using less than a quarter of it
+    static constexpr std::size_t kInitEventListSize = 16;
+    static constexpr std::size_t kMaxEventListSize = 4096;
+    static constexpr int kShrinkAfterPolls = 128;
+
+    // Channel::index()
+    static constexpr int kNew = -1;
+    static constexpr int kAdded = 1;
+    static constexpr int kDeleted = 2;
+
+    void fill_active_channels(int num_events, ChannelList *active_channels) const;
+    void resize_event_list(std::size_t num_events);
+    void epoll_update(int operation, Channel *channel);
+
+    int epoll_fd_;
+    EpollEventList epoll_events_;
+    int idle_polls_;
+};
+} // namespace icarus
+
+#endif // ICARUS_EPOLLPOLLER_HPP
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
@@ -9,7 +10,9 @@
 
 #include "poller.hpp"
 #include "channel.hpp"
+#include "timerqueue.hpp"
 #include "eventloop.hpp"
+#include "loopplacement.hpp"
 
 using namespace icarus;
 
@@ -19,6 +22,24 @@ thread_local EventLoop *t_loop_in_this_thread = nullptr;
 
 constexpr int kPollTimeMs = 10000;
 
+#ifdef ICARUS_METRICS
+constexpr bool kMetrics = true;
+#else
+constexpr bool kMetrics = false;
+#endif
+
+// adaptive spinning gives up below this window
+constexpr std::chrono::nanoseconds kMinSpinWindow(1000);
+
+// busy_ns() halves for every this much time without an update
+constexpr std::uint64_t kBusyHalfLifeNs = 10 * 1000 * 1000;
+
+std::uint64_t now_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
 int create_eventfd()
 {
     int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -36,13 +57,30 @@ int ignore_sigpipe = [] () {
 } // namespace
 
 EventLoop::EventLoop()
+  : EventLoop(kDefaultPollerBackend)
+{
+}
+
+EventLoop::EventLoop(PollerBackend backend)
   : looping_(false),
     quit_(false),
-    calling_pending_functors_(false),
     thread_id_(std::this_thread::get_id()),
-    poller_(std::make_unique<Poller>(this)),
+    cpu_(LoopPlacement::pinned_cpu_of_current_thread()),
+    numa_node_(cpu_ < 0 ? -1 : LoopPlacement::numa_node_of(cpu_)),
+    poller_(Poller::new_poller(this, backend)),
+    timer_queue_(std::make_unique<TimerQueue>(this)),
     wakeup_fd_(create_eventfd()),
-    wakeup_channel_(std::make_unique<Channel>(this, wakeup_fd_))
+    wakeup_channel_(std::make_unique<Channel>(this, wakeup_fd_)),
+    pending_count_(0),
+    metrics_(kMetrics ? std::make_unique<LoopMetrics>() : nullptr),
+    busy_poll_mode_(BusyPollMode::kBlocking),
+    busy_poll_window_(0),
+    spin_window_(0),
+    spinning_(false),
+    connection_count_(0),
+    load_tracking_(false),
+    busy_ns_(0),
+    busy_updated_ns_(0)
 {
     if (t_loop_in_this_thread)
     {
@@ -74,12 +112,53 @@ void EventLoop::loop()
     while (!quit_)
     {
         active_channels_.clear();
-        poller_->poll(kPollTimeMs, &active_channels_);
-        for (auto &channel : active_channels_)
+        int timeout_ms = poll_timeout();
+        std::size_t functors = 0;
+        if constexpr (kMetrics)
+        {
+            std::uint64_t start = now_ns();
+            poller_->poll(timeout_ms, &active_channels_);
+            std::uint64_t polled = now_ns();
+            for (auto &channel : active_channels_)
+            {
+                channel->handle_event();
+            }
+            std::uint64_t dispatched = now_ns();
+            std::size_t depth = pending_count_.load(std::memory_order_relaxed);
+            functors = do_pending_functors();
+            std::uint64_t done = now_ns();
+
+            metrics_->poll_wait_ns.record(polled - start);
+            metrics_->dispatch_ns.record(dispatched - polled);
+            metrics_->functor_ns.record(done - dispatched);
+            metrics_->iteration_ns.record(done - start);
+            metrics_->active_channels.record(active_channels_.size());
+            metrics_->queue_depth.record(depth);
+            if (load_tracking_.load(std::memory_order_relaxed))
+            {
+                record_busy(polled, done);
+            }
+        }
+        else
+        {
+            poller_->poll(timeout_ms, &active_channels_);
+            bool tracking = load_tracking_.load(std::memory_order_relaxed);
+            std::uint64_t polled = tracking ? now_ns() : 0;
+            for (auto &channel : active_channels_)
+            {
+                channel->handle_event();
+            }
+            functors = do_pending_functors();
+            if (tracking)
+            {
+                record_busy(polled, now_ns());
+            }
+        }
+
+        if (busy_poll_mode_ != BusyPollMode::kBlocking && (!active_channels_.empty() || functors > 0))
         {
-            channel->handle_event();
+            update_busy_poll();
         }
-        do_pending_functors();
     }
 
     looping_ = false;
@@ -94,7 +173,7 @@ void EventLoop::quit()
     }
 }
 
-void EventLoop::run_in_loop(const Functor& cb)
+void EventLoop::run_in_loop(Functor cb)
 {
     if (is_in_loop_thread())
     {
@@ -102,26 +181,135 @@ void EventLoop::run_in_loop(const Functor& cb)
     }
     else
     {
-        queue_in_loop(cb);
+        queue_in_loop(std::move(cb));
     }
 }
 
-void EventLoop::queue_in_loop(const Functor& cb)
+void EventLoop::queue_in_loop(Functor cb)
 {
+    pending_functors_.push(std::move(cb));
+
+    /**
+     * only the producer which makes the queue non-empty wakes the loop up.
+     *  when the queue was non-empty already, either a wakeup is on its way
+     *  or the loop will see pending_count_ > 0 and poll without blocking.
+     *  a spinning loop needs none either, it clears spinning_ before it
+     *  checks pending_count_ and blocks
+    */
+    if (pending_count_.fetch_add(1, std::memory_order_seq_cst) == 0 && !is_in_loop_thread()
+        && !spinning_.load(std::memory_order_seq_cst))
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pending_functors_.push_back(cb);
+        wakeup();
     }
+}
 
-    if (!is_in_loop_thread() || calling_pending_functors_)
+int EventLoop::poll_timeout()
+{
+    if (busy_poll_mode_ != BusyPollMode::kBlocking)
     {
-        wakeup();
+        poll_started_ = std::chrono::steady_clock::now();
+        if (spinning_.load(std::memory_order_relaxed))
+        {
+            if (poll_started_ < spin_deadline_)
+            {
+                return 0;
+            }
+            // the window passed without work
+            if (busy_poll_mode_ == BusyPollMode::kAdaptive)
+            {
+                spin_window_ /= 2;
+                if (spin_window_ < kMinSpinWindow)
+                {
+                    spin_window_ = std::chrono::nanoseconds(0);
+                }
+            }
+            spinning_.store(false, std::memory_order_seq_cst);
+        }
     }
+    // functors queued without a wakeup are still pending, don't sleep
+    return pending_count_.load(std::memory_order_seq_cst) > 0 ? 0 : kPollTimeMs;
+}
+
+// called after an iteration which found work
+void EventLoop::update_busy_poll()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (busy_poll_mode_ == BusyPollMode::kAdaptive && now - poll_started_ < busy_poll_window_)
+    {
+        // spinning caught this work or would have, widen the window
+        spin_window_ = std::min(std::max(spin_window_ * 2, kMinSpinWindow), busy_poll_window_);
+    }
+    if (spin_window_ > std::chrono::nanoseconds(0))
+    {
+        spin_deadline_ = now + spin_window_;
+        spinning_.store(true, std::memory_order_relaxed);
+    }
+}
+
+// moving average over roughly the last 8 iterations, single writer
+void EventLoop::record_busy(std::uint64_t start_ns, std::uint64_t end_ns)
+{
+    std::uint64_t busy = busy_ns_.load(std::memory_order_relaxed);
+    busy = busy - busy / 8 + (end_ns - start_ns) / 8;
+    busy_ns_.store(busy, std::memory_order_relaxed);
+    busy_updated_ns_.store(end_ns, std::memory_order_relaxed);
 }
 
 std::size_t EventLoop::queue_size() const
 {
-    return pending_functors_.size();
+    return pending_count_.load(std::memory_order_relaxed);
+}
+
+TimerId EventLoop::run_at(std::chrono::steady_clock::time_point time, TimerCallback cb)
+{
+    return timer_queue_->add_timer(std::move(cb), time, std::chrono::steady_clock::duration::zero());
+}
+
+TimerId EventLoop::run_after(std::chrono::steady_clock::duration delay, TimerCallback cb)
+{
+    return run_at(std::chrono::steady_clock::now() + delay, std::move(cb));
+}
+
+TimerId EventLoop::run_every(std::chrono::steady_clock::duration interval, TimerCallback cb)
+{
+    return timer_queue_->add_timer(std::move(cb), std::chrono::steady_clock::now() + interval, interval);
+}
+
+void EventLoop::cancel(TimerId timer_id)
+{
+    timer_queue_->cancel(timer_id);
+}
+
+EventLoop::SleepAwaiter::SleepAwaiter(EventLoop *loop, std::chrono::steady_clock::duration delay)
+  : loop_(loop),
+    delay_(delay)
+{
+}
+
+bool EventLoop::SleepAwaiter::await_ready() const noexcept
+{
+    return delay_ <= std::chrono::steady_clock::duration::zero();
+}
+
+void EventLoop::SleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    loop_->assert_in_loop_thread();
+    loop_->run_after(delay_, [handle] { handle.resume(); });
+}
+
+EventLoop::SleepAwaiter EventLoop::sleep_for(std::chrono::steady_clock::duration delay)
+{
+    return SleepAwaiter(this, delay);
+}
+
+FramePool &EventLoop::frame_pool()
+{
+    return frame_pool_;
+}
+
+BufferPool &EventLoop::buffer_pool()
+{
+    return buffer_pool_;
 }
 
 void EventLoop::wakeup()
@@ -137,6 +325,79 @@ void EventLoop::wakeup()
     */
 }
 
+PollerStats EventLoop::poller_stats() const
+{
+    return poller_->stats();
+}
+
+PollerBackend EventLoop::poller_backend() const
+{
+    return poller_->backend();
+}
+
+void EventLoop::set_busy_poll(BusyPollMode mode, std::chrono::microseconds window)
+{
+    busy_poll_mode_ = mode;
+    busy_poll_window_ = mode == BusyPollMode::kBlocking ? std::chrono::nanoseconds(0) : window;
+    spin_window_ = mode == BusyPollMode::kSpin ? busy_poll_window_ : std::chrono::nanoseconds(0);
+    spinning_.store(false, std::memory_order_seq_cst);
+}
+
+BusyPollMode EventLoop::busy_poll_mode() const
+{
+    return busy_poll_mode_;
+}
+
+int EventLoop::cpu() const
+{
+    return cpu_;
+}
+
+int EventLoop::numa_node() const
+{
+    return numa_node_;
+}
+
+std::size_t EventLoop::connection_count() const
+{
+    return connection_count_.load(std::memory_order_relaxed);
+}
+
+void EventLoop::connection_opened()
+{
+    connection_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventLoop::connection_closed()
+{
+    connection_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::uint64_t EventLoop::busy_ns() const
+{
+    std::uint64_t busy = busy_ns_.load(std::memory_order_relaxed);
+    std::uint64_t updated = busy_updated_ns_.load(std::memory_order_relaxed);
+    std::uint64_t now = now_ns();
+    // an idle loop blocks in the poller and stops updating, let its figure fade
+    std::uint64_t half_lives = now > updated ? (now - updated) / kBusyHalfLifeNs : 0;
+    return half_lives >= 64 ? 0 : busy >> half_lives;
+}
+
+void EventLoop::set_load_tracking(bool on)
+{
+    load_tracking_.store(on, std::memory_order_relaxed);
+}
+
+bool EventLoop::metrics_enabled() const
+{
+    return metrics_ != nullptr;
+}
+
+LoopMetricsSnapshot EventLoop::metrics() const
+{
+    return metrics_ ? metrics_->snapshot() : LoopMetricsSnapshot();
+}
+
 void EventLoop::update_channel(Channel *channel)
 {
     assert(channel->owner_loop() == this);
@@ -177,8 +438,15 @@ void EventLoop::abort_not_in_loop_thread()
 void EventLoop::handle_read()
 {
     std::uint64_t one = 1;
-    //auto n =
-    read(wakeup_fd_, &one, sizeof one);
+    auto n = read(wakeup_fd_, &one, sizeof one);
+    if constexpr (kMetrics)
+    {
+        // the eventfd counter holds the number of writes since the last read
+        if (n == sizeof one)
+        {
+            metrics_->record_wakeups(one);
+        }
+    }
     /*
     if (n != sizeof one)
     {
@@ -187,19 +455,22 @@ void EventLoop::handle_read()
     */
 }
 
-void EventLoop::do_pending_functors()
+std::size_t EventLoop::do_pending_functors()
 {
-    std::vector<Functor> functors;
-    calling_pending_functors_ = true;
-
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        functors.swap(pending_functors_);
-    }
-
-    for (auto &functor : functors)
+    // run only what is queued now, functors queued by these
+    //  functors wait for the next iteration
+    std::size_t n = pending_count_.load(std::memory_order_acquire);
+    Functor functor;
+    for (std::size_t i = 0; i < n; ++i)
     {
+        while (!pending_functors_.try_pop(functor))
+        {
+            // counted but not linked yet, the producer is about to finish
+            std::this_thread::yield();
+        }
         functor();
     }
-    calling_pending_functors_ = false;
+    functor = nullptr;
+    pending_count_.fetch_sub(n, std::memory_order_acq_rel);
+    return n;
 }
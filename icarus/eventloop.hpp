@@ -1,27 +1,51 @@
 #ifndef ICARUS_EVENTLOOP_HPP
 #define ICARUS_EVENTLOOP_HPP
 
-#include <mutex>
+#include <atomic>
 #include <vector>
 #include <thread>
+#include <chrono>
 #include <memory>
+#include <coroutine>
 #include <functional>
 
 #include "noncopyable.hpp"
+#include "callbacks.hpp"
+#include "timerid.hpp"
+#include "poller.hpp"
+#include "mpscqueue.hpp"
+#include "loopmetrics.hpp"
+#include "framepool.hpp"
+#include "bufferpool.hpp"
+#include "uniquefunction.hpp"
 
 namespace icarus
 {
 class Channel;
-class Poller;
+class TimerQueue;
+
+// what a loop does when an iteration finds no work
+enum class BusyPollMode
+{
+    kBlocking,  // blocks in the poller right away
+    kSpin,      // polls with a zero timeout for the whole window first
+    kAdaptive   // like kSpin, the window grows when spinning catches work
+                //  and shrinks to nothing while the loop is idle
+};
 
 class EventLoop : noncopyable
 {
   public:
-    using Functor = std::function<void()>;
+    // move-only, lambdas up to 64 bytes are stored inline
+    using Functor = UniqueFunction<void()>;
 
     // default contructor
     EventLoop();
 
+    // uses the given poller backend, io_uring falls back to epoll
+    //  when the kernel lacks support
+    explicit EventLoop(PollerBackend backend);
+
     // default deconstructor
     ~EventLoop();
 
@@ -31,14 +55,91 @@ class EventLoop : noncopyable
     // quits loop
     void quit();
 
-    void run_in_loop(const Functor& cb);
+    void run_in_loop(Functor cb);
 
-    void queue_in_loop(const Functor& cb);
+    // thread safe, the eventfd is only written when the queue
+    //  turns non-empty
+    void queue_in_loop(Functor cb);
 
+    // thread safe
     std::size_t queue_size() const;
 
+    // runs callback at time, thread safe
+    TimerId run_at(std::chrono::steady_clock::time_point time, TimerCallback cb);
+
+    // runs callback after delay, thread safe
+    TimerId run_after(std::chrono::steady_clock::duration delay, TimerCallback cb);
+
+    // runs callback every interval, thread safe
+    TimerId run_every(std::chrono::steady_clock::duration interval, TimerCallback cb);
+
+    // cancels the timer, thread safe
+    void cancel(TimerId timer_id);
+
+    class SleepAwaiter
+    {
+      public:
+        SleepAwaiter(EventLoop *loop, std::chrono::steady_clock::duration delay);
+
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept
+        {
+        }
+
+      private:
+        EventLoop *loop_;
+        std::chrono::steady_clock::duration delay_;
+    };
+
+    // co_await loop->sleep_for(delay), the coroutine resumes from the
+    //  timer callback. must be awaited in the loop thread
+    SleepAwaiter sleep_for(std::chrono::steady_clock::duration delay);
+
+    // coroutine frames allocated in this loop's thread, see Task
+    FramePool &frame_pool();
+
+    // Buffer storage allocated in this loop's thread
+    BufferPool &buffer_pool();
+
     void wakeup();
 
+    // counters of the underlying poller, thread safe
+    PollerStats poller_stats() const;
+
+    // backend actually in use
+    PollerBackend poller_backend() const;
+
+    // spins on zero-timeout polls for up to window after the last work
+    //  before blocking. must be called in the loop thread, e.g. from a
+    //  ThreadInitCallback, or before loop() starts
+    void set_busy_poll(BusyPollMode mode,
+                       std::chrono::microseconds window = std::chrono::microseconds(50));
+    BusyPollMode busy_poll_mode() const;
+
+    // cpu the loop thread is pinned to, -1 when it floats
+    int cpu() const;
+
+    // numa node of cpu(), -1 when the loop floats
+    int numa_node() const;
+
+    // load figures for connection distribution, readable from any
+    //  thread without locking
+    std::size_t connection_count() const;
+    void connection_opened();
+    void connection_closed();
+
+    // decaying average of the time one iteration spends outside the
+    //  poller, 0 unless load tracking is on
+    std::uint64_t busy_ns() const;
+    void set_load_tracking(bool on);
+
+    // icarus was built with ICARUS_METRICS
+    bool metrics_enabled() const;
+
+    // histograms of this loop, thread safe. empty without ICARUS_METRICS
+    LoopMetricsSnapshot metrics() const;
+
     void update_channel(Channel *channel);
     void remove_channel(Channel *channel);
 
@@ -55,20 +156,41 @@ class EventLoop : noncopyable
     // abort when not in loop thread
     void abort_not_in_loop_thread();
     void handle_read();
-    void do_pending_functors();
+    std::size_t do_pending_functors();
+    int poll_timeout();
+    void update_busy_poll();
+    void record_busy(std::uint64_t start_ns, std::uint64_t end_ns);
 
     using ChannelList = std::vector<Channel *>;
 
     bool looping_;
     bool quit_;
-    bool calling_pending_functors_;
     const std::thread::id thread_id_;
+    const int cpu_;
+    const int numa_node_;
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timer_queue_;
     int wakeup_fd_;
     std::unique_ptr<Channel> wakeup_channel_;
     ChannelList active_channels_;
-    std::mutex mutex_;
-    std::vector<Functor> pending_functors_;
+    MpscQueue<Functor> pending_functors_;
+    std::atomic<std::size_t> pending_count_;
+    std::unique_ptr<LoopMetrics> metrics_;  // null without ICARUS_METRICS
+    FramePool frame_pool_;
+    BufferPool buffer_pool_;
+
+    BusyPollMode busy_poll_mode_;
+    std::chrono::nanoseconds busy_poll_window_;  // upper bound of spin_window_
+    std::chrono::nanoseconds spin_window_;
+    std::chrono::steady_clock::time_point spin_deadline_;
+    std::chrono::steady_clock::time_point poll_started_;
+    // read by producers, a spinning loop needs no eventfd wakeup
+    std::atomic<bool> spinning_;
+
+    std::atomic<std::size_t> connection_count_;
+    std::atomic<bool> load_tracking_;
+    std::atomic<std::uint64_t> busy_ns_;
+    std::atomic<std::uint64_t> busy_updated_ns_;
 };
 } // namespace icarus
 
@@ -4,13 +4,17 @@
 
 #include "eventloop.hpp"
 #include "eventloopthread.hpp"
+#include "loopplacement.hpp"
 
 using namespace icarus;
 
-EventLoopThread::EventLoopThread(ThreadInitCallback  cb)
+EventLoopThread::EventLoopThread(ThreadInitCallback  cb, PollerBackend backend, int cpu)
   : loop_(nullptr),
     exiting_(false),
-    callback_(std::move(cb))
+    callback_(std::move(cb)),
+    backend_(backend),
+    cpu_(cpu),
+    pinned_(false)
 {
     // ...
 }
@@ -36,20 +40,28 @@ EventLoop *EventLoopThread::start_loop()
     return loop_;
 }
 
+bool EventLoopThread::pinned() const
+{
+    return pinned_;
+}
+
 void EventLoopThread::thread_func()
 {
-    EventLoop loop;
+    // a thread which cannot be pinned keeps running unpinned
+    pinned_ = cpu_ >= 0 && LoopPlacement::pin_current_thread(cpu_);
+    EventLoop loop(backend_);
 
     if (callback_)
     {
         callback_(&loop);
     }
 
-    {
+    // published from inside loop(), a quit() before loop() starts would be lost
+    loop.queue_in_loop([this, &loop] {
         std::unique_lock<std::mutex> lock(mutex_);
         loop_ = &loop;
         cond_.notify_all();
-    }
+    });
 
     loop.loop();
     std::lock_guard<std::mutex> lock(mutex_);
@@ -8,6 +8,7 @@
 #include <condition_variable>
 
 #include "noncopyable.hpp"
+#include "poller.hpp"
 
 namespace icarus
 {
@@ -18,11 +19,17 @@ class EventLoopThread : noncopyable
   public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
 
-    explicit EventLoopThread(ThreadInitCallback cb = ThreadInitCallback());
+    // the thread is pinned to cpu before the loop is built, -1 leaves it floating
+    explicit EventLoopThread(ThreadInitCallback cb = ThreadInitCallback(),
+                             PollerBackend backend = kDefaultPollerBackend,
+                             int cpu = -1);
     ~EventLoopThread();
 
     EventLoop *start_loop();
 
+    // false when the thread floats, also when pinning to cpu failed
+    bool pinned() const;
+
   private:
     void thread_func();
 
@@ -32,6 +39,9 @@ class EventLoopThread : noncopyable
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    PollerBackend backend_;
+    int cpu_;
+    bool pinned_;
 };
 
 } // namespace icarus
@@ -1,4 +1,6 @@
 #include <cassert>
+#include <utility>
+#include <algorithm>
 
 #include "eventloop.hpp"
 #include "eventloopthread.hpp"
@@ -6,11 +8,38 @@
 
 using namespace icarus;
 
+namespace
+{
+// points of every loop on the hash ring, more points even out the arcs
+constexpr std::uint32_t kVirtualNodes = 64;
+
+std::uint32_t mix32(std::uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// score of kLeastPendingWork, lower is better
+std::uint64_t pending_work(const EventLoop *loop)
+{
+    return (loop->busy_ns() + 1) * (loop->queue_size() + 1);
+}
+} // namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *base_loop)
   : base_loop_(base_loop),
     started_(false),
     num_threads_(0),
-    next_(0)
+    backend_(kDefaultPollerBackend),
+    selection_(LoopSelection::kRoundRobin),
+    next_(0),
+    random_state_(0x9e3779b97f4a7c15ULL),
+    prefault_count_(0),
+    prefault_size_(0)
 {
     // ...
 }
@@ -19,7 +48,12 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *base_loop, int num_threads)
   : base_loop_(base_loop),
     started_(false),
     num_threads_(num_threads),
-    next_(0)
+    backend_(kDefaultPollerBackend),
+    selection_(LoopSelection::kRoundRobin),
+    next_(0),
+    random_state_(0x9e3779b97f4a7c15ULL),
+    prefault_count_(0),
+    prefault_size_(0)
 {
     // ...
 }
@@ -34,16 +68,59 @@ void EventLoopThreadPool::set_thread_num(int num_threads)
     num_threads_ = num_threads;
 }
 
-void EventLoopThreadPool::start(const ThreadInitCallback &cb)
+void EventLoopThreadPool::set_poller_backend(PollerBackend backend)
+{
+    backend_ = backend;
+}
+
+void EventLoopThreadPool::set_placement(LoopPlacement placement)
+{
+    placement_ = std::move(placement);
+}
+
+void EventLoopThreadPool::set_loop_selection(LoopSelection selection)
+{
+    assert(!started_);
+    selection_ = selection;
+}
+
+void EventLoopThreadPool::set_loop_selector(LoopSelector selector)
+{
+    assert(!started_);
+    selector_ = std::move(selector);
+}
+
+void EventLoopThreadPool::set_buffer_prefault(std::size_t count, std::size_t size)
+{
+    assert(!started_);
+    prefault_count_ = count;
+    prefault_size_ = size;
+}
+
+void EventLoopThreadPool::start(const ThreadInitCallback &user_cb)
 {
     assert(!started_);
     base_loop_->assert_in_loop_thread();
 
     started_ = true;
 
+    // the prefault runs in each loop's own thread, ahead of the user's init
+    ThreadInitCallback cb = user_cb;
+    if (prefault_count_ > 0)
+    {
+        cb = [user_cb, count = prefault_count_, size = prefault_size_] (EventLoop *loop) {
+            loop->buffer_pool().prefault(size, count);
+            if (user_cb)
+            {
+                user_cb(loop);
+            }
+        };
+    }
+
+    std::vector<int> cpus = placement_.assign(num_threads_);
     for (int i = 0; i < num_threads_; ++i)
     {
-        threads_.push_back(std::make_unique<EventLoopThread>(cb));
+        threads_.push_back(std::make_unique<EventLoopThread>(cb, backend_, cpus[i]));
         loops_.push_back(threads_.back()->start_loop());
     }
 
@@ -51,21 +128,185 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
     {
         cb(base_loop_);
     }
+
+    if (selection_ == LoopSelection::kLeastPendingWork)
+    {
+        for (auto loop : loops_)
+        {
+            loop->set_load_tracking(true);
+        }
+    }
+    build_hash_ring();
 }
 
 EventLoop* EventLoopThreadPool::get_next_loop()
+{
+    return get_next_loop(InetAddress());
+}
+
+EventLoop *EventLoopThreadPool::get_next_loop(const InetAddress &peer_addr)
 {
     base_loop_->assert_in_loop_thread();
     assert(started_);
-    
-    auto loop = base_loop_;
-    if (!loops_.empty())
+
+    if (loops_.empty())
+    {
+        return base_loop_;
+    }
+    if (selector_)
+    {
+        return selector_(loops_, peer_addr);
+    }
+
+    switch (selection_)
+    {
+    case LoopSelection::kLeastConnections:
+        return least_connections();
+
+    case LoopSelection::kLeastPendingWork:
+        return least_pending_work();
+
+    case LoopSelection::kPowerOfTwoChoices:
+        return power_of_two_choices();
+
+    case LoopSelection::kConsistentHash:
+        return consistent_hash(peer_addr);
+
+    case LoopSelection::kRoundRobin:
+    default:
+        return next_round_robin();
+    }
+}
+
+EventLoop *EventLoopThreadPool::next_round_robin()
+{
+    auto loop = loops_[next_];
+    if (++next_ >= loops_.size())
+    {
+        next_ = 0;
+    }
+    return loop;
+}
+
+// the scans start at a rotating index so that ties go round-robin
+EventLoop *EventLoopThreadPool::least_connections()
+{
+    std::size_t start = next_;
+    next_ = (next_ + 1) % loops_.size();
+
+    EventLoop *best = loops_[start];
+    std::size_t best_count = best->connection_count();
+    for (std::size_t i = 1; i < loops_.size() && best_count > 0; ++i)
     {
-        loop = loops_[next_];
-        if (++next_ >= loops_.size())
+        EventLoop *loop = loops_[(start + i) % loops_.size()];
+        std::size_t count = loop->connection_count();
+        if (count < best_count)
         {
-            next_ = 0;
+            best = loop;
+            best_count = count;
         }
     }
-    return loop;
-}
\ No newline at end of file
+    return best;
+}
+
+EventLoop *EventLoopThreadPool::least_pending_work()
+{
+    std::size_t start = next_;
+    next_ = (next_ + 1) % loops_.size();
+
+    EventLoop *best = loops_[start];
+    std::uint64_t best_work = pending_work(best);
+    for (std::size_t i = 1; i < loops_.size(); ++i)
+    {
+        EventLoop *loop = loops_[(start + i) % loops_.size()];
+        std::uint64_t work = pending_work(loop);
+        if (work < best_work)
+        {
+            best = loop;
+            best_work = work;
+        }
+    }
+    return best;
+}
+
+EventLoop *EventLoopThreadPool::power_of_two_choices()
+{
+    std::size_t n = loops_.size();
+    if (n == 1)
+    {
+        return loops_[0];
+    }
+
+    // xorshift64, the acceptor is the only caller
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    std::size_t a = random_state_ % n;
+    std::size_t b = (random_state_ >> 32) % (n - 1);
+    if (b >= a)
+    {
+        ++b;
+    }
+
+    EventLoop *first = loops_[a];
+    EventLoop *second = loops_[b];
+    std::size_t first_count = first->connection_count();
+    std::size_t second_count = second->connection_count();
+    if (first_count != second_count)
+    {
+        return first_count < second_count ? first : second;
+    }
+    return first->queue_size() <= second->queue_size() ? first : second;
+}
+
+// hashes the ip only, the port of a client changes with every connection
+EventLoop *EventLoopThreadPool::consistent_hash(const InetAddress &peer_addr)
+{
+    std::uint32_t hash = mix32(peer_addr.ip_net_endian());
+    auto it = std::lower_bound(hash_ring_.begin(), hash_ring_.end(),
+                               std::make_pair(hash, static_cast<EventLoop *>(nullptr)));
+    return it == hash_ring_.end() ? hash_ring_.front().second : it->second;
+}
+
+void EventLoopThreadPool::build_hash_ring()
+{
+    hash_ring_.clear();
+    for (std::uint32_t i = 0; i < loops_.size(); ++i)
+    {
+        for (std::uint32_t v = 0; v < kVirtualNodes; ++v)
+        {
+            hash_ring_.emplace_back(mix32(i * kVirtualNodes + v + 0x5bd1e995), loops_[i]);
+        }
+    }
+    std::sort(hash_ring_.begin(), hash_ring_.end());
+}
+
+std::vector<EventLoop *> EventLoopThreadPool::get_all_loops()
+{
+    assert(started_);
+    if (loops_.empty())
+    {
+        return std::vector<EventLoop *>(1, base_loop_);
+    }
+    return loops_;
+}
+
+LoopMetricsSnapshot EventLoopThreadPool::metrics() const
+{
+    LoopMetricsSnapshot snapshot = base_loop_->metrics();
+    for (auto loop : loops_)
+    {
+        snapshot.merge(loop->metrics());
+    }
+    return snapshot;
+}
+
+BufferPoolStats EventLoopThreadPool::buffer_pool_stats() const
+{
+    BufferPoolStats stats = base_loop_->buffer_pool().stats();
+    for (auto loop : loops_)
+    {
+        stats.merge(loop->buffer_pool().stats());
+    }
+    return stats;
+}
@@ -3,35 +3,103 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <utility>
 #include <functional>
 
 #include "noncopyable.hpp"
+#include "poller.hpp"
+#include "buffer.hpp"
+#include "bufferpool.hpp"
+#include "loopmetrics.hpp"
+#include "loopplacement.hpp"
+#include "inetaddress.hpp"
 
 namespace icarus
 {
 class EventLoop;
 class EventLoopThread;
 
+// how get_next_loop picks an io loop for a new connection
+enum class LoopSelection
+{
+    kRoundRobin,
+    kLeastConnections,  // fewest connections, ties go round-robin
+    kLeastPendingWork,  // lowest busy time scaled by queued functors
+    kPowerOfTwoChoices, // the less loaded of two random loops
+    kConsistentHash     // same peer ip, same loop while the pool lasts
+};
+
 class EventLoopThreadPool : noncopyable
 {
   public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // custom policy, gets the io loops and the peer of the new connection
+    using LoopSelector = std::function<EventLoop *(const std::vector<EventLoop *> &loops,
+                                                   const InetAddress &peer_addr)>;
+
     EventLoopThreadPool(EventLoop *base_loop);
     EventLoopThreadPool(EventLoop *base_loop, int num_threads);
     ~EventLoopThreadPool();
 
     void set_thread_num(int num_threads);
+    void set_poller_backend(PollerBackend backend);
+
+    // pins the io loops, the base loop is left alone
+    void set_placement(LoopPlacement placement);
+
+    // kRoundRobin by default, must be set before start()
+    void set_loop_selection(LoopSelection selection);
+
+    // replaces the built-in policies, must be set before start()
+    void set_loop_selector(LoopSelector selector);
+
+    // every loop fills its BufferPool with count blocks for size bytes
+    //  before it runs, so the first connections do not fault in their
+    //  buffers. must be set before start()
+    void set_buffer_prefault(std::size_t count,
+                             std::size_t size = Buffer::kCheapPrepend + Buffer::kInitialSize);
+
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
     EventLoop *get_next_loop();
 
+    // like get_next_loop, kConsistentHash and custom selectors use peer_addr
+    EventLoop *get_next_loop(const InetAddress &peer_addr);
+
+    // io loops in creation order, the base loop when there are none
+    std::vector<EventLoop *> get_all_loops();
+
+    // metrics of the base loop and every io loop merged, thread safe
+    //  once started
+    LoopMetricsSnapshot metrics() const;
+
+    // BufferPool stats of the base loop and every io loop merged,
+    //  thread safe once started
+    BufferPoolStats buffer_pool_stats() const;
+
   private:
+    EventLoop *next_round_robin();
+    EventLoop *least_connections();
+    EventLoop *least_pending_work();
+    EventLoop *power_of_two_choices();
+    EventLoop *consistent_hash(const InetAddress &peer_addr);
+    void build_hash_ring();
+
     EventLoop *base_loop_;
     bool started_;
     int num_threads_;
+    PollerBackend backend_;
+    LoopPlacement placement_;
+    LoopSelection selection_;
+    LoopSelector selector_;
     std::size_t next_;
+    std::uint64_t random_state_;
+    std::size_t prefault_count_;
+    std::size_t prefault_size_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop *> loops_;
+    std::vector<std::pair<std::uint32_t, EventLoop *>> hash_ring_;
 };
 
 } // namespace icarus
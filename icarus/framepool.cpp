@@ -0,0 +1,136 @@
+#include <new>
+
+#include "eventloop.hpp"
+#include "framepool.hpp"
+
+using namespace icarus;
+
+namespace
+{
+std::size_t size_class_of(std::size_t size)
+{
+    std::size_t size_class = 0;
+    while ((FramePool::kMinFrameSize << size_class) < size)
+    {
+        ++size_class;
+    }
+    return size_class;
+}
+
+FramePool *current_pool()
+{
+    EventLoop *loop = EventLoop::get_event_loop_of_current_thread();
+    return loop ? &loop->frame_pool() : nullptr;
+}
+
+void bump(std::atomic<std::uint64_t> &counter, std::int64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+} // namespace
+
+FramePool::FramePool()
+  : capacity_(kDefaultCapacity),
+    hits_(0),
+    misses_(0),
+    cached_(0)
+{
+}
+
+FramePool::~FramePool()
+{
+    for (auto &blocks : free_)
+    {
+        for (void *frame : blocks)
+        {
+            ::operator delete(frame);
+        }
+    }
+}
+
+void *FramePool::allocate(std::size_t size)
+{
+    if (size > kMaxFrameSize)
+    {
+        return ::operator new(size);
+    }
+
+    std::size_t size_class = size_class_of(size);
+    FramePool *pool = current_pool();
+    if (pool)
+    {
+        if (void *frame = pool->pop(size_class))
+        {
+            return frame;
+        }
+    }
+    return ::operator new(kMinFrameSize << size_class);
+}
+
+void FramePool::deallocate(void *frame, std::size_t size)
+{
+    if (size <= kMaxFrameSize)
+    {
+        FramePool *pool = current_pool();
+        if (pool && pool->push(size_class_of(size), frame))
+        {
+            return;
+        }
+    }
+    ::operator delete(frame);
+}
+
+void FramePool::set_capacity(std::size_t blocks)
+{
+    capacity_ = blocks;
+    for (auto &free : free_)
+    {
+        while (free.size() > capacity_)
+        {
+            ::operator delete(free.back());
+            free.pop_back();
+            bump(cached_, -1);
+        }
+    }
+}
+
+std::size_t FramePool::capacity() const
+{
+    return capacity_;
+}
+
+FramePoolStats FramePool::stats() const
+{
+    FramePoolStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.cached = cached_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void *FramePool::pop(std::size_t size_class)
+{
+    auto &free = free_[size_class];
+    if (free.empty())
+    {
+        bump(misses_, 1);
+        return nullptr;
+    }
+    void *frame = free.back();
+    free.pop_back();
+    bump(hits_, 1);
+    bump(cached_, -1);
+    return frame;
+}
+
+bool FramePool::push(std::size_t size_class, void *frame)
+{
+    auto &free = free_[size_class];
+    if (free.size() >= capacity_)
+    {
+        return false;
+    }
+    free.push_back(frame);
+    bump(cached_, 1);
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef ICARUS_FRAMEPOOL_HPP
+#define ICARUS_FRAMEPOOL_HPP
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.hpp"
+
+namespace icarus
+{
+struct FramePoolStats
+{
+    std::uint64_t hits = 0;      // served from the free lists
+    std::uint64_t misses = 0;    // went to operator new
+    std::uint64_t cached = 0;    // blocks sitting in the free lists
+};
+
+/**
+ * free lists of coroutine frames, one pool per EventLoop
+ *
+ * frames are rounded up to a power of two size class and each block is
+ *  an ordinary operator new allocation, so a block may be freed into
+ *  any pool or back to the heap. allocate and deallocate use the pool
+ *  of the loop running in the calling thread and the heap in threads
+ *  without a loop. frames above kMaxFrameSize always use the heap.
+*/
+class FramePool : noncopyable
+{
+  public:
+    static constexpr std::size_t kMinFrameSize = 64;
+    static constexpr std::size_t kMaxFrameSize = 4096;
+    static constexpr std::size_t kDefaultCapacity = 1024;
+
+    FramePool();
+    ~FramePool();
+
+    static void *allocate(std::size_t size);
+    static void deallocate(void *frame, std::size_t size);
+
+    // blocks kept per size class, 0 turns pooling off, loop thread only
+    void set_capacity(std::size_t blocks);
+    std::size_t capacity() const;
+
+    // thread safe
+    FramePoolStats stats() const;
+
+  private:
+    static constexpr std::size_t kClasses = 7;  // 64 .. 4096
+
+    void *pop(std::size_t size_class);
+    bool push(std::size_t size_class, void *frame);
+
+    std::size_t capacity_;
+    std::array<std::vector<void *>, kClasses> free_;
+    // written by the loop thread only
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> cached_;
+};
+} // namespace icarus
+
+#endif // ICARUS_FRAMEPOOL_HPP
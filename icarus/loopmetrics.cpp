@@ -0,0 +1,93 @@
+#include <cmath>
+#include <algorithm>
+
+#include "loopmetrics.hpp"
+
+using namespace icarus;
+
+void HistogramSnapshot::merge(const HistogramSnapshot &other)
+{
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+    for (std::size_t i = 0; i < kBuckets; ++i)
+    {
+        buckets[i] += other.buckets[i];
+    }
+}
+
+double HistogramSnapshot::mean() const
+{
+    return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+std::uint64_t HistogramSnapshot::percentile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    auto rank = static_cast<std::uint64_t>(std::ceil(q * count));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank && buckets[i] > 0)
+        {
+            // the largest value recorded is a tighter bound for the last bucket
+            std::uint64_t upper = i == 0 ? 0 : (1ULL << i) - 1;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+Histogram::Histogram()
+  : count_(0),
+    sum_(0),
+    max_(0)
+{
+    for (auto &bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < HistogramSnapshot::kBuckets; ++i)
+    {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void LoopMetricsSnapshot::merge(const LoopMetricsSnapshot &other)
+{
+    loops += other.loops;
+    iteration_ns.merge(other.iteration_ns);
+    poll_wait_ns.merge(other.poll_wait_ns);
+    dispatch_ns.merge(other.dispatch_ns);
+    functor_ns.merge(other.functor_ns);
+    active_channels.merge(other.active_channels);
+    queue_depth.merge(other.queue_depth);
+    wakeups += other.wakeups;
+}
+
+LoopMetricsSnapshot LoopMetrics::snapshot() const
+{
+    LoopMetricsSnapshot snapshot;
+    snapshot.loops = 1;
+    snapshot.iteration_ns = iteration_ns.snapshot();
+    snapshot.poll_wait_ns = poll_wait_ns.snapshot();
+    snapshot.dispatch_ns = dispatch_ns.snapshot();
+    snapshot.functor_ns = functor_ns.snapshot();
+    snapshot.active_channels = active_channels.snapshot();
+    snapshot.queue_depth = queue_depth.snapshot();
+    snapshot.wakeups = wakeups_.load(std::memory_order_relaxed);
+    return snapshot;
+}
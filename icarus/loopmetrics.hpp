@@ -0,0 +1,116 @@
+#ifndef ICARUS_LOOPMETRICS_HPP
+#define ICARUS_LOOPMETRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "noncopyable.hpp"
+
+namespace icarus
+{
+// copy of a Histogram, can be merged with others
+struct HistogramSnapshot
+{
+    static constexpr std::size_t kBuckets = 64;
+
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+    // bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i)
+    std::array<std::uint64_t, kBuckets> buckets{};
+
+    void merge(const HistogramSnapshot &other);
+
+    double mean() const;
+
+    // upper bound of the bucket holding the given quantile, 0 < q <= 1
+    std::uint64_t percentile(double q) const;
+};
+
+/**
+ * log2 bucketed histogram with a single writer
+ *
+ * the owning thread records with relaxed loads and stores, no
+ *  read-modify-write, any thread can take a snapshot. a snapshot taken
+ *  while recording may be off by the values in flight, never torn.
+*/
+class Histogram : noncopyable
+{
+  public:
+    Histogram();
+
+    void record(std::uint64_t value)
+    {
+        std::size_t index = value == 0 ? 0 : 64 - __builtin_clzll(value);
+        if (index >= HistogramSnapshot::kBuckets)
+        {
+            index = HistogramSnapshot::kBuckets - 1;
+        }
+        add(buckets_[index], 1);
+        add(count_, 1);
+        add(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed))
+        {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    HistogramSnapshot snapshot() const;
+
+  private:
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> max_;
+    std::array<std::atomic<std::uint64_t>, HistogramSnapshot::kBuckets> buckets_;
+};
+
+// copy of the metrics of one or more loops
+struct LoopMetricsSnapshot
+{
+    std::uint64_t loops = 0;            // number of loops merged in
+    HistogramSnapshot iteration_ns;     // one pass of EventLoop::loop
+    HistogramSnapshot poll_wait_ns;     // blocked in Poller::poll
+    HistogramSnapshot dispatch_ns;      // Channel::handle_event of all active channels
+    HistogramSnapshot functor_ns;       // do_pending_functors
+    HistogramSnapshot active_channels;  // per iteration
+    HistogramSnapshot queue_depth;      // pending functors when draining starts
+    std::uint64_t wakeups = 0;          // eventfd writes seen by the loop
+
+    void merge(const LoopMetricsSnapshot &other);
+};
+
+/**
+ * per-loop histograms, written by the loop thread only
+ *
+ * EventLoop records into them when icarus is built with ICARUS_METRICS,
+ *  otherwise the loop has none and its snapshots are empty.
+*/
+class LoopMetrics : noncopyable
+{
+  public:
+    void record_wakeups(std::uint64_t n)
+    {
+        wakeups_.store(wakeups_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    LoopMetricsSnapshot snapshot() const;
+
+    Histogram iteration_ns;
+    Histogram poll_wait_ns;
+    Histogram dispatch_ns;
+    Histogram functor_ns;
+    Histogram active_channels;
+    Histogram queue_depth;
+
+  private:
+    std::atomic<std::uint64_t> wakeups_{0};
+};
+} // namespace icarus
+
+#endif // ICARUS_LOOPMETRICS_HPP
@@ -0,0 +1,229 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "loopplacement.hpp"
+
+using namespace icarus;
+
+namespace
+{
+int read_int(const char *path, int default_value)
+{
+    int value = default_value;
+    FILE *file = ::fopen(path, "r");
+    if (file)
+    {
+        if (::fscanf(file, "%d", &value) != 1)
+        {
+            value = default_value;
+        }
+        ::fclose(file);
+    }
+    return value;
+}
+
+int read_topology(int cpu, const char *name, int default_value)
+{
+    char path[128];
+    ::snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    return read_int(path, default_value);
+}
+
+// cpus sorted by rank, the first num_loops of them get a loop each
+std::vector<int> order(std::vector<CpuInfo> cpus, bool by_node_first)
+{
+    std::sort(cpus.begin(), cpus.end(), [by_node_first] (const CpuInfo &a, const CpuInfo &b) {
+        if (by_node_first && a.node != b.node)
+        {
+            return a.node < b.node;
+        }
+        if (a.sibling != b.sibling)
+        {
+            return a.sibling < b.sibling;
+        }
+        return std::make_tuple(a.node, a.package, a.core, a.cpu)
+             < std::make_tuple(b.node, b.package, b.core, b.cpu);
+    });
+
+    std::vector<int> result;
+    for (auto &info : cpus)
+    {
+        result.push_back(info.cpu);
+    }
+    return result;
+}
+} // namespace
+
+LoopPlacement::LoopPlacement()
+  : policy_(kNone)
+{
+}
+
+LoopPlacement::LoopPlacement(Policy policy, std::vector<int> cpus)
+  : policy_(policy),
+    cpus_(std::move(cpus))
+{
+}
+
+LoopPlacement LoopPlacement::cpu_list(std::vector<int> cpus)
+{
+    return LoopPlacement(kCpuList, std::move(cpus));
+}
+
+LoopPlacement LoopPlacement::physical_cores()
+{
+    return LoopPlacement(kPhysicalCores);
+}
+
+LoopPlacement LoopPlacement::numa_packed()
+{
+    return LoopPlacement(kNumaPacked);
+}
+
+LoopPlacement::Policy LoopPlacement::policy() const
+{
+    return policy_;
+}
+
+std::vector<int> LoopPlacement::assign(int num_loops) const
+{
+    std::vector<int> ranked;
+    switch (policy_)
+    {
+    case kCpuList:
+        ranked = cpus_;
+        break;
+
+    case kPhysicalCores:
+        ranked = order(available_cpus(), false);
+        break;
+
+    case kNumaPacked:
+        ranked = order(available_cpus(), true);
+        break;
+
+    case kNone:
+    default:
+        break;
+    }
+
+    std::vector<int> result(num_loops, -1);
+    if (!ranked.empty())
+    {
+        for (int i = 0; i < num_loops; ++i)
+        {
+            result[i] = ranked[i % ranked.size()];
+        }
+    }
+    return result;
+}
+
+std::vector<CpuInfo> LoopPlacement::available_cpus()
+{
+    std::vector<CpuInfo> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof set, &set) < 0)
+    {
+        return cpus;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &set))
+        {
+            CpuInfo info;
+            info.cpu = cpu;
+            info.core = read_topology(cpu, "core_id", cpu);
+            info.package = read_topology(cpu, "physical_package_id", 0);
+            info.node = numa_node_of(cpu);
+            info.sibling = 0;
+            for (auto &other : cpus)
+            {
+                if (other.core == info.core && other.package == info.package)
+                {
+                    ++info.sibling;
+                }
+            }
+            cpus.push_back(info);
+        }
+    }
+    return cpus;
+}
+
+int LoopPlacement::numa_node_of(int cpu)
+{
+    char path[64];
+    ::snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = ::opendir(path);
+    if (!dir)
+    {
+        return 0;
+    }
+
+    int node = 0;
+    while (struct dirent *entry = ::readdir(dir))
+    {
+        if (::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+        {
+            node = ::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    ::closedir(dir);
+    return node;
+}
+
+bool LoopPlacement::pin_current_thread(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof set, &set) != 0)
+    {
+        return false;
+    }
+
+    // first touch already lands on the local node, the policy also
+    //  covers pages the kernel would otherwise place elsewhere under pressure
+    int node = numa_node_of(cpu);
+    constexpr int kBitsPerLong = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(node / kBitsPerLong + 1, 0);
+    mask[node / kBitsPerLong] |= 1UL << (node % kBitsPerLong);
+    ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(), mask.size() * kBitsPerLong + 1);
+    return true;
+}
+
+int LoopPlacement::pinned_cpu_of_current_thread()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::pthread_getaffinity_np(::pthread_self(), sizeof set, &set) != 0 || CPU_COUNT(&set) != 1)
+    {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &set))
+        {
+            return cpu;
+        }
+    }
+    return -1;
+}
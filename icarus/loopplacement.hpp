@@ -0,0 +1,67 @@
+#ifndef ICARUS_LOOPPLACEMENT_HPP
+#define ICARUS_LOOPPLACEMENT_HPP
+
+#include <vector>
+
+namespace icarus
+{
+// one cpu the process may run on, from /sys/devices/system/cpu
+struct CpuInfo
+{
+    int cpu;
+    int core;       // core_id, unique within a package
+    int package;
+    int node;       // numa node, 0 without numa
+    int sibling;    // 0 for the first hardware thread of its core
+};
+
+/**
+ * where EventLoopThreadPool pins its loops
+ *
+ * only cpus in the process affinity mask are used. a pinned loop thread
+ *  prefers memory of its numa node, so the buffers it touches first stay
+ *  local. when there are more loops than cpus the assignment wraps around.
+*/
+class LoopPlacement
+{
+  public:
+    enum Policy
+    {
+        kNone,          // threads float, the default
+        kCpuList,       // loop i runs on cpus[i]
+        kPhysicalCores, // one loop per physical core, siblings only after all cores
+        kNumaPacked     // fills the physical cores of one node before the next node
+    };
+
+    LoopPlacement();
+
+    static LoopPlacement cpu_list(std::vector<int> cpus);
+    static LoopPlacement physical_cores();
+    static LoopPlacement numa_packed();
+
+    Policy policy() const;
+
+    // cpu of every loop, -1 for unpinned ones
+    std::vector<int> assign(int num_loops) const;
+
+    // cpus in the affinity mask of the calling thread with their topology
+    static std::vector<CpuInfo> available_cpus();
+
+    // numa node of cpu, 0 when unknown
+    static int numa_node_of(int cpu);
+
+    // pins the calling thread to cpu and prefers memory of its node
+    static bool pin_current_thread(int cpu);
+
+    // the only cpu the calling thread may run on, -1 when there are more
+    static int pinned_cpu_of_current_thread();
+
+  private:
+    explicit LoopPlacement(Policy policy, std::vector<int> cpus = std::vector<int>());
+
+    Policy policy_;
+    std::vector<int> cpus_;
+};
+} // namespace icarus
+
+#endif // ICARUS_LOOPPLACEMENT_HPP
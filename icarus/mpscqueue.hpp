@@ -0,0 +1,132 @@
+#ifndef ICARUS_MPSCQUEUE_HPP
+#define ICARUS_MPSCQUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+#include "noncopyable.hpp"
+
+namespace icarus
+{
+/**
+ * unbounded lock-free multi-producer single-consumer queue (Vyukov)
+ *
+ * push is wait-free: one exchange and one store. try_pop may report empty
+ *  while a producer is between those two steps, the consumer has to
+ *  retry if it knows an element was pushed.
+ *
+ * popped nodes go back to a free stack which producers take over whole
+ *  into a per-thread cache, so a queue at steady depth does not allocate.
+*/
+template <typename T>
+class MpscQueue : noncopyable
+{
+  public:
+    MpscQueue()
+      : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)), free_(nullptr)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (try_pop(value))
+        {
+        }
+        delete tail_;
+
+        Node *node = free_.load(std::memory_order_acquire);
+        while (node)
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    // thread safe
+    void push(T value)
+    {
+        Node *node = alloc_node();
+        node->value = std::move(value);
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // consumer thread only
+    bool try_pop(T &value)
+    {
+        Node *next = tail_->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        value = std::move(next->value);
+        free_node(tail_);
+        tail_ = next;
+        return true;
+    }
+
+  private:
+    struct Node
+    {
+        Node()
+          : next(nullptr)
+        {
+        }
+
+        std::atomic<Node *> next;
+        T value;
+    };
+
+    struct NodeCache
+    {
+        ~NodeCache()
+        {
+            while (head)
+            {
+                Node *next = head->next.load(std::memory_order_relaxed);
+                delete head;
+                head = next;
+            }
+        }
+
+        Node *head = nullptr;
+    };
+
+    Node *alloc_node()
+    {
+        static thread_local NodeCache cache;
+        if (!cache.head)
+        {
+            // taking the whole stack at once leaves no room for ABA
+            cache.head = free_.exchange(nullptr, std::memory_order_acquire);
+            if (!cache.head)
+            {
+                return new Node();
+            }
+        }
+        Node *node = cache.head;
+        cache.head = node->next.load(std::memory_order_relaxed);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        return node;
+    }
+
+    // consumer thread only
+    void free_node(Node *node)
+    {
+        Node *top = free_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(top, std::memory_order_relaxed);
+        } while (!free_.compare_exchange_weak(top, node, std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    alignas(64) std::atomic<Node *> head_;
+    alignas(64) Node *tail_;
+    alignas(64) std::atomic<Node *> free_;
+};
+} // namespace icarus
+
+#endif // ICARUS_MPSCQUEUE_HPP
@@ -1,191 +1,103 @@
 #include <cassert>
 
-#include <utility>
-
-#ifdef USE_EPOLL
-#include <sys/epoll.h>
-#include <unistd.h>
-#else
-#include <poll.h>
-#endif
-
 #include "eventloop.hpp"
 #include "channel.hpp"
 #include "poller.hpp"
+#include "pollpoller.hpp"
+#include "epollpoller.hpp"
+#include "uringpoller.hpp"
 
 using namespace icarus;
 
-Poller::Poller(EventLoop *loop)
-  : owner_loop_(loop)
+std::unique_ptr<Poller> Poller::new_poller(EventLoop *loop, PollerBackend backend)
 {
-#ifdef USE_EPOLL
-    epoll_fd_ = ::epoll_create(10);
-    if (epoll_fd_ == -1)
+    switch (backend)
     {
-        abort();
+    case PollerBackend::kPoll:
+        return std::make_unique<PollPoller>(loop);
+
+    case PollerBackend::kIoUring:
+        if (UringPoller::supported())
+        {
+            return std::make_unique<UringPoller>(loop);
+        }
+        return std::make_unique<EPollPoller>(loop);
+
+    case PollerBackend::kEpoll:
+    default:
+        return std::make_unique<EPollPoller>(loop);
     }
-#endif
 }
 
-Poller::~Poller()
+Poller::Poller(EventLoop *loop)
+  : owner_loop_(loop),
+    polls_(0),
+    events_(0),
+    full_polls_(0),
+    max_events_(0),
+    event_list_size_(0)
 {
-#ifdef USE_EPOLL
-    ::close(epoll_fd_);
-#endif
+    // ...
 }
 
-std::chrono::system_clock::time_point Poller::poll(int timeout_ms, ChannelList *active_channels)
-{
-#ifdef USE_EPOLL
-    int num_events = ::epoll_wait(epoll_fd_, epoll_events_.data(), epoll_events_.size(), timeout_ms);
-#else
-    int num_events = ::poll(pollfds_.data(), pollfds_.size(), timeout_ms);
-#endif
-    auto now = std::chrono::system_clock::now();
+Poller::~Poller() = default;
 
-    if (num_events > 0)
-    {
-        fill_active_channels(num_events, active_channels);
-    }
-    else if (num_events < 0)
-    {
-        abort();
-    }
+void Poller::assert_in_loop_thread()
+{
+    owner_loop_->assert_in_loop_thread();
+}
 
-    return now;
+PollerStats Poller::stats() const
+{
+    PollerStats stats;
+    stats.polls = polls_.load(std::memory_order_relaxed);
+    stats.events = events_.load(std::memory_order_relaxed);
+    stats.full_polls = full_polls_.load(std::memory_order_relaxed);
+    stats.max_events = max_events_.load(std::memory_order_relaxed);
+    stats.event_list_size = event_list_size_.load(std::memory_order_relaxed);
+    return stats;
 }
 
-void Poller::update_channel(Channel *channel)
+bool Poller::has_channel(Channel *channel) const
 {
-    assert_in_loop_thread();
-    if (channel->index() < 0)
-    {
-        // a new one, add to pollfds_
-        assert(!channels_.count(channel->fd()));
-#ifdef USE_EPOLL
-        epoll_event event;
-        event.events = channel->events();
-        event.data.fd = channel->fd();
-        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, channel->fd(), &event) == -1)
-        {
-            abort();
-        }
-        epoll_events_.push_back(event);
-        int idx = static_cast<int>(epoll_events_.size()) - 1;
-#else
-        pollfds_.push_back({
-            channel->is_none_event() ? -channel->fd() - 1 : channel->fd(),
-            channel->events(),
-            0 // revents
-        });
-        int idx = static_cast<int>(pollfds_.size()) - 1;
-#endif
-        channel->set_index(idx);
-        channels_[channel->fd()] = channel;
-    }
-    else
-    {
-        // update existing one
-        assert(channels_.count(channel->fd()));
-        assert(channels_[channel->fd()] == channel);
-#ifdef USE_EPOLL
-        if (!channel->is_none_event())
-        {
-            epoll_event event;
-            event.events = channel->events();
-            event.data.fd = channel->fd();
-            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, channel->fd(), &event) == -1)
-            {
-                abort();
-            }
-        }
-        else
-        {
-            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, channel->fd(), nullptr) == -1)
-            {
-                abort();
-            }
-        }
-#else
-        int idx = channel->index();
-        assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
-        auto &pfd = pollfds_[idx];
-        assert(pfd.fd == channel->fd() || pfd.fd == -channel->fd() - 1);
-        pfd.fd = channel->is_none_event() ? -channel->fd() - 1 : channel->fd();
-        pfd.events = channel->events();
-        pfd.revents = 0;
-#endif
-    }
+    return find_channel(channel->fd()) == channel;
 }
 
-void Poller::remove_channel(Channel *channel)
+void Poller::add_channel(Channel *channel)
 {
-    assert_in_loop_thread();
-    assert(channels_.count(channel->fd()));
-    assert(channels_[channel->fd()] == channel);
-    assert(channel->is_none_event());
-    int idx = channel->index();
-#ifdef USE_EPOLL
-    assert(0 <= idx && idx < static_cast<int>(epoll_events_.size()));
-    epoll_events_.pop_back();
-#else
-    assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
-    auto &pfd = pollfds_[idx];
-    assert(pfd.fd == -channel->fd() - 1 && pfd.events == channel->events());
-    if (idx == static_cast<int>(pollfds_.size()) - 1)
+    assert(!has_channel(channel));
+    if (static_cast<std::size_t>(channel->fd()) >= channels_.size())
     {
-        pollfds_.pop_back();
+        channels_.resize(channel->fd() + 1);
     }
-    else
-    {
-        int channel_at_end = pollfds_.back().fd;
-        std::swap(pollfds_[idx], pollfds_.back());
-        if (channel_at_end < 0)
-        {
-            channel_at_end = -channel_at_end - 1;
-        }
-        channels_[channel_at_end]->set_index(idx);
-        pollfds_.pop_back();
-    }
-#endif
-    auto n = channels_.erase(channel->fd());
-    assert(n == 1);
+    channels_[channel->fd()] = channel;
 }
 
-void Poller::fill_active_channels(int num_events, ChannelList *active_channels) const
+void Poller::erase_channel(Channel *channel)
 {
-#ifdef USE_EPOLL
-    for (int i = 0; i < num_events; ++i)
-#else
-    for (auto pfd = pollfds_.begin();
-        pfd != pollfds_.end() && num_events > 0; ++pfd)
-#endif
-    {
-#ifdef USE_EPOLL
-            int fd = epoll_events_[i].data.fd;
-            int revent = epoll_events_[i].events;
-#else
-        if (pfd->revents > 0)
-        {
-            --num_events;
-            int fd = pfd->fd;
-            int revent = pfd->revents;
-#endif
-            auto ch = channels_.find(fd);
-            assert(ch != channels_.end());
-            auto channel = ch->second;
-            assert(channel->fd() == fd);
-            channel->set_revents(revent);
-            // pfd->revents = 0;
-            active_channels->push_back(channel);
-#ifndef USE_EPOLL
-        }
-#endif
-    }
+    assert(has_channel(channel));
+    channels_[channel->fd()] = nullptr;
+}
 
+Channel *Poller::find_channel(int fd) const
+{
+    auto index = static_cast<std::size_t>(fd);
+    return index < channels_.size() ? channels_[index] : nullptr;
 }
 
-void Poller::assert_in_loop_thread()
+void Poller::record_poll(std::size_t num_events, bool full, std::size_t event_list_size)
 {
-    owner_loop_->assert_in_loop_thread();
+    // single writer, plain load and store are enough
+    auto n = static_cast<std::uint64_t>(num_events);
+    polls_.store(polls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    events_.store(events_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    if (full)
+    {
+        full_polls_.store(full_polls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    if (n > max_events_.load(std::memory_order_relaxed))
+    {
+        max_events_.store(n, std::memory_order_relaxed);
+    }
+    event_list_size_.store(event_list_size, std::memory_order_relaxed);
 }
@@ -1,58 +1,86 @@
 #ifndef ICARUS_POLLER_HPP
 #define ICARUS_POLLER_HPP
 
-#include <map>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <chrono>
+#include <cstdint>
 
 #include "noncopyable.hpp"
 
+namespace icarus
+{
+class EventLoop;
+class Channel;
+
+enum class PollerBackend
+{
+    kPoll,
+    kEpoll,
+    kIoUring
+};
+
+// the backend of a default constructed EventLoop
 #ifdef USE_EPOLL
-struct epoll_event;
+constexpr PollerBackend kDefaultPollerBackend = PollerBackend::kEpoll;
 #else
-struct pollfd;
+constexpr PollerBackend kDefaultPollerBackend = PollerBackend::kPoll;
 #endif
 
-namespace icarus
+// counters of a Poller, readable from any thread
+struct PollerStats
 {
-class EventLoop;
-class Channel;
+    std::uint64_t polls;            // returns from poll/epoll_wait/io_uring_enter
+    std::uint64_t events;           // ready events over all polls
+    std::uint64_t full_polls;       // polls which filled the whole event list
+    std::uint64_t max_events;       // largest number of events in one poll
+    std::size_t event_list_size;    // current capacity of the event list
+};
 
 class Poller : noncopyable
 {
   public:
     using ChannelList = std::vector<Channel *>;
 
-    Poller(EventLoop *loop);
+    // io_uring falls back to epoll when the kernel does not support it
+    static std::unique_ptr<Poller> new_poller(EventLoop *loop, PollerBackend backend);
 
-    ~Poller();
+    explicit Poller(EventLoop *loop);
 
-    std::chrono::system_clock::time_point poll(int timeout_ms, ChannelList *active_channels);
+    virtual ~Poller();
 
-    void update_channel(Channel *channel);
-    void remove_channel(Channel *channel);
+    virtual std::chrono::system_clock::time_point poll(int timeout_ms, ChannelList *active_channels) = 0;
+
+    virtual void update_channel(Channel *channel) = 0;
+    virtual void remove_channel(Channel *channel) = 0;
+
+    virtual PollerBackend backend() const = 0;
 
     void assert_in_loop_thread();
 
-  private:
-    void fill_active_channels(int num_events, ChannelList *active_channels) const;
+    PollerStats stats() const;
 
-#ifdef USE_EPOLL
-    using EpollEventList = std::vector<epoll_event>;
-#else
-    using PollFdList = std::vector<pollfd>;
-#endif
+  protected:
+    bool has_channel(Channel *channel) const;
+    void add_channel(Channel *channel);
+    void erase_channel(Channel *channel);
+    Channel *find_channel(int fd) const;
 
-    using ChannelMap = std::map<int, Channel *>;
+    // only called by the loop thread
+    void record_poll(std::size_t num_events, bool full, std::size_t event_list_size);
+
+  private:
+    // indexed by fd, nullptr for fds not registered here
+    using ChannelTable = std::vector<Channel *>;
 
     EventLoop *owner_loop_;
-    ChannelMap channels_;
-#ifdef USE_EPOLL
-    int epoll_fd_;
-    EpollEventList epoll_events_;
-#else
-    PollFdList pollfds_;
-#endif
+    ChannelTable channels_;
+    std::atomic<std::uint64_t> polls_;
+    std::atomic<std::uint64_t> events_;
+    std::atomic<std::uint64_t> full_polls_;
+    std::atomic<std::uint64_t> max_events_;
+    std::atomic<std::size_t> event_list_size_;
 };
 }
 #endif // ICARUS_POLLER_HPP
@@ -0,0 +1,117 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+
+#include <utility>
+
+#include <poll.h>
+
+#include "channel.hpp"
+#include "pollpoller.hpp"
+
+using namespace icarus;
+
+PollPoller::PollPoller(EventLoop *loop)
+  : Poller(loop)
+{
+    // ...
+}
+
+PollPoller::~PollPoller() = default;
+
+std::chrono::system_clock::time_point PollPoller::poll(int timeout_ms, ChannelList *active_channels)
+{
+    int num_events = ::poll(pollfds_.data(), pollfds_.size(), timeout_ms);
+    auto now = std::chrono::system_clock::now();
+
+    if (num_events > 0)
+    {
+        fill_active_channels(num_events, active_channels);
+    }
+    else if (num_events < 0 && errno != EINTR)
+    {
+        abort();
+    }
+
+    std::size_t n = num_events > 0 ? num_events : 0;
+    record_poll(n, n == pollfds_.size(), pollfds_.size());
+    return now;
+}
+
+void PollPoller::update_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    if (channel->index() < 0)
+    {
+        // a new one, add to pollfds_
+        pollfds_.push_back({
+            channel->is_none_event() ? -channel->fd() - 1 : channel->fd(),
+            channel->events(),
+            0 // revents
+        });
+        int idx = static_cast<int>(pollfds_.size()) - 1;
+        channel->set_index(idx);
+        add_channel(channel);
+    }
+    else
+    {
+        // update existing one
+        assert(has_channel(channel));
+        int idx = channel->index();
+        assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
+        auto &pfd = pollfds_[idx];
+        assert(pfd.fd == channel->fd() || pfd.fd == -channel->fd() - 1);
+        pfd.fd = channel->is_none_event() ? -channel->fd() - 1 : channel->fd();
+        pfd.events = channel->events();
+        pfd.revents = 0;
+    }
+}
+
+void PollPoller::remove_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    assert(has_channel(channel));
+    assert(channel->is_none_event());
+    int idx = channel->index();
+    assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
+    auto &pfd = pollfds_[idx];
+    assert(pfd.fd == -channel->fd() - 1 && pfd.events == channel->events());
+    if (idx == static_cast<int>(pollfds_.size()) - 1)
+    {
+        pollfds_.pop_back();
+    }
+    else
+    {
+        int channel_at_end = pollfds_.back().fd;
+        std::swap(pollfds_[idx], pollfds_.back());
+        if (channel_at_end < 0)
+        {
+            channel_at_end = -channel_at_end - 1;
+        }
+        find_channel(channel_at_end)->set_index(idx);
+        pollfds_.pop_back();
+    }
+    channel->set_index(-1);
+    erase_channel(channel);
+}
+
+PollerBackend PollPoller::backend() const
+{
+    return PollerBackend::kPoll;
+}
+
+void PollPoller::fill_active_channels(int num_events, ChannelList *active_channels) const
+{
+    for (auto pfd = pollfds_.begin();
+        pfd != pollfds_.end() && num_events > 0; ++pfd)
+    {
+        if (pfd->revents > 0)
+        {
+            --num_events;
+            auto channel = find_channel(pfd->fd);
+            assert(channel && channel->fd() == pfd->fd);
+            channel->set_revents(pfd->revents);
+            active_channels->push_back(channel);
+        }
+    }
+}
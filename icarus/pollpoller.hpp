@@ -0,0 +1,35 @@
+#ifndef ICARUS_POLLPOLLER_HPP
+#define ICARUS_POLLPOLLER_HPP
+
+#include <vector>
+
+#include "poller.hpp"
+
+struct pollfd;
+
+namespace icarus
+{
+// poll(2) backend
+class PollPoller : public Poller
+{
+  public:
+    explicit PollPoller(EventLoop *loop);
+    ~PollPoller() override;
+
+    std::chrono::system_clock::time_point poll(int timeout_ms, ChannelList *active_channels) override;
+
+    void update_channel(Channel *channel) override;
+    void remove_channel(Channel *channel) override;
+
+    PollerBackend backend() const override;
+
+  private:
+    void fill_active_channels(int num_events, ChannelList *active_channels) const;
+
+    using PollFdList = std::vector<pollfd>;
+
+    PollFdList pollfds_;
+};
+} // namespace icarus
+
+#endif // ICARUS_POLLPOLLER_HPP
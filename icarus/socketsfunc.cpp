@@ -6,6 +6,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <endian.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 
 #include "socketsfunc.hpp"
 
@@ -60,13 +63,13 @@ int accept(int sockfd, struct sockaddr_in *addr)
         case EPROTO: // ???
         case EPERM:
         case EMFILE: // per-process lmit of open file desctiptor ???
+        case ENFILE:
             // expected errors
             errno = savedErrno;
             break;
         case EBADF:
         case EFAULT:
         case EINVAL:
-        case ENFILE:
         case ENOBUFS:
         case ENOMEM:
         case ENOTSOCK:
@@ -148,6 +151,33 @@ ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt)
     return ::readv(sockfd, iov, iovcnt);
 }
 
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+    return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sendfile(int sockfd, int fd, off_t *offset, size_t count)
+{
+    return ::sendfile(sockfd, fd, offset, count);
+}
+
+ssize_t splice_from_pipe(int pipefd, int sockfd, size_t count)
+{
+    return ::splice(pipefd, nullptr, sockfd, nullptr, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+
+bool is_pipe(int fd)
+{
+    struct stat st;
+    return ::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+bool pipe_empty(int pipefd)
+{
+    struct pollfd pfd = { pipefd, POLLIN, 0 };
+    return ::poll(&pfd, 1, 0) == 0;
+}
+
 int get_socket_error(int sockfd)
 {
     int optval;
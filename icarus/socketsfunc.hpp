@@ -29,6 +29,14 @@ uint16_t network_to_host16(uint16_t net16);
 
 ssize_t write(int fd, const void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+
+// file to socket inside the kernel, offset advances by what was sent
+ssize_t sendfile(int sockfd, int fd, off_t *offset, size_t count);
+ssize_t splice_from_pipe(int pipefd, int sockfd, size_t count);
+bool is_pipe(int fd);
+// nothing to read right now, without blocking
+bool pipe_empty(int pipefd);
 
 int get_socket_error(int sockfd);
 
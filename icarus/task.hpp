@@ -0,0 +1,277 @@
+#ifndef ICARUS_TASK_HPP
+#define ICARUS_TASK_HPP
+
+#include <utility>
+#include <optional>
+#include <exception>
+#include <coroutine>
+
+#include "framepool.hpp"
+
+namespace icarus
+{
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+// parts of the promise shared by every Task<T>
+class PromiseBase
+{
+  public:
+    // frames come from the FramePool of the loop running the caller
+    static void *operator new(std::size_t size)
+    {
+        return FramePool::allocate(size);
+    }
+
+    static void operator delete(void *frame, std::size_t size)
+    {
+        FramePool::deallocate(frame, size);
+    }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            PromiseBase &promise = handle.promise();
+            if (promise.continuation_)
+            {
+                return promise.continuation_;
+            }
+            if (promise.detached_)
+            {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    // tasks are lazy, they start once awaited or spawned
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        if (detached_)
+        {
+            // nobody is left to see it
+            std::terminate();
+        }
+        exception_ = std::current_exception();
+    }
+
+    void set_continuation(std::coroutine_handle<> continuation)
+    {
+        continuation_ = continuation;
+    }
+
+    void detach()
+    {
+        detached_ = true;
+    }
+
+  protected:
+    void rethrow_if_failed()
+    {
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+  private:
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr exception_;
+    bool detached_ = false;
+};
+
+template <typename T>
+class Promise : public PromiseBase
+{
+  public:
+    Task<T> get_return_object();
+
+    template <typename U>
+    void return_value(U &&value)
+    {
+        value_.emplace(std::forward<U>(value));
+    }
+
+    T result()
+    {
+        rethrow_if_failed();
+        return std::move(*value_);
+    }
+
+  private:
+    std::optional<T> value_;
+};
+
+template <>
+class Promise<void> : public PromiseBase
+{
+  public:
+    Task<void> get_return_object();
+
+    void return_void()
+    {
+    }
+
+    void result()
+    {
+        rethrow_if_failed();
+    }
+};
+} // namespace detail
+
+/**
+ * lazily started coroutine returning T
+ *
+ * a Task runs once it is co_awaited, the awaiting coroutine resumes
+ *  right where the task finishes, without a trip through the loop.
+ *  the awaitables of EventLoop, TcpConnection and TcpClient resume their
+ *  coroutine directly from the loop thread's callbacks, so a chain of
+ *  tasks started in a loop thread stays in that thread.
+ *
+ * gcc 12 misplaces the promise of a coroutine with a co_await inside an
+ *  if or while condition, await into a variable and test that instead.
+*/
+template <typename T>
+class Task
+{
+  public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+
+    explicit Task(Handle handle)
+      : handle_(handle)
+    {
+    }
+
+    Task(Task &&rhs) noexcept
+      : handle_(std::exchange(rhs.handle_, nullptr))
+    {
+    }
+
+    Task &operator=(Task &&rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            handle_ = std::exchange(rhs.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        reset();
+    }
+
+    bool valid() const
+    {
+        return static_cast<bool>(handle_);
+    }
+
+    bool done() const
+    {
+        return handle_ && handle_.done();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().set_continuation(awaiting);
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().result();
+            }
+        };
+        return Awaiter{ handle_ };
+    }
+
+    auto operator co_await() & noexcept
+    {
+        return std::move(*this).operator co_await();
+    }
+
+    // runs the task until its first suspension, afterwards it owns itself
+    //  and frees its frame when it finishes
+    void start() &&
+    {
+        Handle handle = std::exchange(handle_, nullptr);
+        handle.promise().detach();
+        handle.resume();
+    }
+
+  private:
+    void reset()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    Handle handle_;
+};
+
+namespace detail
+{
+template <typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+} // namespace detail
+
+// starts a fire-and-forget task, see Task::start
+inline void spawn(Task<void> task)
+{
+    std::move(task).start();
+}
+} // namespace icarus
+
+#endif // ICARUS_TASK_HPP
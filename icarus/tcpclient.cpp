@@ -1,4 +1,5 @@
 #include <cassert>
+#include <utility>
 
 #include "connector.hpp"
 #include "tcpclient.hpp"
@@ -10,17 +11,25 @@ namespace icarus
 {
 TcpClient::TcpClient(EventLoop *loop, const InetAddress &server_addr, std::string name)
   : loop_(loop)
-  , connector_(std::make_unique<Connector>(loop, server_addr))
+  , connector_(std::make_shared<Connector>(loop, server_addr))
   , name_(std::move(name))
   , connection_callback_(TcpConnection::default_connection_callback)
   , message_callback_(TcpConnection::default_message_callback)
   , retry_(false)
   , connect_(true)
+  , edge_triggered_(false)
+  , buffer_slab_size_(0)
+  , buffer_release_threshold_(TcpConnection::kKeepBuffers)
   , next_conn_id_(1)
+  , connect_waiter_(nullptr)
 {
     connector_->set_new_connection_callback([this] (int sockfd) {
         this->new_connection(sockfd);
     });
+    connector_->set_error_callback([this] {
+        this->resume_connect_waiter(nullptr);
+    });
+    connector_->set_retry(retry_);
 }
 
 TcpClient::~TcpClient()
@@ -34,7 +43,7 @@ TcpClient::~TcpClient()
          *  connection_ may be assigned after we assign conn
         */
         std::lock_guard lock(mutex_);
-        unique = connection_.unique();
+        unique = connection_.use_count() == 1;
         conn = connection_;
     }
 
@@ -66,12 +75,54 @@ TcpClient::~TcpClient()
     {
         connector_->stop();
     }
+
+    // the awaiter lives in the coroutine frame, not in this
+    resume_connect_waiter(nullptr);
+}
+
+TcpClient::ConnectAwaiter::ConnectAwaiter(TcpClient *client)
+  : client_(client)
+{
+}
+
+bool TcpClient::ConnectAwaiter::await_ready()
+{
+    std::lock_guard lock(client_->mutex_);
+    conn_ = client_->connection_;
+    return static_cast<bool>(conn_);
+}
+
+bool TcpClient::ConnectAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    client_->loop_->assert_in_loop_thread();
+    // stopped before the coroutine got here, nothing will resume it
+    if (!client_->connect_)
+    {
+        return false;
+    }
+    std::lock_guard lock(client_->mutex_);
+    assert(!client_->connect_waiter_);
+    handle_ = handle;
+    client_->connect_waiter_ = this;
+    return true;
+}
+
+TcpConnectionPtr TcpClient::ConnectAwaiter::await_resume()
+{
+    return std::move(conn_);
 }
 
-void TcpClient::connect()
+void TcpClient::ConnectAwaiter::resume(TcpConnectionPtr conn)
+{
+    conn_ = std::move(conn);
+    handle_.resume();
+}
+
+TcpClient::ConnectAwaiter TcpClient::connect()
 {
     connect_ = true;
     connector_->start();
+    return ConnectAwaiter(this);
 }
 
 void TcpClient::disconnect()
@@ -83,8 +134,13 @@ void TcpClient::disconnect()
         if (connection_)
         {
             connection_->shutdown();
+            return;
         }
     }
+
+    // not connected yet, stop trying
+    connector_->stop();
+    resume_connect_waiter(nullptr);
 }
 
 /**
@@ -94,6 +150,7 @@ void TcpClient::stop()
 {
     connect_ = false;
     connector_->stop();
+    resume_connect_waiter(nullptr);
 }
 
 bool TcpClient::retry() const
@@ -104,6 +161,7 @@ bool TcpClient::retry() const
 void TcpClient::enable_retry()
 {
     retry_ = true;
+    connector_->set_retry(true);
 }
 
 const std::string &TcpClient::name() const
@@ -126,6 +184,21 @@ void TcpClient::set_write_complete_callback(WriteCompleteCallback cb)
     write_complete_callback_ = std::move(cb);
 }
 
+void TcpClient::set_edge_triggered(bool on)
+{
+    edge_triggered_ = on;
+}
+
+void TcpClient::set_buffer_slab_size(size_t slab_size)
+{
+    buffer_slab_size_ = slab_size;
+}
+
+void TcpClient::set_buffer_release_threshold(size_t bytes)
+{
+    buffer_release_threshold_ = bytes;
+}
+
 void TcpClient::new_connection(int sockfd)
 {
     loop_->assert_in_loop_thread();
@@ -144,6 +217,9 @@ void TcpClient::new_connection(int sockfd)
     conn->set_connection_callback(connection_callback_);
     conn->set_message_callback(message_callback_);
     conn->set_write_complete_callback(write_complete_callback_);
+    conn->set_edge_triggered(edge_triggered_);
+    conn->set_slab_size(buffer_slab_size_);
+    conn->set_buffer_release_threshold(buffer_release_threshold_);
     conn->set_close_callback([this] (const TcpConnectionPtr &conn) {
         this->remove_connection(conn);
     });
@@ -154,6 +230,7 @@ void TcpClient::new_connection(int sockfd)
     }
 
     conn->connect_established();
+    resume_connect_waiter(conn);
 }
 
 void TcpClient::remove_connection(const TcpConnectionPtr &conn)
@@ -176,4 +253,21 @@ void TcpClient::remove_connection(const TcpConnectionPtr &conn)
         connector_->restart();
     }
 }
+
+// resumes in the loop thread, the lambda only holds the awaiter so it
+//  may run after the client is gone
+void TcpClient::resume_connect_waiter(TcpConnectionPtr conn)
+{
+    ConnectAwaiter *waiter;
+    {
+        std::lock_guard lock(mutex_);
+        waiter = std::exchange(connect_waiter_, nullptr);
+    }
+    if (waiter)
+    {
+        loop_->run_in_loop([waiter, conn = std::move(conn)] () mutable {
+            waiter->resume(std::move(conn));
+        });
+    }
+}
 } // namespace icarus
@@ -4,6 +4,7 @@
 #include <mutex>
 #include <string>
 #include <memory>
+#include <coroutine>
 
 #include "noncopyable.hpp"
 #include "tcpconnection.hpp"
@@ -21,7 +22,32 @@ class TcpClient : noncopyable
     TcpClient(EventLoop *loop, const InetAddress &server_addr, std::string name);
     ~TcpClient();
 
-    void connect();
+    // once resumed it holds its result and no longer touches the client
+    class ConnectAwaiter
+    {
+      public:
+        explicit ConnectAwaiter(TcpClient *client);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> handle);
+        TcpConnectionPtr await_resume();
+
+      private:
+        friend class TcpClient;
+
+        void resume(TcpConnectionPtr conn);
+
+        TcpClient *client_;
+        std::coroutine_handle<> handle_;
+        TcpConnectionPtr conn_;
+    };
+
+    // starts connecting, co_await the result in the loop thread to get
+    //  the connection once it is established. with retry on the
+    //  connector keeps trying until then. a failed connect with retry
+    //  off, stop(), disconnect() before the connection is up and the
+    //  destructor resume it with a null connection
+    ConnectAwaiter connect();
     void disconnect();
     void stop();
 
@@ -34,21 +60,35 @@ class TcpClient : noncopyable
     void set_message_callback(MessageCallback cb);
     void set_write_complete_callback(WriteCompleteCallback cb);
 
+    // see TcpConnection::set_edge_triggered, off by default
+    void set_edge_triggered(bool on);
+
+    // see TcpConnection::set_slab_size, 0 (contiguous) by default
+    void set_buffer_slab_size(size_t slab_size);
+
+    // see TcpConnection::set_buffer_release_threshold
+    void set_buffer_release_threshold(size_t bytes);
+
   private:
     void new_connection(int sockfd);
     void remove_connection(const TcpConnectionPtr &conn);
+    void resume_connect_waiter(TcpConnectionPtr conn);
 
     EventLoop *loop_;
-    std::unique_ptr<Connector> connector_;
+    std::shared_ptr<Connector> connector_;
     const std::string name_;
     ConnectionCallback connection_callback_;
     MessageCallback message_callback_;
     WriteCompleteCallback write_complete_callback_;
     bool retry_;
     bool connect_;
+    bool edge_triggered_;
+    size_t buffer_slab_size_;
+    size_t buffer_release_threshold_;
     int next_conn_id_;
     std::mutex mutex_;
     TcpConnectionPtr connection_;
+    ConnectAwaiter *connect_waiter_;  // guarded by mutex_
 };
 } // namespace icarus
 
@@ -1,5 +1,10 @@
+#include <string>
 #include <utility>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
 
 #include "tcpconnection.hpp"
 #include "socket.hpp"
@@ -29,10 +34,18 @@ TcpConnection::TcpConnection(EventLoop* loop,
   : loop_(loop),
     name_(std::move(name)),
     state_(kConnecting),
+    edge_triggered_(false),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
     local_addr_(local_addr),
-    peer_addr_(peer_addr)
+    peer_addr_(peer_addr),
+    pending_bytes_(0),
+    buffer_release_threshold_(kKeepBuffers),
+    high_water_mark_(kDefaultHighWaterMark),
+    awaited_(false),
+    read_wanted_(0),
+    compute_submitted_(0),
+    compute_completed_(0)
 {
     channel_->set_read_callback([this] () {
         this->handle_read();
@@ -46,9 +59,15 @@ TcpConnection::TcpConnection(EventLoop* loop,
     channel_->set_error_callback([this] () {
         this->handle_error();
     });
+    // counted from the moment the loop is chosen, so a burst of accepts
+    //  is already visible to the next choice
+    loop_->connection_opened();
 }
 
-TcpConnection::~TcpConnection() = default;
+TcpConnection::~TcpConnection()
+{
+    drop_pending();
+}
 
 EventLoop* TcpConnection::get_loop() const
 {
@@ -103,13 +122,123 @@ void TcpConnection::send(Buffer* buf)
     {
         if (loop_->is_in_loop_thread())
         {
-            send_in_loop(buf->peek(), buf->readable_bytes());
-            buf->retrieve_all();
+            while (buf->readable_bytes() > 0)
+            {
+                send_in_loop(buf->peek(), buf->contiguous_bytes());
+                buf->retrieve(buf->contiguous_bytes());
+            }
+        }
+        else
+        {
+            // moved out whole, buf keeps its mode
+            size_t slab_size = buf->slab_size();
+            loop_->run_in_loop([this, data = std::move(*buf)] () mutable {
+                this->send_in_loop(std::move(data));
+            });
+            buf->set_slab_size(slab_size);
+        }
+    }
+}
+
+void TcpConnection::send(const char* message)
+{
+    send(std::string_view(message));
+}
+
+void TcpConnection::send(std::string&& message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->is_in_loop_thread())
+        {
+            send_in_loop(std::move(message));
+        }
+        else
+        {
+            loop_->run_in_loop([this, data = std::move(message)] () mutable {
+                this->send_in_loop(std::move(data));
+            });
+        }
+    }
+}
+
+void TcpConnection::send(Buffer&& message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->is_in_loop_thread())
+        {
+            send_in_loop(std::move(message));
+        }
+        else
+        {
+            loop_->run_in_loop([this, data = std::move(message)] () mutable {
+                this->send_in_loop(std::move(data));
+            });
+        }
+    }
+}
+
+void TcpConnection::send(PayloadPtr payload)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->is_in_loop_thread())
+        {
+            send_in_loop(payload);
+        }
+        else
+        {
+            loop_->run_in_loop([this, payload = std::move(payload)] () {
+                this->send_in_loop(payload);
+            });
+        }
+    }
+}
+
+void TcpConnection::send(std::span<const struct iovec> fragments)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->is_in_loop_thread())
+        {
+            send_in_loop(fragments);
+        }
+        else
+        {
+            // the joined copy is the only one, what the socket does not
+            //  take stays queued in it
+            std::string data;
+            for (const auto& fragment : fragments)
+            {
+                data.append(static_cast<const char*>(fragment.iov_base), fragment.iov_len);
+            }
+            auto payload = std::make_shared<const std::string>(std::move(data));
+            loop_->run_in_loop([this, payload = std::move(payload)] () {
+                this->send_in_loop(payload);
+            });
+        }
+    }
+}
+
+void TcpConnection::send_file(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected && len > 0)
+    {
+        int file_fd = ::dup(fd);
+        if (file_fd < 0)
+        {
+            // log error
+            return;
+        }
+        if (loop_->is_in_loop_thread())
+        {
+            send_file_in_loop(file_fd, offset, len);
         }
         else
         {
-            loop_->run_in_loop([this, str = buf->retrieve_all_as_string()]() {
-                this->send_in_loop(str.data(), str.size());
+            loop_->run_in_loop([this, file_fd, offset, len] () {
+                this->send_file_in_loop(file_fd, offset, len);
             });
         }
     }
@@ -137,6 +266,122 @@ void TcpConnection::force_close()
     }
 }
 
+void TcpConnection::set_edge_triggered(bool on)
+{
+    assert(state_ == kConnecting);
+    edge_triggered_ = on;
+    channel_->set_edge_triggered(on);
+}
+
+bool TcpConnection::edge_triggered() const
+{
+    return edge_triggered_;
+}
+
+void TcpConnection::set_slab_size(size_t slab_size)
+{
+    assert(state_ == kConnecting);
+    input_buffer_.set_slab_size(slab_size);
+    output_buffer_.set_slab_size(slab_size);
+}
+
+void TcpConnection::set_buffer_release_threshold(size_t bytes)
+{
+    buffer_release_threshold_ = bytes;
+}
+
+TcpConnection::ReadAwaiter::ReadAwaiter(TcpConnection *conn, size_t wanted, bool exact)
+  : conn_(conn),
+    wanted_(wanted),
+    exact_(exact)
+{
+}
+
+bool TcpConnection::ReadAwaiter::await_ready() const
+{
+    return conn_->input_buffer_.readable_bytes() >= wanted_ || conn_->state_ == kDisconnected;
+}
+
+void TcpConnection::ReadAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    conn_->loop_->assert_in_loop_thread();
+    assert(!conn_->reader_);
+    conn_->reader_ = handle;
+    conn_->read_wanted_ = wanted_;
+}
+
+size_t TcpConnection::ReadAwaiter::await_resume() const
+{
+    size_t readable = conn_->input_buffer_.readable_bytes();
+    if (readable < wanted_)
+    {
+        return 0;
+    }
+    return exact_ ? wanted_ : readable;
+}
+
+TcpConnection::WriteAwaiter::WriteAwaiter(TcpConnection *conn, bool sent)
+  : conn_(conn),
+    sent_(sent)
+{
+}
+
+bool TcpConnection::WriteAwaiter::await_ready() const
+{
+    return !sent_ || !conn_->output_pending() || conn_->state_ == kDisconnected;
+}
+
+void TcpConnection::WriteAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    conn_->loop_->assert_in_loop_thread();
+    assert(!conn_->writer_);
+    conn_->writer_ = handle;
+}
+
+bool TcpConnection::WriteAwaiter::await_resume() const
+{
+    return sent_ && !conn_->output_pending();
+}
+
+TcpConnection::ReadAwaiter TcpConnection::read_some()
+{
+    awaited_ = true;
+    return ReadAwaiter(this, 1, false);
+}
+
+TcpConnection::ReadAwaiter TcpConnection::read_exactly(size_t n)
+{
+    awaited_ = true;
+    return ReadAwaiter(this, n, true);
+}
+
+TcpConnection::WriteAwaiter TcpConnection::write(const std::string_view& data)
+{
+    loop_->assert_in_loop_thread();
+    bool sent = state_ == kConnected;
+    if (sent)
+    {
+        send_in_loop(data);
+    }
+    return WriteAwaiter(this, sent);
+}
+
+TcpConnection::WriteAwaiter TcpConnection::write(Buffer* data)
+{
+    loop_->assert_in_loop_thread();
+    bool sent = state_ == kConnected;
+    if (sent)
+    {
+        send(data);
+    }
+    return WriteAwaiter(this, sent);
+}
+
+Buffer* TcpConnection::input_buffer()
+{
+    return &input_buffer_;
+}
+
 void TcpConnection::set_context(std::any context)
 {
     context_ = std::move(context);
@@ -162,6 +407,22 @@ void TcpConnection::set_write_complete_callback(WriteCompleteCallback cb)
     write_complete_callback_ = std::move(cb);
 }
 
+void TcpConnection::set_high_water_mark_callback(HighWaterMarkCallback cb, size_t high_water_mark)
+{
+    high_water_mark_callback_ = std::move(cb);
+    high_water_mark_ = high_water_mark;
+}
+
+size_t TcpConnection::queued_output_bytes() const
+{
+    return output_buffer_.readable_bytes() + pending_bytes_;
+}
+
+bool TcpConnection::over_high_water_mark() const
+{
+    return queued_output_bytes() >= high_water_mark_;
+}
+
 void TcpConnection::set_close_callback(CloseCallback cb)
 {
     close_callback_ = std::move(cb);
@@ -184,66 +445,314 @@ void TcpConnection::connect_destroyed()
     {
         set_state(kDisconnected);
         channel_->disable_all();
+        resume_reader();
+        resume_writer();
         connection_callback_(shared_from_this());
     }
     channel_->remove();
+    loop_->connection_closed();
+
+    // the last reference may go away in another thread, the storage
+    //  goes back to this loop's pool now
+    input_buffer_.release();
+    output_buffer_.release();
+    drop_pending();
 }
 
 void TcpConnection::handle_read()
 {
     loop_->assert_in_loop_thread();
-    int saved_errno;
-    ssize_t n = input_buffer_.read_fd(channel_->fd(), &saved_errno);
-    if (n > 0)
+    size_t total = 0;
+    do
+    {
+        int saved_errno = 0;
+        ssize_t n = input_buffer_.read_fd(channel_->fd(), &saved_errno);
+        if (n > 0)
+        {
+            total += n;
+            if (awaited_)
+            {
+                resume_reader();
+            }
+            else
+            {
+                message_callback_(shared_from_this(), &input_buffer_);
+            }
+            release_if_drained(input_buffer_);
+        }
+        else if (n == 0)
+        {
+            handle_close();
+            return;
+        }
+        else
+        {
+            if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK && saved_errno != EINTR)
+            {
+                handle_error();
+            }
+            return;
+        }
+    } while (edge_triggered_ && channel_->is_reading() && total < kEdgeTriggeredBudget);
+
+    if (edge_triggered_ && total >= kEdgeTriggeredBudget && channel_->is_reading())
     {
-        message_callback_(shared_from_this(), &input_buffer_);
+        // no new edge will come for the unread bytes, so continue later
+        loop_->queue_in_loop([ptr = shared_from_this()] () {
+            if (ptr->channel_->is_reading())
+            {
+                ptr->handle_read();
+            }
+        });
     }
-    else if (n == 0)
+}
+
+void TcpConnection::handle_write()
+{
+    loop_->assert_in_loop_thread();
+    if (channel_->is_writing())
     {
-        handle_close();
+        if (write_output())
+        {
+            channel_->disable_writing();
+            release_if_drained(output_buffer_);
+            if (write_complete_callback_)
+            {
+                loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                    write_complete_callback_(ptr);
+                });
+            }
+            if (state_ == kDisconnecting)
+            {
+                shutdown_in_loop();
+            }
+            resume_writer();
+        }
     }
     else
     {
-        // check saved_errno
+        // log
     }
 }
 
-void TcpConnection::handle_write()
+// writes output_buffer_ and the pending entries out in order, returns
+//  true once nothing is left
+bool TcpConnection::write_output()
 {
-    loop_->assert_in_loop_thread();
-    if (channel_->is_writing())
+    size_t total = 0;
+    while (output_pending())
     {
-        ssize_t n = sockets::write(channel_->fd(), output_buffer_.peek(), output_buffer_.readable_bytes());
+        int saved_errno = 0;
+        ssize_t n = 0;
+        PendingOutput* from = nullptr;
+        if (!pending_.empty() && pending_.front().buffered_before == 0)
+        {
+            from = &pending_.front();
+            size_t remaining = from->remaining;
+            n = write_pending(*from, &saved_errno);
+            pending_bytes_ -= remaining - from->remaining;
+            if (from->remaining == 0)
+            {
+                close_pending_fd(*from);
+                pending_.pop_front();
+                continue;
+            }
+        }
+        else if (!pending_.empty())
+        {
+            PendingOutput& out = pending_.front();
+            n = output_buffer_.write_fd(channel_->fd(), &saved_errno, out.buffered_before);
+            if (n > 0)
+            {
+                out.buffered_before -= n;
+            }
+        }
+        else
+        {
+            n = output_buffer_.write_fd(channel_->fd(), &saved_errno);
+        }
+
         if (n > 0)
         {
-            output_buffer_.retrieve(n);
-            if (output_buffer_.readable_bytes() == 0)
+            total += n;
+        }
+        else
+        {
+            if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK && saved_errno != EINTR)
             {
-                channel_->disable_writing();
-                if (write_complete_callback_)
-                {
-                    loop_->queue_in_loop([=, ptr = shared_from_this()] () {
-                        write_complete_callback_(ptr);
-                    });
-                }
-                if (state_ == kDisconnecting)
+                // log error
+                if (from && from->fd >= 0)
                 {
-                    shutdown_in_loop();
+                    // the file cannot be sent, the stream would go on
+                    //  without it, so the connection is closed
+                    pending_bytes_ -= from->remaining;
+                    close_pending_fd(*from);
+                    pending_.pop_front();
+                    force_close_in_loop();
                 }
             }
-            else
+            else if (from && from->pipe && sockets::pipe_empty(from->fd))
             {
-                // log
+                // the socket would take more, the pipe has nothing yet
+                wait_for_pipe(from->fd);
             }
+            return false;
         }
-        else
+
+        if (!edge_triggered_)
+        {
+            break;
+        }
+        if (total >= kEdgeTriggeredBudget && output_pending())
+        {
+            loop_->queue_in_loop([ptr = shared_from_this()] () {
+                ptr->handle_write();
+            });
+            return false;
+        }
+    }
+    return !output_pending();
+}
+
+bool TcpConnection::output_pending() const
+{
+    return output_buffer_.readable_bytes() > 0 || !pending_.empty();
+}
+
+// behind everything queued so far
+void TcpConnection::queue_pending(PendingOutput out)
+{
+    out.buffered_before = output_buffer_.readable_bytes();
+    for (const auto& ahead : pending_)
+    {
+        out.buffered_before -= ahead.buffered_before;
+    }
+    pending_bytes_ += out.remaining;
+    size_t added = out.remaining;
+    pending_.push_back(std::move(out));
+    if (!channel_->is_writing())
+    {
+        channel_->enable_writing();
+    }
+    queued_more(added);
+}
+
+void TcpConnection::queued_more(size_t added)
+{
+    size_t queued = queued_output_bytes();
+    if (high_water_mark_callback_ && queued >= high_water_mark_ && queued - added < high_water_mark_)
+    {
+        loop_->queue_in_loop([this, ptr = shared_from_this(), queued] () {
+            high_water_mark_callback_(ptr, queued);
+        });
+    }
+}
+
+// one write of a payload or a Buffer, or one sendfile or splice, a file
+//  that ends early is finished
+ssize_t TcpConnection::write_pending(PendingOutput& out, int* saved_errno)
+{
+    ssize_t n = 0;
+    if (out.payload)
+    {
+        n = sockets::write(channel_->fd(), out.payload->data() + out.offset, out.remaining);
+    }
+    else if (out.buffer)
+    {
+        n = out.buffer->write_fd(channel_->fd(), saved_errno);
+        if (n > 0)
         {
-            abort();
+            out.remaining -= n;
         }
+        return n;
+    }
+    else if (out.pipe)
+    {
+        n = sockets::splice_from_pipe(out.fd, channel_->fd(), out.remaining);
     }
     else
     {
-        // log
+        n = sockets::sendfile(channel_->fd(), out.fd, &out.offset, out.remaining);
+    }
+
+    if (n < 0)
+    {
+        *saved_errno = errno;
+    }
+    else if (n == 0 && out.fd >= 0)
+    {
+        // log, the file is shorter than promised
+        out.remaining = 0;
+    }
+    else
+    {
+        if (out.payload)
+        {
+            out.offset += n;
+        }
+        out.remaining -= n;
+    }
+    return n;
+}
+
+// the pipe channel watching the fd goes first
+void TcpConnection::close_pending_fd(PendingOutput& out)
+{
+    if (out.fd < 0)
+    {
+        return;
+    }
+    if (pipe_channel_ && pipe_channel_->fd() == out.fd)
+    {
+        pipe_channel_->disable_all();
+        pipe_channel_->remove();
+        // it may still be among the active channels of this iteration
+        loop_->queue_in_loop([channel = std::move(pipe_channel_)] () {});
+    }
+    ::close(out.fd);
+    out.fd = -1;
+}
+
+void TcpConnection::drop_pending()
+{
+    for (auto& out : pending_)
+    {
+        close_pending_fd(out);
+    }
+    pending_.clear();
+    pending_bytes_ = 0;
+}
+
+// the socket stops asking for output until the pipe has data, instead
+//  of waking up for a splice that keeps failing with EAGAIN
+void TcpConnection::wait_for_pipe(int fd)
+{
+    channel_->disable_writing();
+    if (!pipe_channel_)
+    {
+        pipe_channel_ = std::make_unique<Channel>(loop_, fd);
+        pipe_channel_->set_read_callback([this] () {
+            this->handle_pipe_readable();
+        });
+        // the writer closed it, the splice then sees the end
+        pipe_channel_->set_close_callback([this] () {
+            this->handle_pipe_readable();
+        });
+    }
+    pipe_channel_->enable_reading();
+}
+
+void TcpConnection::handle_pipe_readable()
+{
+    if (!pipe_channel_ || pipe_channel_->is_none_event())
+    {
+        // removed earlier in this iteration
+        return;
+    }
+    pipe_channel_->disable_all();
+    if (state_ != kDisconnected && !channel_->is_writing())
+    {
+        channel_->enable_writing();
     }
 }
 
@@ -254,6 +763,8 @@ void TcpConnection::handle_close()
     channel_->disable_all();
 
     TcpConnectionPtr guard_this(shared_from_this());
+    resume_reader();
+    resume_writer();
     connection_callback_(guard_this);
     close_callback_(guard_this);
 }
@@ -273,7 +784,7 @@ void TcpConnection::send_in_loop(const void *message, size_t len)
     loop_->assert_in_loop_thread();
     ssize_t nwrote = 0;
 
-    if (!channel_->is_writing() && output_buffer_.readable_bytes() == 0)
+    if (!channel_->is_writing() && !output_pending())
     {
         nwrote = sockets::write(channel_->fd(), message, len);
         if (nwrote >= 0)
@@ -284,7 +795,7 @@ void TcpConnection::send_in_loop(const void *message, size_t len)
             }
             else if (write_complete_callback_)
             {
-                loop_->queue_in_loop([=, ptr = shared_from_this()] () {
+                loop_->queue_in_loop([this, ptr = shared_from_this()] () {
                     write_complete_callback_(ptr);
                 });
             }
@@ -307,9 +818,239 @@ void TcpConnection::send_in_loop(const void *message, size_t len)
         {
             channel_->enable_writing();
         }
+        queued_more(len - nwrote);
+    }
+}
+
+void TcpConnection::send_in_loop(std::span<const struct iovec> fragments)
+{
+    loop_->assert_in_loop_thread();
+    size_t len = 0;
+    for (const auto& fragment : fragments)
+    {
+        len += fragment.iov_len;
+    }
+    if (len <= kGatherCopyBytes)
+    {
+        // the kernel walks every iovec on its own, gathering a short
+        //  message on the stack and one write is cheaper, writev_bench
+        char message[kGatherCopyBytes];
+        char* end = message;
+        for (const auto& fragment : fragments)
+        {
+            end = std::copy_n(static_cast<const char*>(fragment.iov_base), fragment.iov_len, end);
+        }
+        send_in_loop(message, len);
+        return;
+    }
+    size_t nwrote = 0;
+
+    if (!channel_->is_writing() && !output_pending())
+    {
+        // fragments past IOV_MAX wait in the output buffer
+        int iovcnt = static_cast<int>(std::min<size_t>(fragments.size(), IOV_MAX));
+        ssize_t n = sockets::writev(channel_->fd(), fragments.data(), iovcnt);
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == len && write_complete_callback_)
+            {
+                loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                    write_complete_callback_(ptr);
+                });
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            // log error
+        }
+    }
+
+    if (nwrote < len)
+    {
+        size_t added = len - nwrote;
+        // skips what went out, the tail of the fragment it stopped in
+        //  and everything after goes into output_buffer_
+        for (const auto& fragment : fragments)
+        {
+            if (nwrote >= fragment.iov_len)
+            {
+                nwrote -= fragment.iov_len;
+                continue;
+            }
+            output_buffer_.append(static_cast<const char*>(fragment.iov_base) + nwrote,
+                                  fragment.iov_len - nwrote);
+            nwrote = 0;
+        }
+        if (!channel_->is_writing())
+        {
+            channel_->enable_writing();
+        }
+        queued_more(added);
     }
 }
 
+void TcpConnection::send_in_loop(std::string&& message)
+{
+    loop_->assert_in_loop_thread();
+    size_t nwrote = 0;
+
+    if (!channel_->is_writing() && !output_pending())
+    {
+        ssize_t n = sockets::write(channel_->fd(), message.data(), message.size());
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == message.size())
+            {
+                if (write_complete_callback_)
+                {
+                    loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                        write_complete_callback_(ptr);
+                    });
+                }
+                return;
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            // log error
+        }
+    }
+
+    size_t len = message.size() - nwrote;
+    if (len >= kMoveTailBytes)
+    {
+        auto payload = std::make_shared<const std::string>(std::move(message));
+        queue_pending({std::move(payload), nullptr, -1, static_cast<off_t>(nwrote), len, false, 0});
+        return;
+    }
+    output_buffer_.append(message.data() + nwrote, len);
+    if (!channel_->is_writing())
+    {
+        channel_->enable_writing();
+    }
+    queued_more(len);
+}
+
+void TcpConnection::send_in_loop(Buffer&& message)
+{
+    loop_->assert_in_loop_thread();
+
+    if (!channel_->is_writing() && !output_pending())
+    {
+        int saved_errno = 0;
+        if (message.write_fd(channel_->fd(), &saved_errno) < 0 && saved_errno != EWOULDBLOCK)
+        {
+            // log error
+        }
+        if (message.readable_bytes() == 0)
+        {
+            if (write_complete_callback_)
+            {
+                loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                    write_complete_callback_(ptr);
+                });
+            }
+            return;
+        }
+    }
+
+    size_t len = message.readable_bytes();
+    if (output_buffer_.readable_bytes() == 0 && output_buffer_.slab_size() == message.slab_size())
+    {
+        // whatever is pending goes out first anyway, the old storage
+        //  leaves with message
+        output_buffer_.swap(message);
+    }
+    else if (len >= kMoveTailBytes)
+    {
+        auto buffer = std::make_unique<Buffer>(std::move(message));
+        queue_pending({nullptr, std::move(buffer), -1, 0, len, false, 0});
+        return;
+    }
+    else
+    {
+        while (message.readable_bytes() > 0)
+        {
+            output_buffer_.append(message.peek(), message.contiguous_bytes());
+            message.retrieve(message.contiguous_bytes());
+        }
+    }
+    if (!channel_->is_writing())
+    {
+        channel_->enable_writing();
+    }
+    queued_more(len);
+}
+
+void TcpConnection::send_file_in_loop(int fd, off_t offset, size_t len)
+{
+    loop_->assert_in_loop_thread();
+    if (state_ == kDisconnected)
+    {
+        ::close(fd);
+        return;
+    }
+
+    PendingOutput file = {nullptr, nullptr, fd, offset, len, sockets::is_pipe(fd), 0};
+    if (!channel_->is_writing() && !output_pending())
+    {
+        int saved_errno = 0;
+        if (write_pending(file, &saved_errno) < 0
+            && saved_errno != EAGAIN && saved_errno != EWOULDBLOCK && saved_errno != EINTR)
+        {
+            // log error, nothing was sent, queued it would fail again
+            ::close(fd);
+            return;
+        }
+        if (file.remaining == 0)
+        {
+            ::close(fd);
+            if (write_complete_callback_)
+            {
+                loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                    write_complete_callback_(ptr);
+                });
+            }
+            return;
+        }
+    }
+    queue_pending(std::move(file));
+}
+
+void TcpConnection::send_in_loop(const PayloadPtr& payload)
+{
+    loop_->assert_in_loop_thread();
+    size_t nwrote = 0;
+
+    if (!channel_->is_writing() && !output_pending())
+    {
+        ssize_t n = sockets::write(channel_->fd(), payload->data(), payload->size());
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == payload->size())
+            {
+                if (write_complete_callback_)
+                {
+                    loop_->queue_in_loop([this, ptr = shared_from_this()] () {
+                        write_complete_callback_(ptr);
+                    });
+                }
+                return;
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            // log error
+        }
+    }
+
+    // the rest stays in the payload
+    queue_pending({payload, nullptr, -1, static_cast<off_t>(nwrote), payload->size() - nwrote, false, 0});
+}
+
 void TcpConnection::shutdown_in_loop()
 {
     loop_->assert_in_loop_thread();
@@ -338,5 +1079,32 @@ void TcpConnection::set_state(TcpConnection::States s)
     state_ = s;
 }
 
+void TcpConnection::resume_reader()
+{
+    if (reader_ && (input_buffer_.readable_bytes() >= read_wanted_ || state_ == kDisconnected))
+    {
+        // the coroutine may drop the last reference
+        TcpConnectionPtr guard_this(shared_from_this());
+        std::exchange(reader_, nullptr).resume();
+    }
+}
+
+void TcpConnection::resume_writer()
+{
+    if (writer_)
+    {
+        TcpConnectionPtr guard_this(shared_from_this());
+        std::exchange(writer_, nullptr).resume();
+    }
+}
+
+void TcpConnection::release_if_drained(Buffer& buf)
+{
+    if (buf.readable_bytes() == 0 && buf.internal_capacity() > buffer_release_threshold_)
+    {
+        buf.release();
+    }
+}
+
 
 } // namespace icarus
@@ -3,8 +3,14 @@
 
 #include <string>
 #include <string_view>
+#include <span>
 #include <memory>
+#include <map>
+#include <deque>
 #include <any>
+#include <cstdint>
+#include <coroutine>
+#include <sys/uio.h>
 
 #include "callbacks.hpp"
 #include "noncopyable.hpp"
@@ -23,6 +29,24 @@ class TcpConnection : noncopyable
                     , public std::enable_shared_from_this<TcpConnection>
 {
   public:
+    // bytes read or written per wakeup in edge-triggered mode
+    //  before yielding to other channels
+    static constexpr size_t kEdgeTriggeredBudget = 1024 * 1024;
+
+    // scattered sends up to this size are copied together and written
+    //  with one write instead of writev
+    static constexpr size_t kGatherCopyBytes = 4096;
+
+    // unsent tails of moved strings and Buffers from this size on are
+    //  queued as they are instead of being copied into the output buffer,
+    //  below it the extra write per message costs more than the copy
+    static constexpr size_t kMoveTailBytes = 32 * 1024;
+
+    // buffers keep their storage, see set_buffer_release_threshold
+    static constexpr size_t kKeepBuffers = SIZE_MAX;
+
+    static constexpr size_t kDefaultHighWaterMark = 64 * 1024 * 1024;
+
     static void default_connection_callback(const TcpConnectionPtr &);
     static void default_message_callback(const TcpConnectionPtr &, Buffer *buf);
 
@@ -43,9 +67,102 @@ class TcpConnection : noncopyable
     void send(const void *message, size_t len);
     void send(const std::string_view& message);
     void send(Buffer* message);
+    void send(const char* message);
+
+    // take the bytes over, off the loop thread too they are moved through
+    //  the queue instead of being copied. an empty output buffer swaps
+    //  storage with message, a long unsent tail stays where it is
+    void send(std::string&& message);
+    void send(Buffer&& message);
+
+    // queues payload by reference, the unsent part of it is held with a
+    //  refcount and an offset instead of being copied, for sending the
+    //  same bytes to many connections
+    void send(PayloadPtr payload);
+
+    // sends the fragments in order as one message, with a single writev
+    //  when nothing is queued, only the unsent tail is copied
+    void send(std::span<const struct iovec> fragments);
+
+    /**
+     * sends len bytes of the file fd from offset without copying them
+     *  through user space, with sendfile(2), or with splice(2) when fd is
+     *  a pipe, whose bytes must be on their way then, offset is ignored
+     *
+     * ordered with send(), anything sent before goes out first. the
+     *  connection keeps a dup of fd until the bytes are out, so fd may
+     *  be closed right away. a file ending early is cut short
+    */
+    void send_file(int fd, off_t offset, size_t len);
     void shutdown();
     void force_close();
 
+    // drains the socket on every wakeup and registers it with EPOLLET,
+    //  must be called before connect_established
+    void set_edge_triggered(bool on);
+    bool edge_triggered() const;
+
+    // segments both buffers into slabs of slab_size, see Buffer,
+    //  must be called before connect_established
+    void set_slab_size(size_t slab_size);
+
+    // a buffer that runs empty while holding more than bytes of storage
+    //  gives it back to the loop's BufferPool, the next read or send
+    //  allocates again. 0 releases every drained buffer, which keeps idle
+    //  connections at no buffer memory at all. kKeepBuffers by default
+    void set_buffer_release_threshold(size_t bytes);
+
+    class ReadAwaiter
+    {
+      public:
+        ReadAwaiter(TcpConnection *conn, size_t wanted, bool exact);
+
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> handle);
+        size_t await_resume() const;
+
+      private:
+        TcpConnection *conn_;
+        size_t wanted_;
+        bool exact_;
+    };
+
+    class WriteAwaiter
+    {
+      public:
+        WriteAwaiter(TcpConnection *conn, bool sent);
+
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const;
+
+      private:
+        TcpConnection *conn_;
+        bool sent_;
+    };
+
+    /**
+     * awaitables for coroutines running in the loop thread, see Task
+     *
+     * the first read_some or read_exactly hands the input over to the
+     *  coroutines for good, message_callback is not called any more and
+     *  the bytes stay in input_buffer until retrieved. a coroutine
+     *  resumes directly from handle_read, handle_write or handle_close.
+     *  one reader and one writer may wait at a time.
+    */
+    // readable bytes in input_buffer once there are any, 0 after close
+    ReadAwaiter read_some();
+
+    // n once input_buffer holds n bytes, 0 when closed before that
+    ReadAwaiter read_exactly(size_t n);
+
+    // sends data, true once the output buffer is drained,
+    //  false when the connection closed first
+    WriteAwaiter write(const std::string_view& data);
+    WriteAwaiter write(Buffer* data);
+
+    Buffer* input_buffer();
+
     void set_context(std::any context);
     const std::any& get_context() const;
 
@@ -54,10 +171,21 @@ class TcpConnection : noncopyable
     void set_write_complete_callback(WriteCompleteCallback cb);
     void set_close_callback(CloseCallback cb);
 
+    // cb is called with the queued bytes once a send takes them from
+    //  below high_water_mark to at or above it
+    void set_high_water_mark_callback(HighWaterMarkCallback cb, size_t high_water_mark);
+
+    // bytes sent but not written to the socket yet, buffered or held by
+    //  reference, loop thread only
+    size_t queued_output_bytes() const;
+    bool over_high_water_mark() const;
+
     void connect_established();
     void connect_destroyed();
 
   private:
+    friend class ComputePool;
+
     enum States
     {
         kDisconnected,
@@ -68,28 +196,79 @@ class TcpConnection : noncopyable
 
     void handle_read(/*Timestamp receiveTime*/);
     void handle_write();
+    bool write_output();
     void handle_close();
     void handle_error();
     void send_in_loop(const std::string_view& message);
     void send_in_loop(const void* message, size_t len);
+    void send_in_loop(std::span<const struct iovec> fragments);
+    void send_in_loop(const PayloadPtr& payload);
+    void send_in_loop(std::string&& message);
+    void send_in_loop(Buffer&& message);
+    void send_file_in_loop(int fd, off_t offset, size_t len);
     void shutdown_in_loop();
     void force_close_in_loop();
     void set_state(States s);
+    void resume_reader();
+    void resume_writer();
+    void release_if_drained(Buffer& buf);
+
+    // bytes queued by reference, a payload, a moved Buffer, or else the
+    //  file fd from send_file. the first buffered_before bytes of
+    //  output_buffer_ after the previous entry go out ahead of it
+    struct PendingOutput
+    {
+        PayloadPtr payload;
+        std::unique_ptr<Buffer> buffer;
+        int fd;
+        off_t offset;
+        size_t remaining;
+        bool pipe;
+        size_t buffered_before;
+    };
+
+    bool output_pending() const;
+    void queue_pending(PendingOutput out);
+    void queued_more(size_t added);
+    ssize_t write_pending(PendingOutput& out, int* saved_errno);
+    void close_pending_fd(PendingOutput& out);
+    void drop_pending();
+    void wait_for_pipe(int fd);
+    void handle_pipe_readable();
 
     EventLoop* loop_;
     std::string name_;
     States state_;
+    bool edge_triggered_;
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<Channel> channel_;
+    // the pipe of the front pending entry while it is empty
+    std::unique_ptr<Channel> pipe_channel_;
     InetAddress local_addr_;
     InetAddress peer_addr_;
     ConnectionCallback connection_callback_;
     MessageCallback message_callback_;
     WriteCompleteCallback write_complete_callback_;
     ConnectionCallback close_callback_;
+    HighWaterMarkCallback high_water_mark_callback_;
     Buffer input_buffer_;
     Buffer output_buffer_;
+    std::deque<PendingOutput> pending_;
+    size_t pending_bytes_;
+    size_t buffer_release_threshold_;
+    size_t high_water_mark_;
     std::any context_;
+
+    // waiting coroutines, loop thread only
+    bool awaited_;
+    std::coroutine_handle<> reader_;
+    size_t read_wanted_;
+    std::coroutine_handle<> writer_;
+
+    // ComputePool completion order, loop thread only
+    std::uint64_t compute_submitted_;
+    std::uint64_t compute_completed_;
+    std::map<std::uint64_t, UniqueFunction<void()>> compute_early_;
 };
 
 } // namespace icarus
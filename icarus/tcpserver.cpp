@@ -1,6 +1,7 @@
 #include <utility>
 
 #include <memory>
+#include <future>
 #include <cstdio>
 #include <cassert>
 
@@ -16,19 +17,27 @@
 namespace icarus
 {
 
-TcpServer::TcpServer(EventLoop* loop, const InetAddress& listen_addr, std::string name)
+TcpServer::TcpServer(EventLoop* loop, const InetAddress& listen_addr, std::string name,
+                     Option option)
   : loop_(loop),
+    listen_addr_(listen_addr),
     host_port_(listen_addr.to_ip_port()),
     name_(std::move(name)),
-    acceptor_(new Acceptor(loop, listen_addr)),
+    acceptor_(new Acceptor(loop, listen_addr, option == kReusePort)),
     thread_pool_(new EventLoopThreadPool(loop)),
     connection_callback_(TcpConnection::default_connection_callback),
     message_callback_(TcpConnection::default_message_callback),
+    high_water_mark_(TcpConnection::kDefaultHighWaterMark),
     started_(false),
+    edge_triggered_(false),
+    buffer_slab_size_(0),
+    buffer_release_threshold_(TcpConnection::kKeepBuffers),
+    reuse_port_(option == kReusePort),
+    accept_batch_(Acceptor::kDefaultAcceptBatch),
     next_conn_id_(1)
 {
-    acceptor_->set_new_connection_callback([this] (int sockfd, const InetAddress& inet_addr) {
-        this->new_connection(sockfd, inet_addr);
+    acceptor_->set_new_connections_callback([this] (std::vector<Acceptor::NewConnection>& batch) {
+        this->new_connections(batch);
     });
 }
 
@@ -41,6 +50,22 @@ TcpServer::~TcpServer()
             conn->connect_destroyed();
         });
     }
+
+    // loop acceptors are torn down in their own threads before the pool stops
+    for (auto &owner : loop_acceptors_)
+    {
+        std::promise<void> done;
+        owner->loop->run_in_loop([ptr = owner.get(), &done] () {
+            ptr->acceptor.reset();
+            for (auto &pair : ptr->connections)
+            {
+                pair.second->connect_destroyed();
+            }
+            ptr->connections.clear();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
 }
 
 void TcpServer::set_thread_num(int num_threads)
@@ -49,15 +74,37 @@ void TcpServer::set_thread_num(int num_threads)
     thread_pool_->set_thread_num(num_threads);
 }
 
+void TcpServer::set_poller_backend(PollerBackend backend)
+{
+    thread_pool_->set_poller_backend(backend);
+}
+
+void TcpServer::set_loop_placement(LoopPlacement placement)
+{
+    thread_pool_->set_placement(std::move(placement));
+}
+
+void TcpServer::set_loop_selection(LoopSelection selection)
+{
+    thread_pool_->set_loop_selection(selection);
+}
+
+void TcpServer::set_loop_selector(EventLoopThreadPool::LoopSelector selector)
+{
+    thread_pool_->set_loop_selector(std::move(selector));
+}
+
 void TcpServer::start()
 {
     if (!started_)
     {
         started_ = true;
         thread_pool_->start();
+        start_loop_acceptors();
     }
 
-    if (!acceptor_->listenning())
+    // with loop acceptors the base one only keeps the port bound
+    if (loop_acceptors_.empty() && !acceptor_->listenning())
     {
         loop_->run_in_loop([ptr = acceptor_.get()] () {
             ptr->listen();
@@ -80,25 +127,170 @@ void TcpServer::set_write_complete_callback(WriteCompleteCallback cb)
     write_complete_callback_ = std::move(cb);
 }
 
-void TcpServer::new_connection(int sockfd, const InetAddress &peer_addr)
+void TcpServer::set_high_water_mark_callback(HighWaterMarkCallback cb, size_t high_water_mark)
+{
+    high_water_mark_callback_ = std::move(cb);
+    high_water_mark_ = high_water_mark;
+}
+
+void TcpServer::set_accept_batch(int batch)
+{
+    assert(!started_);
+    accept_batch_ = batch;
+    acceptor_->set_accept_batch(batch);
+}
+
+std::uint64_t TcpServer::dropped_connections() const
+{
+    std::uint64_t dropped = acceptor_->dropped_connections();
+    for (auto &owner : loop_acceptors_)
+    {
+        dropped += owner->acceptor->dropped_connections();
+    }
+    return dropped;
+}
+
+void TcpServer::set_edge_triggered(bool on)
+{
+    edge_triggered_ = on;
+}
+
+void TcpServer::set_buffer_slab_size(size_t slab_size)
+{
+    buffer_slab_size_ = slab_size;
+}
+
+void TcpServer::set_buffer_release_threshold(size_t bytes)
+{
+    buffer_release_threshold_ = bytes;
+}
+
+void TcpServer::set_buffer_prefault(size_t count, size_t size)
+{
+    assert(!started_);
+    thread_pool_->set_buffer_prefault(count, size);
+}
+
+BufferPoolStats TcpServer::buffer_pool_stats() const
+{
+    return thread_pool_->buffer_pool_stats();
+}
+
+// one task per IO loop for the whole batch instead of one per connection
+void TcpServer::new_connections(std::vector<Acceptor::NewConnection>& batch)
 {
     loop_->assert_in_loop_thread();
-    EventLoop* io_loop = thread_pool_->get_next_loop();
-    char buf[32];
-    snprintf(buf, sizeof(buf), ":%s#%d", host_port_.c_str(), next_conn_id_);
-    ++next_conn_id_;
-    std::string conn_name = name_ + buf;
+    std::vector<std::pair<EventLoop *, std::vector<TcpConnectionPtr>>> handoffs;
+    for (auto &accepted : batch)
+    {
+        EventLoop* io_loop = thread_pool_->get_next_loop(accepted.second);
+        char buf[32];
+        snprintf(buf, sizeof(buf), ":%s#%d", host_port_.c_str(), next_conn_id_);
+        ++next_conn_id_;
+        auto conn = create_connection(io_loop, name_ + buf, accepted.first, accepted.second);
+        connections_[conn->name()] = conn;
+        conn->set_close_callback([this] (const TcpConnectionPtr& p_conn) {
+            this->remove_connection(p_conn);
+        });
+
+        auto it = handoffs.begin();
+        while (it != handoffs.end() && it->first != io_loop)
+        {
+            ++it;
+        }
+        if (it == handoffs.end())
+        {
+            handoffs.emplace_back(io_loop, std::vector<TcpConnectionPtr>());
+            it = handoffs.end() - 1;
+        }
+        it->second.push_back(std::move(conn));
+    }
+
+    for (auto &handoff : handoffs)
+    {
+        handoff.first->run_in_loop([conns = std::move(handoff.second)] () {
+            for (auto &conn : conns)
+            {
+                conn->connect_established();
+            }
+        });
+    }
+}
+
+TcpConnectionPtr TcpServer::create_connection(EventLoop *io_loop, std::string conn_name,
+                                              int sockfd, const InetAddress &peer_addr)
+{
     InetAddress local_addr(sockets::get_local_addr(sockfd));
-    auto conn = std::make_shared<TcpConnection>(io_loop, conn_name, sockfd, local_addr, peer_addr);
-    connections_[conn_name] = conn;
+    auto conn = std::make_shared<TcpConnection>(io_loop, std::move(conn_name), sockfd, local_addr, peer_addr);
     conn->set_connection_callback(connection_callback_);
     conn->set_message_callback(message_callback_);
     conn->set_write_complete_callback(write_complete_callback_);
-    conn->set_close_callback([this] (const TcpConnectionPtr& p_conn) {
-        this->remove_connection(p_conn);
+    conn->set_high_water_mark_callback(high_water_mark_callback_, high_water_mark_);
+    conn->set_edge_triggered(edge_triggered_);
+    conn->set_slab_size(buffer_slab_size_);
+    conn->set_buffer_release_threshold(buffer_release_threshold_);
+    return conn;
+}
+
+void TcpServer::start_loop_acceptors()
+{
+    if (!reuse_port_)
+    {
+        return;
+    }
+    auto loops = thread_pool_->get_all_loops();
+    if (loops.size() == 1 && loops[0] == loop_)
+    {
+        // no IO loops, the base acceptor does it all
+        return;
+    }
+
+    for (auto io_loop : loops)
+    {
+        auto owner = std::make_unique<LoopAcceptor>();
+        owner->loop = io_loop;
+        owner->index = static_cast<int>(loop_acceptors_.size());
+        owner->acceptor = std::make_unique<Acceptor>(io_loop, listen_addr_, true);
+        owner->acceptor->set_accept_batch(accept_batch_);
+        owner->next_conn_id = 1;
+        owner->acceptor->set_new_connection_callback(
+            [this, ptr = owner.get()] (int sockfd, const InetAddress& peer_addr) {
+                this->new_connection_in_loop(ptr, sockfd, peer_addr);
+            });
+        // listening once start() returns, an early client is not refused
+        std::promise<void> done;
+        io_loop->run_in_loop([ptr = owner->acceptor.get(), &done] () {
+            ptr->listen();
+            done.set_value();
+        });
+        done.get_future().wait();
+        loop_acceptors_.push_back(std::move(owner));
+    }
+}
+
+// kReusePort: the connection never leaves the loop which accepted it
+void TcpServer::new_connection_in_loop(LoopAcceptor *owner, int sockfd, const InetAddress &peer_addr)
+{
+    owner->loop->assert_in_loop_thread();
+    char buf[48];
+    snprintf(buf, sizeof(buf), ":%s#%d.%d", host_port_.c_str(), owner->index, owner->next_conn_id);
+    ++owner->next_conn_id;
+    auto conn = create_connection(owner->loop, name_ + buf, sockfd, peer_addr);
+    owner->connections[conn->name()] = conn;
+    conn->set_close_callback([this, owner] (const TcpConnectionPtr& p_conn) {
+        this->remove_connection_from_loop(owner, p_conn);
     });
-    io_loop->run_in_loop([conn] () {
-        conn->connect_established();
+    conn->connect_established();
+}
+
+void TcpServer::remove_connection_from_loop(LoopAcceptor *owner, const TcpConnectionPtr &conn)
+{
+    owner->loop->assert_in_loop_thread();
+    size_t n = owner->connections.erase(conn->name());
+    assert(n == 1);
+    // still inside the channel's handle_event
+    owner->loop->queue_in_loop([conn] () {
+        conn->connect_destroyed();
     });
 }
 
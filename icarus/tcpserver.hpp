@@ -4,40 +4,108 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
+#include <cstdint>
 
 #include "noncopyable.hpp"
 #include "inetaddress.hpp"
 #include "callbacks.hpp"
+#include "poller.hpp"
+#include "loopplacement.hpp"
+#include "eventloopthreadpool.hpp"
+#include "acceptor.hpp"
 
 namespace icarus
 {
 
 class InetAddress;
 class EventLoop;
-class Acceptor;
-class EventLoopThreadPool;
 
 class TcpServer : noncopyable
 {
   public:
-    TcpServer(EventLoop* loop, const InetAddress& listen_addr, std::string name);
+    enum Option
+    {
+        kNoReusePort,
+        // every IO loop listens on its own SO_REUSEPORT socket, accepts
+        //  its connections itself and keeps them in its own map
+        kReusePort
+    };
+
+    TcpServer(EventLoop* loop, const InetAddress& listen_addr, std::string name,
+              Option option = kNoReusePort);
     ~TcpServer();
 
     void set_thread_num(int num_threads);
+
+    // backend of the IO loops, the base loop keeps its own
+    void set_poller_backend(PollerBackend backend);
+
+    // cpu placement of the IO loops
+    void set_loop_placement(LoopPlacement placement);
+
+    // how new connections are spread over the IO loops
+    void set_loop_selection(LoopSelection selection);
+    void set_loop_selector(EventLoopThreadPool::LoopSelector selector);
     void start();
 
     void set_connection_callback(ConnectionCallback cb);
     void set_message_callback(MessageCallback cb);
     void set_write_complete_callback(WriteCompleteCallback cb);
 
+    // see TcpConnection::set_high_water_mark_callback
+    void set_high_water_mark_callback(HighWaterMarkCallback cb, size_t high_water_mark);
+
+    // connections accepted per readiness event, must be set before start()
+    void set_accept_batch(int batch);
+
+    // connections closed right after accept because fds ran out
+    std::uint64_t dropped_connections() const;
+
+    // connections drain their socket on every wakeup and
+    //  register with EPOLLET, off by default
+    void set_edge_triggered(bool on);
+
+    // see TcpConnection::set_slab_size, 0 (contiguous) by default
+    void set_buffer_slab_size(size_t slab_size);
+
+    // see TcpConnection::set_buffer_release_threshold
+    void set_buffer_release_threshold(size_t bytes);
+
+    // see EventLoopThreadPool::set_buffer_prefault, before start()
+    void set_buffer_prefault(size_t count,
+                             size_t size = Buffer::kCheapPrepend + Buffer::kInitialSize);
+
+    // buffer storage reuse over all loops, thread safe once started
+    BufferPoolStats buffer_pool_stats() const;
+
   private:
-    void new_connection(int sockfd, const InetAddress& peer_addr);
+    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+
+    // acceptor and connections owned by one IO loop in kReusePort mode,
+    //  only touched in that loop's thread
+    struct LoopAcceptor
+    {
+        EventLoop *loop;
+        int index;
+        std::unique_ptr<Acceptor> acceptor;
+        ConnectionMap connections;
+        int next_conn_id;
+    };
+
+    void new_connections(std::vector<Acceptor::NewConnection>& batch);
     void remove_connection(const TcpConnectionPtr& conn);
     void remove_connection_in_loop(const TcpConnectionPtr& conn);
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    void start_loop_acceptors();
+    void new_connection_in_loop(LoopAcceptor *owner, int sockfd, const InetAddress& peer_addr);
+    void remove_connection_from_loop(LoopAcceptor *owner, const TcpConnectionPtr& conn);
+
+    TcpConnectionPtr create_connection(EventLoop *io_loop, std::string conn_name,
+                                       int sockfd, const InetAddress& peer_addr);
 
     EventLoop* loop_;
+    const InetAddress listen_addr_;
     const std::string host_port_;
     const std::string name_;
     std::unique_ptr<Acceptor> acceptor_;
@@ -45,9 +113,17 @@ class TcpServer : noncopyable
     ConnectionCallback connection_callback_;
     MessageCallback  message_callback_;
     WriteCompleteCallback write_complete_callback_;
+    HighWaterMarkCallback high_water_mark_callback_;
+    size_t high_water_mark_;
     bool started_;
+    bool edge_triggered_;
+    size_t buffer_slab_size_;
+    size_t buffer_release_threshold_;
+    const bool reuse_port_;
+    int accept_batch_;
     int next_conn_id_;
     ConnectionMap connections_;
+    std::vector<std::unique_ptr<LoopAcceptor>> loop_acceptors_;
 };
 
 } // namespace icarus
@@ -0,0 +1,33 @@
+#ifndef ICARUS_TIMERID_HPP
+#define ICARUS_TIMERID_HPP
+
+#include <cstdint>
+
+namespace icarus
+{
+class Timer;
+
+// opaque handle returned by EventLoop::run_at/run_after/run_every,
+//  only used to cancel the timer
+class TimerId
+{
+  public:
+    TimerId()
+      : timer_(nullptr), sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, std::uint64_t sequence)
+      : timer_(timer), sequence_(sequence)
+    {
+    }
+
+  private:
+    friend class TimerQueue;
+
+    Timer *timer_;
+    std::uint64_t sequence_;
+};
+} // namespace icarus
+
+#endif // ICARUS_TIMERID_HPP
@@ -1 +1,378 @@
-#include "timerqueue.hpp"
\ No newline at end of file
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "eventloop.hpp"
+#include "timerqueue.hpp"
+
+namespace icarus
+{
+class Timer
+{
+  public:
+    TimerCallback callback;
+    std::uint64_t expiration;   // in ticks
+    std::uint64_t interval;     // in ticks, 0 for one-shot
+    std::atomic<std::uint64_t> sequence;
+    Timer *prev;
+    Timer *next;
+    int level;                  // -1 when not linked into the wheel
+    int slot;
+    bool cancelled;
+};
+
+namespace
+{
+int create_timerfd()
+{
+    int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        abort();
+    }
+    return fd;
+}
+
+// distance to the nearest set bit after `from`, in [1, 64]
+int next_set_bit(std::uint64_t bits, std::uint64_t from)
+{
+    int shift = static_cast<int>((from + 1) & 63);
+    std::uint64_t rotated = shift ? (bits >> shift) | (bits << (64 - shift)) : bits;
+    return __builtin_ctzll(rotated) + 1;
+}
+} // namespace
+
+TimerQueue::TimerQueue(EventLoop *loop)
+  : loop_(loop),
+    base_(Clock::now()),
+    timerfd_(create_timerfd()),
+    timerfd_channel_(loop, timerfd_),
+    wheels_(),
+    current_tick_(0),
+    armed_tick_(UINT64_MAX),
+    size_(0),
+    running_(nullptr),
+    free_list_(nullptr),
+    next_sequence_(0)
+{
+    timerfd_channel_.set_read_callback([this] () {
+        this->handle_read();
+    });
+    timerfd_channel_.enable_reading();
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfd_channel_.disable_all();
+    timerfd_channel_.remove();
+    ::close(timerfd_);
+}
+
+TimerId TimerQueue::add_timer(TimerCallback cb, Clock::time_point when, Clock::duration interval)
+{
+    Timer *timer = alloc_timer();
+    timer->callback = std::move(cb);
+    timer->expiration = to_tick(when);
+    timer->interval = std::max<std::uint64_t>(
+        std::chrono::ceil<std::chrono::milliseconds>(interval).count(),
+        interval > Clock::duration::zero() ? 1 : 0);
+    TimerId id(timer, timer->sequence.load(std::memory_order_relaxed));
+
+    if (loop_->is_in_loop_thread())
+    {
+        add_timer_in_loop(timer);
+    }
+    else
+    {
+        loop_->queue_in_loop([this, timer] () {
+            this->add_timer_in_loop(timer);
+        });
+    }
+    return id;
+}
+
+void TimerQueue::cancel(TimerId timer_id)
+{
+    loop_->run_in_loop([this, timer_id] () {
+        this->cancel_in_loop(timer_id);
+    });
+}
+
+void TimerQueue::add_timer_in_loop(Timer *timer)
+{
+    loop_->assert_in_loop_thread();
+    if (timer->cancelled)
+    {
+        free_timer(timer);
+        return;
+    }
+
+    if (size_ == 0 && !running_)
+    {
+        // nothing is pending, jump the wheel to now instead of
+        //  cascading through every idle slot on the next expiry
+        current_tick_ = std::max(current_tick_, now_tick());
+    }
+    timer->expiration = std::max(timer->expiration, current_tick_ + 1);
+    link(timer);
+    ++size_;
+
+    if (timer->expiration < armed_tick_)
+    {
+        rearm(timer->expiration);
+    }
+}
+
+void TimerQueue::cancel_in_loop(TimerId timer_id)
+{
+    loop_->assert_in_loop_thread();
+    Timer *timer = timer_id.timer_;
+    if (!timer || timer->sequence.load(std::memory_order_relaxed) != timer_id.sequence_)
+    {
+        // already expired or cancelled
+        return;
+    }
+
+    timer->cancelled = true;
+    if (timer->level >= 0)
+    {
+        unlink(timer);
+        --size_;
+        free_timer(timer);
+    }
+    // else it is running now or still queued by another thread,
+    //  whoever holds it frees it after seeing cancelled
+}
+
+void TimerQueue::handle_read()
+{
+    loop_->assert_in_loop_thread();
+    std::uint64_t howmany;
+    ::read(timerfd_, &howmany, sizeof howmany);
+
+    armed_tick_ = UINT64_MAX;
+    advance(now_tick());
+    if (size_ > 0)
+    {
+        rearm(next_tick());
+    }
+}
+
+void TimerQueue::advance(std::uint64_t target)
+{
+    while (current_tick_ < target)
+    {
+        std::uint64_t tick = current_tick_ + 1;
+        if ((tick & kSlotMask) != 0)
+        {
+            // skip straight to the next occupied slot in this round of level 0
+            std::uint64_t pending = wheels_[0].occupied >> (tick & kSlotMask);
+            if (pending == 0)
+            {
+                current_tick_ = std::min(tick | kSlotMask, target);
+                continue;
+            }
+            tick += __builtin_ctzll(pending);
+            if (tick > target)
+            {
+                current_tick_ = target;
+                break;
+            }
+        }
+
+        current_tick_ = tick;
+        if ((tick & kSlotMask) == 0)
+        {
+            for (int level = 1; level < kLevels; ++level)
+            {
+                int index = static_cast<int>((tick >> (level * kLevelBits)) & kSlotMask);
+                cascade(level, index);
+                if (index != 0)
+                {
+                    break;
+                }
+            }
+        }
+        expire(static_cast<int>(tick & kSlotMask));
+    }
+}
+
+void TimerQueue::cascade(int level, int index)
+{
+    auto &wheel = wheels_[level];
+    while (Timer *timer = wheel.slots[index])
+    {
+        unlink(timer);
+        link(timer);
+    }
+}
+
+void TimerQueue::expire(int index)
+{
+    auto &wheel = wheels_[0];
+    // pop one by one, callbacks may cancel timers still in this slot
+    while (Timer *timer = wheel.slots[index])
+    {
+        unlink(timer);
+        running_ = timer;
+        timer->callback();
+        running_ = nullptr;
+
+        if (timer->interval > 0 && !timer->cancelled)
+        {
+            timer->expiration = std::max(timer->expiration + timer->interval, current_tick_ + 1);
+            link(timer);
+        }
+        else
+        {
+            --size_;
+            free_timer(timer);
+        }
+    }
+}
+
+void TimerQueue::link(Timer *timer)
+{
+    assert(timer->expiration >= current_tick_);
+    std::uint64_t delta = timer->expiration - current_tick_;
+    std::uint64_t slot_tick = timer->expiration;
+    if (delta > kMaxDelta)
+    {
+        // beyond the top wheel, parked in its farthest slot and
+        //  re-linked with the real expiration when cascaded
+        delta = kMaxDelta;
+        slot_tick = current_tick_ + kMaxDelta;
+    }
+
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (std::uint64_t(1) << ((level + 1) * kLevelBits)))
+    {
+        ++level;
+    }
+    int index = static_cast<int>((slot_tick >> (level * kLevelBits)) & kSlotMask);
+
+    auto &wheel = wheels_[level];
+    timer->level = level;
+    timer->slot = index;
+    timer->prev = nullptr;
+    timer->next = wheel.slots[index];
+    if (timer->next)
+    {
+        timer->next->prev = timer;
+    }
+    wheel.slots[index] = timer;
+    wheel.occupied |= std::uint64_t(1) << index;
+}
+
+void TimerQueue::unlink(Timer *timer)
+{
+    assert(timer->level >= 0);
+    auto &wheel = wheels_[timer->level];
+    if (timer->prev)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        wheel.slots[timer->slot] = timer->next;
+        if (!timer->next)
+        {
+            wheel.occupied &= ~(std::uint64_t(1) << timer->slot);
+        }
+    }
+    if (timer->next)
+    {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = timer->next = nullptr;
+    timer->level = -1;
+}
+
+void TimerQueue::rearm(std::uint64_t tick)
+{
+    auto expiration = base_ + std::chrono::milliseconds(tick);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        expiration.time_since_epoch()).count();
+
+    struct itimerspec new_value = {};
+    new_value.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+    new_value.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+    if (::timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &new_value, nullptr) < 0)
+    {
+        abort();
+    }
+    armed_tick_ = tick;
+}
+
+// earliest tick at which something may expire: exact for level 0,
+//  the next cascade point for the upper levels
+std::uint64_t TimerQueue::next_tick() const
+{
+    std::uint64_t next = UINT64_MAX;
+    if (wheels_[0].occupied)
+    {
+        next = current_tick_ + next_set_bit(wheels_[0].occupied, current_tick_);
+    }
+    for (int level = 1; level < kLevels; ++level)
+    {
+        if (wheels_[level].occupied)
+        {
+            int shift = level * kLevelBits;
+            std::uint64_t position = current_tick_ >> shift;
+            std::uint64_t tick = (position + next_set_bit(wheels_[level].occupied, position)) << shift;
+            next = std::min(next, tick);
+        }
+    }
+    return next;
+}
+
+std::uint64_t TimerQueue::to_tick(Clock::time_point when) const
+{
+    if (when <= base_)
+    {
+        return 0;
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(when - base_).count();
+}
+
+std::uint64_t TimerQueue::now_tick() const
+{
+    return std::chrono::floor<std::chrono::milliseconds>(Clock::now() - base_).count();
+}
+
+Timer *TimerQueue::alloc_timer()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_list_)
+    {
+        chunks_.push_back(std::make_unique<Timer[]>(kChunkSize));
+        Timer *chunk = chunks_.back().get();
+        for (int i = kChunkSize - 1; i >= 0; --i)
+        {
+            chunk[i].next = free_list_;
+            free_list_ = &chunk[i];
+        }
+    }
+
+    Timer *timer = free_list_;
+    free_list_ = timer->next;
+    timer->sequence.store(++next_sequence_, std::memory_order_relaxed);
+    timer->prev = timer->next = nullptr;
+    timer->level = -1;
+    timer->slot = -1;
+    timer->cancelled = false;
+    return timer;
+}
+
+void TimerQueue::free_timer(Timer *timer)
+{
+    timer->callback = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer->sequence.store(0, std::memory_order_relaxed);
+    timer->next = free_list_;
+    free_list_ = timer;
+}
+} // namespace icarus
@@ -1,13 +1,91 @@
 #ifndef ICARUS_TIMERQUEUE_HPP
 #define ICARUS_TIMERQUEUE_HPP
 
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "noncopyable.hpp"
+#include "callbacks.hpp"
+#include "channel.hpp"
+#include "timerid.hpp"
+
 namespace icarus
 {
-class TimerQueue
+class EventLoop;
+
+/**
+ * hierarchical timing wheel with 1ms ticks, driven by one timerfd
+ *
+ * a timer is linked into the lowest level whose span covers its distance
+ *  from the current tick, and is cascaded one level down each time the
+ *  lower wheel wraps. insert and cancel are O(1), expiring skips empty
+ *  slots with a bitmap per level.
+*/
+class TimerQueue : noncopyable
 {
   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // thread safe
+    TimerId add_timer(TimerCallback cb, Clock::time_point when, Clock::duration interval);
+    void cancel(TimerId timer_id);
+
   private:
+    static constexpr int kLevelBits = 6;
+    static constexpr int kSlots = 1 << kLevelBits;
+    static constexpr int kLevels = 5;
+    static constexpr std::uint64_t kSlotMask = kSlots - 1;
+    static constexpr std::uint64_t kMaxDelta = (std::uint64_t(1) << (kLevelBits * kLevels)) - 1;
+    static constexpr int kChunkSize = 1024;
+
+    struct Wheel
+    {
+        Timer *slots[kSlots];
+        std::uint64_t occupied;
+    };
+
+    void add_timer_in_loop(Timer *timer);
+    void cancel_in_loop(TimerId timer_id);
+    void handle_read();
+
+    void advance(std::uint64_t target);
+    void cascade(int level, int index);
+    void expire(int index);
+
+    void link(Timer *timer);
+    void unlink(Timer *timer);
+    void rearm(std::uint64_t tick);
+    std::uint64_t next_tick() const;
+
+    std::uint64_t to_tick(Clock::time_point when) const;
+    std::uint64_t now_tick() const;
+
+    Timer *alloc_timer();
+    void free_timer(Timer *timer);
+
+    EventLoop *loop_;
+    const Clock::time_point base_;
+    const int timerfd_;
+    Channel timerfd_channel_;
+    Wheel wheels_[kLevels];
+    std::uint64_t current_tick_;
+    std::uint64_t armed_tick_;
+    std::size_t size_;
+    Timer *running_;
+
+    // timer nodes are never freed before the queue itself,
+    //  so a stale TimerId can always be checked by its sequence
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Timer[]>> chunks_;
+    Timer *free_list_;
+    std::uint64_t next_sequence_;
 };
 } // namespace icarus
 
-#endif // ICARUS_TIMERQUEUE_HPP
\ No newline at end of file
+#endif // ICARUS_TIMERQUEUE_HPP
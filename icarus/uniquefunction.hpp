@@ -0,0 +1,204 @@
+#ifndef ICARUS_UNIQUEFUNCTION_HPP
+#define ICARUS_UNIQUEFUNCTION_HPP
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace icarus
+{
+template <typename Signature, std::size_t InlineSize = 64>
+class UniqueFunction;
+
+/**
+ * move-only replacement of std::function
+ *
+ * callables up to InlineSize bytes which are nothrow movable live inside the
+ *  object, so typical lambdas (a few pointers, a shared_ptr, a std::string)
+ *  never touch the heap. larger ones are boxed. invoking an empty
+ *  UniqueFunction throws std::bad_function_call.
+*/
+template <typename R, typename... Args, std::size_t InlineSize>
+class UniqueFunction<R(Args...), InlineSize>
+{
+  public:
+    UniqueFunction() noexcept
+      : ops_(nullptr)
+    {
+    }
+
+    UniqueFunction(std::nullptr_t) noexcept
+      : ops_(nullptr)
+    {
+    }
+
+    template <typename F,
+              typename Fn = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Fn, UniqueFunction>
+                                          && std::is_invocable_r_v<R, Fn &, Args...>>>
+    UniqueFunction(F &&f)
+      : ops_(nullptr)
+    {
+        if constexpr (std::is_pointer_v<Fn> || std::is_member_pointer_v<Fn>)
+        {
+            if (f == nullptr)
+            {
+                return;
+            }
+        }
+
+        if constexpr (kFitsInline<Fn>)
+        {
+            ::new (static_cast<void *>(&storage_)) Fn(std::forward<F>(f));
+        }
+        else
+        {
+            ::new (static_cast<void *>(&storage_)) Fn *(new Fn(std::forward<F>(f)));
+        }
+        ops_ = &kOps<Fn>;
+    }
+
+    UniqueFunction(UniqueFunction &&other) noexcept
+      : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    UniqueFunction &operator=(UniqueFunction &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_)
+            {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    UniqueFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <typename F,
+              typename Fn = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Fn, UniqueFunction>
+                                          && std::is_invocable_r_v<R, Fn &, Args...>>>
+    UniqueFunction &operator=(F &&f)
+    {
+        return *this = UniqueFunction(std::forward<F>(f));
+    }
+
+    UniqueFunction(const UniqueFunction &) = delete;
+    UniqueFunction &operator=(const UniqueFunction &) = delete;
+
+    ~UniqueFunction()
+    {
+        reset();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops_ != nullptr;
+    }
+
+    R operator()(Args... args) const
+    {
+        if (!ops_)
+        {
+            throw std::bad_function_call();
+        }
+        return ops_->invoke(const_cast<Storage *>(&storage_), std::forward<Args>(args)...);
+    }
+
+  private:
+    using Storage = std::aligned_storage_t<InlineSize, alignof(std::max_align_t)>;
+
+    struct Ops
+    {
+        R (*invoke)(Storage *, Args &&...);
+        void (*move)(Storage *dst, Storage *src) noexcept;
+        void (*destroy)(Storage *) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr bool kFitsInline = sizeof(Fn) <= InlineSize
+                                     && alignof(Fn) <= alignof(std::max_align_t)
+                                     && std::is_nothrow_move_constructible_v<Fn>;
+
+    template <typename Fn>
+    static Fn *target(Storage *storage) noexcept
+    {
+        if constexpr (kFitsInline<Fn>)
+        {
+            return std::launder(reinterpret_cast<Fn *>(storage));
+        }
+        else
+        {
+            return *std::launder(reinterpret_cast<Fn **>(storage));
+        }
+    }
+
+    template <typename Fn>
+    static R invoke(Storage *storage, Args &&...args)
+    {
+        return std::invoke(*target<Fn>(storage), std::forward<Args>(args)...);
+    }
+
+    template <typename Fn>
+    static void move(Storage *dst, Storage *src) noexcept
+    {
+        if constexpr (kFitsInline<Fn>)
+        {
+            Fn *from = target<Fn>(src);
+            ::new (static_cast<void *>(dst)) Fn(std::move(*from));
+            from->~Fn();
+        }
+        else
+        {
+            ::new (static_cast<void *>(dst)) Fn *(target<Fn>(src));
+        }
+    }
+
+    template <typename Fn>
+    static void destroy(Storage *storage) noexcept
+    {
+        if constexpr (kFitsInline<Fn>)
+        {
+            target<Fn>(storage)->~Fn();
+        }
+        else
+        {
+            delete target<Fn>(storage);
+        }
+    }
+
+    template <typename Fn>
+    static constexpr Ops kOps = { &invoke<Fn>, &move<Fn>, &destroy<Fn> };
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops *ops_;
+};
+} // namespace icarus
+
+#endif // ICARUS_UNIQUEFUNCTION_HPP
@@ -0,0 +1,387 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "channel.hpp"
+#include "uringpoller.hpp"
+
+using namespace icarus;
+
+namespace
+{
+int io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags, const void *arg, std::size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+unsigned load_acquire(const unsigned *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void store_release(unsigned *p, unsigned value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+std::uint64_t make_user_data(int fd, std::uint32_t generation)
+{
+    return (static_cast<std::uint64_t>(generation) << 32) | static_cast<std::uint32_t>(fd);
+}
+
+void *map_ring(int ring_fd, std::size_t size, off_t offset)
+{
+    void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    if (p == MAP_FAILED)
+    {
+        abort();
+    }
+    return p;
+}
+} // namespace
+
+bool UringPoller::supported()
+{
+    static const bool supported = [] {
+        struct io_uring_params params;
+        ::memset(&params, 0, sizeof params);
+        int fd = io_uring_setup(2, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(fd);
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+UringPoller::UringPoller(EventLoop *loop)
+  : Poller(loop),
+    ring_fd_(-1),
+    features_(0),
+    multishot_(false),
+    sq_ring_(nullptr),
+    sq_ring_size_(0),
+    cq_ring_(nullptr),
+    cq_ring_size_(0),
+    sqes_(nullptr),
+    sqes_size_(0)
+{
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof params);
+    ring_fd_ = io_uring_setup(kEntries, &params);
+    if (ring_fd_ < 0)
+    {
+        abort();
+    }
+    features_ = params.features;
+    // multishot poll came with 5.13, the same release as resource tags
+    multishot_ = (features_ & IORING_FEAT_RSRC_TAGS) != 0;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = map_ring(ring_fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = (features_ & IORING_FEAT_SINGLE_MMAP)
+             ? sq_ring_
+             : map_ring(ring_fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map_ring(ring_fd_, sqes_size_, IORING_OFF_SQES));
+
+    auto sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_entries_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+    auto cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cq_entries_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_entries);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+}
+
+UringPoller::~UringPoller()
+{
+    ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_)
+    {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    ::munmap(sq_ring_, sq_ring_size_);
+    ::close(ring_fd_);
+}
+
+std::chrono::system_clock::time_point UringPoller::poll(int timeout_ms, ChannelList *active_channels)
+{
+    // one-shot polls which completed last time are armed again only now,
+    //  after their handlers had a chance to consume the readiness. arming
+    //  may collect completions which append to rearm_fds_
+    for (std::size_t i = 0; i < rearm_fds_.size(); ++i)
+    {
+        int fd = rearm_fds_[i];
+        auto &state = state_of(fd);
+        state.rearm = false;
+        Channel *channel = find_channel(fd);
+        if (channel && state.armed_events == 0 && !channel->is_none_event())
+        {
+            arm(channel);
+        }
+    }
+    rearm_fds_.clear();
+
+    submit(1, timeout_ms);
+    auto now = std::chrono::system_clock::now();
+
+    std::size_t n = reap(active_channels);
+    record_poll(n, n == cq_entries_, cq_entries_);
+    return now;
+}
+
+void UringPoller::update_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    if (channel->index() == kNew)
+    {
+        add_channel(channel);
+        channel->set_index(kAdded);
+    }
+    assert(has_channel(channel));
+
+    auto &state = state_of(channel->fd());
+    std::uint32_t events = channel->is_none_event() ? 0 : static_cast<std::uint16_t>(channel->events());
+    bool multishot = multishot_ && channel->edge_triggered();
+    if (state.armed_events != 0)
+    {
+        if (state.armed_events == events && state.multishot == multishot)
+        {
+            return;
+        }
+        disarm(channel->fd());
+    }
+    if (events != 0)
+    {
+        arm(channel);
+    }
+}
+
+void UringPoller::remove_channel(Channel *channel)
+{
+    assert_in_loop_thread();
+    assert(has_channel(channel));
+    assert(channel->is_none_event());
+    auto &state = state_of(channel->fd());
+    if (state.armed_events != 0)
+    {
+        disarm(channel->fd());
+    }
+    // completions still in flight for this fd must not reach a new channel
+    ++state.generation;
+    state.revents = 0;
+    channel->set_index(kNew);
+    erase_channel(channel);
+}
+
+PollerBackend UringPoller::backend() const
+{
+    return PollerBackend::kIoUring;
+}
+
+UringPoller::PollState &UringPoller::state_of(int fd)
+{
+    auto index = static_cast<std::size_t>(fd);
+    if (index >= states_.size())
+    {
+        states_.resize(index + 1, PollState{ 0, 0, 0, false, false });
+    }
+    return states_[index];
+}
+
+io_uring_sqe *UringPoller::get_sqe()
+{
+    unsigned tail = *sq_tail_;
+    if (tail - load_acquire(sq_head_) == sq_entries_)
+    {
+        // the submission queue is full, hand it over without waiting
+        submit(0, 0);
+        if (tail - load_acquire(sq_head_) == sq_entries_)
+        {
+            // refused while the completion queue is full, make room for
+            //  the kernel and try once more. what is collected is handed
+            //  out by the next poll()
+            collect();
+            submit(0, 0);
+        }
+        if (tail - load_acquire(sq_head_) == sq_entries_)
+        {
+            // the entry at the tail was not consumed, reusing it would lose it
+            abort();
+        }
+    }
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    ::memset(sqe, 0, sizeof *sqe);
+    sq_array_[index] = index;
+    return sqe;
+}
+
+void UringPoller::arm(Channel *channel)
+{
+    auto &state = state_of(channel->fd());
+    std::uint32_t events = static_cast<std::uint16_t>(channel->events());
+    bool multishot = multishot_ && channel->edge_triggered();
+
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = channel->fd();
+    sqe->poll32_events = events;
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = make_user_data(channel->fd(), state.generation);
+    store_release(sq_tail_, *sq_tail_ + 1);
+
+    state.armed_events = events;
+    state.multishot = multishot;
+}
+
+void UringPoller::disarm(int fd)
+{
+    auto &state = state_of(fd);
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(fd, state.generation);
+    sqe->user_data = kIgnored;
+    store_release(sq_tail_, *sq_tail_ + 1);
+
+    ++state.generation;
+    state.armed_events = 0;
+}
+
+// submits everything queued and waits for wait_nr completions
+void UringPoller::submit(unsigned wait_nr, int timeout_ms)
+{
+    unsigned to_submit = *sq_tail_ - load_acquire(sq_head_);
+    if (to_submit == 0 && wait_nr == 0)
+    {
+        return;
+    }
+
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+    struct io_uring_getevents_arg arg;
+    ::memset(&arg, 0, sizeof arg);
+    arg.ts = timeout_ms < 0 ? 0 : reinterpret_cast<std::uint64_t>(&ts);
+
+    unsigned flags = 0;
+    if (wait_nr > 0)
+    {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+    int ret = io_uring_enter(ring_fd_, to_submit, wait_nr, flags,
+                             flags ? &arg : nullptr, flags ? sizeof arg : 0);
+    if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN)
+    {
+        abort();
+    }
+}
+
+std::size_t UringPoller::reap(ChannelList *active_channels)
+{
+    std::size_t num_cqes = collect();
+    for (int fd : active_fds_)
+    {
+        auto &state = states_[fd];
+        if (state.revents == 0)
+        {
+            // removed after its completion was collected
+            continue;
+        }
+        Channel *channel = find_channel(fd);
+        assert(channel);
+        channel->set_revents(static_cast<short>(state.revents));
+        active_channels->push_back(channel);
+        state.revents = 0;
+    }
+    active_fds_.clear();
+    return num_cqes;
+}
+
+// consumes the completion queue into the states, without handing out
+std::size_t UringPoller::collect()
+{
+    unsigned head = *cq_head_;
+    unsigned tail = load_acquire(cq_tail_);
+    std::size_t num_cqes = tail - head;
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+        if (cqe.user_data == kIgnored)
+        {
+            continue;
+        }
+
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        auto generation = static_cast<std::uint32_t>(cqe.user_data >> 32);
+        if (static_cast<std::size_t>(fd) >= states_.size())
+        {
+            continue;
+        }
+        auto &state = states_[fd];
+        if (state.generation != generation)
+        {
+            // a request dropped by update_channel or remove_channel
+            continue;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            // the request is finished, arm it again on the next poll()
+            state.armed_events = 0;
+            if (!state.rearm)
+            {
+                state.rearm = true;
+                rearm_fds_.push_back(fd);
+            }
+        }
+
+        if (cqe.res < 0)
+        {
+            if (cqe.res == -EINVAL && state.multishot)
+            {
+                // the kernel rejected multishot, use one-shot polls from now on
+                multishot_ = false;
+            }
+            continue;
+        }
+
+        if (state.revents == 0)
+        {
+            active_fds_.push_back(fd);
+        }
+        state.revents |= static_cast<std::uint32_t>(cqe.res);
+    }
+    store_release(cq_head_, head);
+    return num_cqes;
+}
@@ -0,0 +1,94 @@
+#ifndef ICARUS_URINGPOLLER_HPP
+#define ICARUS_URINGPOLLER_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "poller.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace icarus
+{
+/**
+ * io_uring(7) backend built on IORING_OP_POLL_ADD
+ *
+ * every poll request, update and removal of one loop iteration goes to the
+ *  kernel with the single io_uring_enter that also waits for completions.
+ *  level-triggered channels use one-shot polls re-armed on the next poll(),
+ *  which keeps their semantics, edge-triggered channels use multishot polls
+ *  which stay armed until the channel changes.
+*/
+class UringPoller : public Poller
+{
+  public:
+    // io_uring_setup works and supports IORING_ENTER_EXT_ARG (5.11+)
+    static bool supported();
+
+    explicit UringPoller(EventLoop *loop);
+    ~UringPoller() override;
+
+    std::chrono::system_clock::time_point poll(int timeout_ms, ChannelList *active_channels) override;
+
+    void update_channel(Channel *channel) override;
+    void remove_channel(Channel *channel) override;
+
+    PollerBackend backend() const override;
+
+  private:
+    static constexpr unsigned kEntries = 1024;
+
+    // Channel::index()
+    static constexpr int kNew = -1;
+    static constexpr int kAdded = 1;
+
+    // user_data of requests whose completion is not interesting
+    static constexpr std::uint64_t kIgnored = UINT64_MAX;
+
+    struct PollState
+    {
+        std::uint32_t generation;   // bumped whenever the in-flight request is dropped
+        std::uint32_t armed_events; // 0 when no poll request is in flight
+        std::uint32_t revents;      // collected during one poll()
+        bool multishot;
+        bool rearm;                 // queued in rearm_fds_
+    };
+
+    PollState &state_of(int fd);
+    io_uring_sqe *get_sqe();
+    void arm(Channel *channel);
+    void disarm(int fd);
+    void submit(unsigned wait_nr, int timeout_ms);
+    std::size_t reap(ChannelList *active_channels);
+    std::size_t collect();
+
+    int ring_fd_;
+    unsigned features_;
+    bool multishot_;
+
+    void *sq_ring_;
+    std::size_t sq_ring_size_;
+    void *cq_ring_;
+    std::size_t cq_ring_size_;
+    io_uring_sqe *sqes_;
+    std::size_t sqes_size_;
+
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned *sq_array_;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned cq_mask_;
+    unsigned cq_entries_;
+    io_uring_cqe *cqes_;
+
+    std::vector<PollState> states_;
+    std::vector<int> rearm_fds_;
+    std::vector<int> active_fds_;
+};
+} // namespace icarus
+
+#endif // ICARUS_URINGPOLLER_HPP
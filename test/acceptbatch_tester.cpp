@@ -0,0 +1,155 @@
+#include <chrono>
+#include <vector>
+#include <cerrno>
+#include <cstdlib>
+#include <cassert>
+#include <dirent.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../icarus/acceptor.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/socketsfunc.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+const uint16_t kPort = 9878;
+
+// connected as soon as it returns, the listener's backlog holds it
+int connect_client()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd >= 0);
+    int ret = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+    assert(ret == 0);
+    (void) ret;
+    return fd;
+}
+
+// the server closed it without a word
+bool closed_by_peer(int fd)
+{
+    char c;
+    ssize_t n = ::read(fd, &c, 1);
+    return n == 0 || (n < 0 && errno == ECONNRESET);
+}
+
+int highest_fd()
+{
+    int highest = -1;
+    DIR *dir = ::opendir("/proc/self/fd");
+    assert(dir);
+    while (struct dirent *entry = ::readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            highest = max(highest, atoi(entry->d_name));
+        }
+    }
+    ::closedir(dir);
+    return highest;
+}
+
+void run_for(EventLoop *loop, chrono::milliseconds duration)
+{
+    loop->run_after(duration, [loop] { loop->quit(); });
+    loop->loop();
+}
+} // namespace
+
+int main()
+{
+    EventLoop loop;
+    Acceptor acceptor(&loop, InetAddress(kPort, true));
+    vector<size_t> batches;
+    vector<int> accepted;
+    acceptor.set_new_connections_callback([&] (vector<Acceptor::NewConnection> &connections) {
+        batches.push_back(connections.size());
+        for (auto &connection : connections)
+        {
+            accepted.push_back(connection.first);
+        }
+    });
+    acceptor.set_accept_batch(2);
+    acceptor.listen();
+
+    // one readiness event takes up to a batch, the rest the next ones
+    vector<int> clients;
+    for (int i = 0; i < 5; ++i)
+    {
+        clients.push_back(connect_client());
+    }
+    run_for(&loop, chrono::milliseconds(50));
+    assert((batches == vector<size_t>{2, 2, 1}));
+    assert(accepted.size() == 5);
+    for (int fd : accepted)
+    {
+        sockets::close(fd);
+    }
+    for (int fd : clients)
+    {
+        assert(closed_by_peer(fd));
+        ::close(fd);
+    }
+    batches.clear();
+    accepted.clear();
+    clients.clear();
+
+    // out of fds, the pending connections are taken with the idle fd and
+    //  closed instead of waking the listener again and again
+    for (int i = 0; i < 4; ++i)
+    {
+        clients.push_back(connect_client());
+    }
+    struct rlimit saved;
+    ::getrlimit(RLIMIT_NOFILE, &saved);
+    struct rlimit lowered = saved;
+    lowered.rlim_cur = highest_fd() + 1;
+    ::setrlimit(RLIMIT_NOFILE, &lowered);
+    // the holes below the limit are filled too
+    vector<int> fillers;
+    for (int fd; (fd = ::dup(0)) >= 0; )
+    {
+        fillers.push_back(fd);
+    }
+    assert(errno == EMFILE);
+
+    auto polls = loop.poller_stats().polls;
+    run_for(&loop, chrono::milliseconds(100));
+    assert(accepted.empty());
+    assert(acceptor.dropped_connections() == 4);
+    // a spinning listener would poll thousands of times
+    assert(loop.poller_stats().polls - polls < 20);
+
+    for (int fd : fillers)
+    {
+        ::close(fd);
+    }
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+    for (int fd : clients)
+    {
+        assert(closed_by_peer(fd));
+        ::close(fd);
+    }
+    clients.clear();
+
+    // with fds back, connections are accepted again
+    clients.push_back(connect_client());
+    run_for(&loop, chrono::milliseconds(50));
+    assert(accepted.size() == 1);
+    assert(acceptor.dropped_connections() == 4);
+    sockets::close(accepted[0]);
+    ::close(clients[0]);
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "../icarus/buffer.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+string pattern(size_t len, size_t seed)
+{
+    string s(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = static_cast<char>('a' + (i * 7 + seed) % 26);
+    }
+    return s;
+}
+
+string drain(Buffer &buf)
+{
+    return buf.retrieve_all_as_string();
+}
+} // namespace
+
+int main()
+{
+    // contiguous buffer, as always
+    {
+        Buffer buf;
+        buf.append("hello\r\nworld\n");
+        assert(buf.findCRLF() == buf.peek() + 5);
+        assert(buf.findEOL() == buf.peek() + 6);
+        buf.append_int32(42);
+        buf.retrieve_until(buf.findEOL() + 1);
+        assert(buf.retrieve_as_string(6) == "world\n");
+        assert(buf.read_int32() == 42);
+        assert(buf.readable_bytes() == 0);
+        assert(buf.contiguous_bytes() == 0);
+    }
+
+    // small messages never leave the head
+    {
+        Buffer buf;
+        buf.set_slab_size(4096);
+        for (int i = 0; i < 1000; ++i)
+        {
+            buf.append(pattern(100, i));
+            assert(buf.slab_count() == 0);
+            assert(buf.retrieve_as_string(100) == pattern(100, i));
+        }
+    }
+
+    // large appends chain slabs, reads cross the boundaries
+    {
+        Buffer buf;
+        buf.set_slab_size(4096);
+        string data = pattern(100000, 1);
+        buf.append(data.substr(0, 1000));
+        buf.append(data.substr(1000, 50000));
+        buf.append(data.substr(51000));
+        assert(buf.readable_bytes() == data.size());
+        assert(buf.slab_count() > 10);
+        assert(buf.contiguous_bytes() == 1000);
+
+        string part(3000, '\0');
+        buf.peek_bytes(part.data(), part.size(), 9000);
+        assert(part == data.substr(9000, 3000));
+
+        struct iovec vec[64];
+        int count = buf.readable_segments(vec, 64);
+        size_t total = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            assert(memcmp(vec[i].iov_base, data.data() + total, vec[i].iov_len) == 0);
+            total += vec[i].iov_len;
+        }
+        assert(total == data.size());
+
+        // int straddling a slab boundary
+        buf.retrieve(1000 + 4096 - 2);
+        int32_t be = 0;
+        memcpy(&be, data.data() + 1000 + 4096 - 2, 4);
+        assert(buf.peek_int32() == static_cast<int32_t>(ntohl(be)));
+
+        const char *joined = buf.pullup(10000);
+        assert(buf.contiguous_bytes() >= 10000);
+        assert(string(joined, 10000) == data.substr(5094, 10000));
+        assert(drain(buf) == data.substr(5094));
+        assert(buf.slab_count() == 0);
+    }
+
+    // write_fd flushes slabs with writev, read_fd reads into fresh slabs
+    {
+        int sv[2];
+        assert(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+        int size = 1 << 20;
+        ::setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof size);
+        ::setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof size);
+
+        Buffer out;
+        out.set_slab_size(16 * 1024);
+        string data = pattern(200000, 2);
+        out.append(data);
+
+        Buffer in;
+        in.set_slab_size(16 * 1024);
+        string received;
+        int saved_errno = 0;
+        while (received.size() + in.readable_bytes() < data.size())
+        {
+            if (out.readable_bytes() > 0)
+            {
+                out.write_fd(sv[0], &saved_errno);
+            }
+            while (in.read_fd(sv[1], &saved_errno) > 0)
+            {
+            }
+            if (in.readable_bytes() > 100000)
+            {
+                received += drain(in);
+            }
+        }
+        received += drain(in);
+        assert(received == data);
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // a read below one slab in total stays contiguous
+    {
+        int sv[2];
+        assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        Buffer in;
+        in.set_slab_size(16 * 1024);
+        string data = pattern(5000, 3);
+        assert(::write(sv[0], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+        int saved_errno = 0;
+        assert(in.read_fd(sv[1], &saved_errno) == static_cast<ssize_t>(data.size()));
+        assert(in.slab_count() == 0);
+        assert(in.to_string_view() == data);
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // the read size grows with full reads and shrinks after small ones
+    {
+        int sv[2];
+        assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        Buffer in;
+        assert(in.read_size_hint() == Buffer::kInitialSize);
+        string data = pattern(8000, 5);
+        assert(::write(sv[0], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+        int saved_errno = 0;
+        assert(in.read_fd(sv[1], &saved_errno) == static_cast<ssize_t>(data.size()));
+        assert(in.read_size_hint() == data.size());
+        assert(drain(in) == data);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            assert(::write(sv[0], "x", 1) == 1);
+            assert(in.read_fd(sv[1], &saved_errno) == 1);
+        }
+        assert(in.read_size_hint() == data.size() / 2);
+        assert(drain(in) == "xx");
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // shrink and swap keep the data and the mode
+    {
+        Buffer buf;
+        buf.set_slab_size(1024);
+        string data = pattern(10000, 4);
+        buf.append(data);
+        buf.shrink(0);
+        assert(buf.slab_count() == 0);
+        assert(buf.slab_size() == 1024);
+        assert(buf.to_string_view() == data);
+
+        Buffer other;
+        other.swap(buf);
+        assert(buf.readable_bytes() == 0);
+        assert(other.slab_size() == 1024);
+        assert(drain(other) == data);
+    }
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <string>
+#include <cassert>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/bufferpool.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthreadpool.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    // size classes, four per power of two
+    assert(BufferPool::block_size(1) == 256);
+    assert(BufferPool::block_size(256) == 256);
+    assert(BufferPool::block_size(257) == 320);
+    assert(BufferPool::block_size(1032) == 1280);
+    assert(BufferPool::block_size(4096) == 4096);
+    assert(BufferPool::block_size(4097) == 5120);
+    assert(BufferPool::block_size(BufferPool::kMaxBlockSize) == BufferPool::kMaxBlockSize);
+    assert(BufferPool::block_size(BufferPool::kMaxBlockSize + 1) == BufferPool::kMaxBlockSize + 1);
+    for (size_t size = 1; size < 100000; size += 37)
+    {
+        size_t block = BufferPool::block_size(size);
+        assert(block >= size);
+        assert(block < 2 * size || block == BufferPool::kMinBlockSize);
+    }
+
+    // without a loop everything is heap
+    {
+        Buffer buf;
+        buf.append(string(5000, 'x'));
+        buf.release();
+        assert(buf.readable_bytes() == 0);
+        assert(buf.internal_capacity() == 0);
+        buf.append("again");
+        assert(buf.to_string_view() == "again");
+    }
+
+    EventLoop loop;
+    BufferPool &pool = loop.buffer_pool();
+
+    // storage is taken on the first write, released storage is reused
+    //  by the next buffer of the same size
+    {
+        Buffer first;
+        assert(pool.stats().misses == 0);
+        assert(first.internal_capacity() == 0);
+        first.append("x");
+        assert(pool.stats().misses == 1);
+        first.release();
+        assert(pool.stats().cached_blocks == 1);
+        Buffer second;
+        second.append("y");
+        assert(pool.stats().hits == 1);
+        assert(pool.stats().cached_blocks == 0);
+    }
+    assert(pool.stats().cached_blocks == 1);
+
+    // prefault, capped by max_cached_bytes
+    pool.prefault(1032, 10);
+    assert(pool.stats().cached_blocks == 11);
+    assert(pool.stats().cached_bytes == 11 * 1280);
+    pool.set_max_cached_bytes(5 * 1280);
+    assert(pool.stats().cached_blocks == 5);
+    pool.prefault(1032, 10);
+    assert(pool.stats().cached_blocks == 5);
+    pool.set_max_cached_bytes(BufferPool::kDefaultMaxCachedBytes);
+
+    // a spill into the overflow area is counted, after it the buffer is
+    //  pre-grown to the learnt read size and messages go straight in
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        int size = 1 << 20;
+        ::setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof size);
+        ::setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof size);
+        string message(20000, 'm');
+        Buffer buf;
+        int saved_errno = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            assert(::write(sv[0], message.data(), message.size()) == static_cast<ssize_t>(message.size()));
+            assert(buf.read_fd(sv[1], &saved_errno) == static_cast<ssize_t>(message.size()));
+            assert(buf.retrieve_all_as_string() == message);
+            buf.release();
+        }
+        assert(pool.stats().overflow_copies == 1);
+        assert(pool.stats().overflow_bytes == message.size() - (1280 - Buffer::kCheapPrepend));
+        assert(buf.read_size_hint() >= message.size());
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // a connection hands its buffers back on connect_destroyed
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+        uint64_t cached = pool.stats().cached_blocks;
+        auto conn = make_shared<TcpConnection>(&loop, "pair", sv[0], InetAddress(), InetAddress());
+        assert(pool.stats().cached_blocks == cached);
+        conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+        conn->connect_established();
+        conn->input_buffer()->append("unread");
+        assert(pool.stats().cached_blocks == cached - 1);
+        conn->connect_destroyed();
+        assert(pool.stats().cached_blocks == cached);
+        ::close(sv[1]);
+    }
+
+    // drained buffers go back with a release threshold
+    for (size_t threshold : {TcpConnection::kKeepBuffers, size_t(0)})
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+        auto conn = make_shared<TcpConnection>(&loop, "pair", sv[0], InetAddress(), InetAddress());
+        conn->set_buffer_release_threshold(threshold);
+        conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+        conn->set_message_callback([&] (const TcpConnectionPtr &c, Buffer *buf) {
+            c->send(buf);
+            loop.quit();
+        });
+        conn->connect_established();
+        assert(conn->input_buffer()->internal_capacity() == 0);
+        assert(::write(sv[1], "ping", 4) == 4);
+        loop.loop();
+        char reply[4];
+        assert(::read(sv[1], reply, sizeof reply) == 4);
+        size_t held = conn->input_buffer()->internal_capacity();
+        assert(threshold == 0 ? held == 0 : held > 0);
+        conn->connect_destroyed();
+        ::close(sv[1]);
+    }
+
+    // the thread pool prefaults every io loop and merges the stats
+    {
+        EventLoopThreadPool threads(&loop, 3);
+        threads.set_buffer_prefault(100);
+        threads.start();
+        BufferPoolStats stats = threads.buffer_pool_stats();
+        assert(stats.cached_blocks == pool.stats().cached_blocks + 300);
+        for (EventLoop *io_loop : threads.get_all_loops())
+        {
+            assert(io_loop->buffer_pool().stats().cached_bytes == 100 * 1280);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <cassert>
+#include <algorithm>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/bytescan.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+// few distinct bytes, so matches and near misses are frequent
+string random_text(mt19937 &rng, size_t len)
+{
+    static const char kAlphabet[] = "ab\r\n:;";
+    uniform_int_distribution<int> pick(0, sizeof(kAlphabet) - 2);
+    string s(len, '\0');
+    for (auto &c : s)
+    {
+        c = kAlphabet[pick(rng)];
+    }
+    return s;
+}
+
+const char *reference_find(const string &text, size_t from, const string &delim)
+{
+    auto it = search(text.begin() + from, text.end(), delim.begin(), delim.end());
+    return it == text.end() && !delim.empty() ? nullptr : text.data() + (it - text.begin());
+}
+
+void check_level(scan::Level level)
+{
+    scan::set_level(level);
+    mt19937 rng(static_cast<unsigned>(level) + 1);
+    for (int round = 0; round < 2000; ++round)
+    {
+        string text = random_text(rng, rng() % 300);
+        size_t from = text.empty() ? 0 : rng() % (text.size() + 1);
+        const char *begin = text.data() + from;
+        const char *end = text.data() + text.size();
+
+        assert(scan::find_crlf(begin, end) == reference_find(text, from, "\r\n"));
+        assert(scan::find_byte(begin, end, '\n') == reference_find(text, from, "\n"));
+        assert(scan::find_byte(begin, end, 'z') == nullptr);
+
+        string delim = random_text(rng, rng() % 20);
+        assert(scan::find_delimiter(begin, end, delim.data(), delim.size())
+               == reference_find(text, from, delim));
+        // a delimiter that is certainly there, at the very end
+        if (text.size() - from >= delim.size())
+        {
+            string tail = text.substr(text.size() - delim.size());
+            assert(scan::find_delimiter(begin, end, tail.data(), tail.size())
+                   == reference_find(text, from, tail));
+        }
+
+        string set = random_text(rng, rng() % 20);
+        vector<size_t> offsets;
+        vector<size_t> expected;
+        for (size_t i = from; i < text.size(); ++i)
+        {
+            if (set.find(text[i]) != string::npos)
+            {
+                expected.push_back(100 + i - from);
+            }
+        }
+        assert(scan::find_all_of(begin, end, set.data(), set.size(), 100, &offsets) == expected.size());
+        assert(offsets == expected);
+    }
+}
+} // namespace
+
+int main()
+{
+    scan::Level best = scan::best_level();
+    for (auto level : {scan::Level::kScalar, scan::Level::kSse2, scan::Level::kAvx2})
+    {
+        if (level <= best)
+        {
+            check_level(level);
+            assert(scan::level() == level);
+        }
+    }
+    assert(scan::set_level(scan::Level::kAvx2) == best);
+
+    // the Buffer finds, contiguous and across slabs
+    {
+        Buffer buf;
+        string request = "GET / HTTP/1.1\r\nHost: x\r\n\r\nbody";
+        buf.append(request);
+        assert(buf.findCRLF() == buf.peek() + 14);
+        assert(buf.findCRLF(buf.peek() + 15) == buf.peek() + 23);
+        assert(buf.find("\r\n\r\n") == buf.peek() + 23);
+        assert(buf.find(buf.peek() + 24, "\r\n\r\n") == nullptr);
+        assert(buf.findEOL() == buf.peek() + 15);
+
+        Buffer segmented;
+        segmented.set_slab_size(256);
+        string lines;
+        for (int i = 0; i < 100; ++i)
+        {
+            lines += "line " + to_string(i) + "\n";
+        }
+        segmented.append(lines);
+        assert(segmented.slab_count() > 1);
+        vector<size_t> offsets;
+        assert(segmented.find_all_of("\n", &offsets) == 100);
+        for (size_t i = 0, at = 0; i < offsets.size(); ++i, ++at)
+        {
+            at = lines.find('\n', at);
+            assert(offsets[i] == at);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/computepool.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    EventLoop loop;
+    ComputePool pool(4);
+
+    int sv[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+    auto conn = make_shared<TcpConnection>(&loop, "pair", sv[0], InetAddress(), InetAddress());
+
+    // work of one connection runs in parallel, completions still run in order
+    const int kTasks = 2000;
+    vector<int> order;
+    atomic<int> running(0);
+    int max_running = 0;
+    for (int i = 0; i < kTasks; ++i)
+    {
+        pool.submit(conn, [&, i] () -> ComputePool::Completion {
+            int now = running.fetch_add(1) + 1;
+            auto until = chrono::steady_clock::now() + chrono::microseconds((i * 7919) % 50);
+            while (chrono::steady_clock::now() < until)
+            {
+            }
+            running.fetch_sub(1);
+            if (i % 3 == 0)
+            {
+                // nothing to do in the loop
+                return nullptr;
+            }
+            return [&, i, now] {
+                max_running = max(max_running, now);
+                order.push_back(i);
+            };
+        });
+    }
+
+    // unordered submissions from the loop complete in the loop
+    atomic<int> unordered(0);
+    bool in_loop = true;
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.submit(&loop, [&] () -> ComputePool::Completion {
+            return [&] {
+                in_loop = in_loop && loop.is_in_loop_thread();
+                ++unordered;
+            };
+        });
+    }
+
+    loop.run_every(chrono::milliseconds(5), [&] {
+        if (order.size() == static_cast<size_t>(kTasks - (kTasks + 2) / 3) && unordered == 100)
+        {
+            loop.quit();
+        }
+    });
+    loop.run_after(chrono::seconds(20), [] { assert(false); });
+    loop.loop();
+
+    for (size_t k = 1; k < order.size(); ++k)
+    {
+        assert(order[k - 1] < order[k]);
+    }
+    assert(in_loop);
+
+    conn.reset();
+    ::close(sv[1]);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <string>
+#include <memory>
+#include <vector>
+#include <cerrno>
+#include <cassert>
+#include <unistd.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/connectiongroup.hpp"
+#include "socketpair.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+// what arrived so far, the peers are non-blocking
+string received(int fd)
+{
+    char buf[4096];
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    assert(n > 0 || errno == EAGAIN);
+    return n > 0 ? string(buf, n) : string();
+}
+} // namespace
+
+int main()
+{
+    const int kLoops = 2;
+    const int kPerLoop = 3;
+    vector<unique_ptr<EventLoopThread>> threads;
+    vector<EventLoop *> loops;
+    for (int i = 0; i < kLoops; ++i)
+    {
+        threads.push_back(make_unique<EventLoopThread>());
+        loops.push_back(threads.back()->start_loop());
+    }
+
+    vector<TcpConnectionPtr> conns;
+    vector<int> peers;
+    for (int i = 0; i < kLoops * kPerLoop; ++i)
+    {
+        EventLoop *loop = loops[i % kLoops];
+        in_loop(loop, [&] {
+            int peer;
+            conns.push_back(connected_pair(loop, &peer));
+            peers.push_back(peer);
+        });
+    }
+    auto settle = [&] {
+        for (auto loop : loops)
+        {
+            in_loop(loop, [] {});
+        }
+    };
+
+    ConnectionGroup group;
+    for (auto &conn : conns)
+    {
+        group.add(conn);
+        // twice is once
+        group.add(conn);
+    }
+    settle();
+    assert(group.size() == conns.size());
+
+    // every member gets it, from outside and from inside a loop
+    group.broadcast("tick");
+    in_loop(loops[0], [&] {
+        group.broadcast(make_shared<const string>("tock"));
+    });
+    settle();
+    for (int fd : peers)
+    {
+        assert(received(fd) == "ticktock");
+    }
+
+    // removed members get nothing
+    group.remove(conns[0]);
+    group.broadcast("after remove");
+    settle();
+    assert(group.size() == conns.size() - 1);
+    assert(received(peers[0]).empty());
+    for (size_t i = 1; i < peers.size(); ++i)
+    {
+        assert(received(peers[i]) == "after remove");
+    }
+
+    // a member over its high water mark misses messages until it drains
+    size_t crossed_at = 0;
+    in_loop(conns[1]->get_loop(), [&] {
+        conns[1]->set_high_water_mark_callback([&] (const TcpConnectionPtr &, size_t queued) {
+            crossed_at = queued;
+        }, 64 * 1024);
+        conns[1]->send(string(1 << 20, 'x'));
+        assert(conns[1]->over_high_water_mark());
+    });
+    group.broadcast("skip me");
+    settle();
+    assert(group.skipped() == 1);
+    assert(crossed_at >= 64 * 1024);
+    assert(received(peers[2]) == "skip me");
+
+    // closed members leave on the next broadcast
+    in_loop(conns[2]->get_loop(), [&] {
+        conns[2]->connect_destroyed();
+    });
+    group.broadcast("closed");
+    settle();
+    assert(group.size() == conns.size() - 2);
+    assert(received(peers[2]).empty());
+    assert(received(peers[3]) == "skip meclosed");
+
+    // the group does not keep a connection alive, gone before the next
+    //  broadcast is pruned all the same
+    weak_ptr<TcpConnection> gone;
+    int gone_peer;
+    in_loop(loops[0], [&] {
+        auto conn = connected_pair(loops[0], &gone_peer);
+        group.add(conn);
+        gone = conn;
+        conn->connect_destroyed();
+    });
+    assert(gone.expired());
+    assert(group.size() == conns.size() - 1);
+    group.broadcast("gone");
+    settle();
+    assert(group.size() == conns.size() - 2);
+    ::close(gone_peer);
+
+    for (auto &conn : conns)
+    {
+        group.remove(conn);
+        in_loop(conn->get_loop(), [&] {
+            if (conn->connected())
+            {
+                conn->connect_destroyed();
+            }
+        });
+    }
+    assert(group.size() == 0);
+    conns.clear();
+    for (int fd : peers)
+    {
+        ::close(fd);
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "../icarus/task.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+// echo_server.cpp written as a coroutine per connection
+class EchoServer
+{
+  public:
+    EchoServer(EventLoop* loop, const InetAddress& listen_addr)
+      : server_(loop, listen_addr, "coroutine echo server")
+    {
+        server_.set_connection_callback([] (const TcpConnectionPtr& conn) {
+            if (conn->connected())
+            {
+                spawn(echo(conn));
+            }
+        });
+    }
+
+    void start()
+    {
+        server_.start();
+    }
+
+  private:
+    static Task<> echo(TcpConnectionPtr conn)
+    {
+        while (true)
+        {
+            size_t readable = co_await conn->read_some();
+            if (readable == 0)
+            {
+                break;
+            }
+            co_await conn->write(conn->input_buffer());
+        }
+    }
+
+    TcpServer server_;
+};
+
+int main()
+{
+    EventLoop loop;
+    InetAddress listen_addr(6666);
+    EchoServer echo_server(&loop, listen_addr);
+
+    echo_server.start();
+    loop.loop();
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+
+#include "../icarus/task.hpp"
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpclient.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+const uint16_t kPort = 9882;
+// nothing listens here, connects are refused
+const uint16_t kClosedPort = 9884;
+
+Task<int> add(int a, int b)
+{
+    co_return a + b;
+}
+
+Task<int> sum(int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        int value = co_await add(i, 1);
+        total += value;
+    }
+    co_return total;
+}
+
+Task<> fail()
+{
+    throw runtime_error("fail");
+    co_return;
+}
+
+// length prefixed echo: 4 byte size, then the payload
+Task<> echo(TcpConnectionPtr conn)
+{
+    while (true)
+    {
+        size_t header = co_await conn->read_exactly(4);
+        if (header == 0)
+        {
+            break;
+        }
+        size_t len = static_cast<size_t>(conn->input_buffer()->read_int32());
+        size_t body = co_await conn->read_exactly(len);
+        if (body == 0)
+        {
+            break;
+        }
+        string payload = conn->input_buffer()->retrieve_as_string(len);
+        co_await conn->write(payload);
+    }
+}
+
+Task<> client_main(EventLoop *loop, TcpClient *client, int *replies)
+{
+    TcpConnectionPtr conn = co_await client->connect();
+    assert(conn && conn->connected());
+    for (size_t len : { 1, 100, 70000, 3 })
+    {
+        Buffer request;
+        request.append_int32(static_cast<int32_t>(len));
+        request.append(string(len, 'a' + len % 26));
+        bool drained = co_await conn->write(&request);
+        assert(drained);
+        size_t readable = co_await conn->read_exactly(len);
+        assert(readable == len);
+        string reply = conn->input_buffer()->retrieve_as_string(len);
+        assert(reply == string(len, 'a' + len % 26));
+        ++*replies;
+    }
+    conn->shutdown();
+    // the server closes its side in turn
+    size_t readable = co_await conn->read_some();
+    assert(readable == 0);
+    loop->quit();
+}
+
+// only touches its own state once resumed, the client may be gone
+Task<> await_connect(TcpClient *client, bool *resumed, TcpConnectionPtr *result)
+{
+    TcpConnectionPtr conn = co_await client->connect();
+    *result = conn;
+    *resumed = true;
+}
+
+void run_for(EventLoop *loop, chrono::milliseconds duration)
+{
+    loop->run_after(duration, [loop] { loop->quit(); });
+    loop->loop();
+}
+} // namespace
+
+int main()
+{
+    EventLoop loop;
+
+    // values and exceptions travel up the chain, frames are recycled
+    int result = 0;
+    bool caught = false;
+    spawn([] (int *result, bool *caught) -> Task<> {
+        *result = co_await sum(100);
+        try
+        {
+            co_await fail();
+        }
+        catch (const runtime_error &)
+        {
+            *caught = true;
+        }
+    }(&result, &caught));
+    assert(result == 5050);
+    assert(caught);
+    assert(loop.frame_pool().stats().hits >= 98);
+
+    // sleep_for resumes from the timer
+    auto start = chrono::steady_clock::now();
+    bool slept = false;
+    spawn([] (EventLoop *loop, bool *slept) -> Task<> {
+        co_await loop->sleep_for(chrono::milliseconds(20));
+        *slept = true;
+        loop->quit();
+    }(&loop, &slept));
+    assert(!slept);
+    loop.loop();
+    assert(slept);
+    assert(chrono::steady_clock::now() - start >= chrono::milliseconds(20));
+
+    // echo server and client written as coroutines
+    TcpServer server(&loop, InetAddress(kPort, true), "coroutine");
+    server.set_connection_callback([] (const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            spawn(echo(conn));
+        }
+    });
+    server.start();
+
+    TcpClient client(&loop, InetAddress(kPort, true), "client");
+    int replies = 0;
+    spawn(client_main(&loop, &client, &replies));
+    loop.run_after(chrono::seconds(10), [] { assert(false); });
+    loop.loop();
+    assert(replies == 4);
+
+    // a refused connect with retry off resumes with no connection
+    {
+        TcpClient refused(&loop, InetAddress(kClosedPort, true), "refused");
+        bool resumed = false;
+        TcpConnectionPtr conn;
+        spawn(await_connect(&refused, &resumed, &conn));
+        run_for(&loop, chrono::milliseconds(50));
+        assert(resumed && !conn);
+    }
+
+    // with retry on it keeps trying until stop()
+    {
+        TcpClient retrying(&loop, InetAddress(kClosedPort, true), "retrying");
+        retrying.enable_retry();
+        bool resumed = false;
+        TcpConnectionPtr conn;
+        spawn(await_connect(&retrying, &resumed, &conn));
+        run_for(&loop, chrono::milliseconds(20));
+        assert(!resumed);
+        retrying.stop();
+        assert(resumed && !conn);
+        run_for(&loop, chrono::milliseconds(20));
+    }
+
+    // disconnect() before the connection is up gives up as well
+    {
+        TcpClient retrying(&loop, InetAddress(kClosedPort, true), "retrying");
+        retrying.enable_retry();
+        bool resumed = false;
+        TcpConnectionPtr conn;
+        spawn(await_connect(&retrying, &resumed, &conn));
+        run_for(&loop, chrono::milliseconds(20));
+        assert(!resumed);
+        retrying.disconnect();
+        assert(resumed && !conn);
+        run_for(&loop, chrono::milliseconds(20));
+    }
+
+    // the client destroyed while connecting, the attempts still queued
+    //  in the loop outlive it
+    {
+        auto retrying = make_unique<TcpClient>(&loop, InetAddress(kClosedPort, true), "retrying");
+        retrying->enable_retry();
+        bool resumed = false;
+        TcpConnectionPtr conn;
+        spawn(await_connect(retrying.get(), &resumed, &conn));
+        run_for(&loop, chrono::milliseconds(20));
+        assert(!resumed);
+        retrying.reset();
+        assert(resumed && !conn);
+        run_for(&loop, chrono::milliseconds(20));
+    }
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <string>
+#include <memory>
+#include <thread>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+const size_t kBudget = TcpConnection::kEdgeTriggeredBudget;
+
+// send buffers well beyond the budget, so one wakeup finds more than
+//  it may handle. SO_SNDBUFFORCE needs CAP_NET_ADMIN, SO_SNDBUF is
+//  capped by net.core.wmem_max
+void grow_send_buffer(int fd)
+{
+    int size = 4 * 1024 * 1024;
+    if (::setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &size, sizeof size) < 0)
+    {
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof size);
+    }
+}
+
+void set_blocking(int fd)
+{
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+}
+
+size_t fill(int fd)
+{
+    string chunk(64 * 1024, 'e');
+    size_t total = 0;
+    ssize_t n;
+    while ((n = ::write(fd, chunk.data(), chunk.size())) > 0)
+    {
+        total += n;
+    }
+    return total;
+}
+
+void drain(int fd, size_t len)
+{
+    char sink[64 * 1024];
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, sink, min(len, sizeof sink));
+        assert(n > 0);
+        len -= n;
+    }
+}
+
+TcpConnectionPtr edge_triggered_pair(EventLoop *loop, int sv[2])
+{
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+    grow_send_buffer(sv[0]);
+    grow_send_buffer(sv[1]);
+    auto conn = make_shared<TcpConnection>(loop, "edge", sv[0], InetAddress(), InetAddress());
+    conn->set_connection_callback([] (const TcpConnectionPtr &) {});
+    conn->set_edge_triggered(true);
+    return conn;
+}
+} // namespace
+
+int main()
+{
+    // EPOLLET only exists with epoll
+    EventLoop loop(PollerBackend::kEpoll);
+
+    // more than the budget waiting on the read side, what the wakeup
+    //  leaves unread is read by the queued continuation, no new edge
+    {
+        int sv[2];
+        auto conn = edge_triggered_pair(&loop, sv);
+        size_t pending = fill(sv[1]);
+        size_t received = 0;
+        conn->set_message_callback([&] (const TcpConnectionPtr &, Buffer *buf) {
+            received += buf->readable_bytes();
+            buf->retrieve_all();
+            if (received == pending)
+            {
+                loop.quit();
+            }
+        });
+        conn->connect_established();
+
+        uint64_t events = loop.poller_stats().events;
+        loop.loop();
+        assert(received == pending);
+        if (pending > kBudget)
+        {
+            assert(loop.poller_stats().events - events == 1);
+        }
+        conn->connect_destroyed();
+        ::close(sv[1]);
+    }
+
+    // a send larger than the budget, once the socket drains the one
+    //  EPOLLOUT wakeup writes up to the budget and the continuation
+    //  writes the rest
+    {
+        int sv[2];
+        auto conn = edge_triggered_pair(&loop, sv);
+        bool completed = false;
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) {
+            completed = true;
+            loop.quit();
+        });
+        conn->connect_established();
+
+        // the socket takes what fits, the rest is buffered, the payloads
+        //  queued behind it are written one by one
+        size_t sent = 12 * 1024 * 1024;
+        conn->send(string(sent, 'w'));
+        auto payload = make_shared<const string>(512 * 1024, 'p');
+        for (int i = 0; i < 4; ++i)
+        {
+            conn->send(payload);
+            sent += payload->size();
+        }
+        size_t written = sent - conn->queued_output_bytes();
+        size_t queued = conn->queued_output_bytes();
+        assert(queued > 0);
+
+        set_blocking(sv[1]);
+        drain(sv[1], written);
+        // the drained socket takes everything left unless its buffer is
+        //  small, then a reader has to make room while the loop runs
+        bool fits = queued <= written;
+        thread reader;
+        if (!fits)
+        {
+            reader = thread([&] { drain(sv[1], queued); });
+        }
+        uint64_t events = loop.poller_stats().events;
+        loop.loop();
+        assert(completed);
+        assert(conn->queued_output_bytes() == 0);
+        if (fits)
+        {
+            drain(sv[1], queued);
+            if (written > kBudget && queued > kBudget)
+            {
+                assert(loop.poller_stats().events - events == 1);
+            }
+        }
+        else
+        {
+            reader.join();
+        }
+        conn->connect_destroyed();
+        ::close(sv[1]);
+    }
+
+    return 0;
+}
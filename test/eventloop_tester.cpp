@@ -0,0 +1,83 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthread.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    EventLoopThread loop_thread;
+    EventLoop *loop = loop_thread.start_loop();
+
+    // many producers, every functor runs exactly once and in order per producer
+    const int kProducers = 8;
+    const int kFunctors = 100000;
+    vector<int> last(kProducers, -1);
+    atomic<int> done(0);
+    bool in_order = true;
+
+    vector<thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kFunctors; ++i)
+            {
+                loop->queue_in_loop([&, p, i] {
+                    in_order = in_order && last[p] == i - 1;
+                    last[p] = i;
+                    done.fetch_add(1, memory_order_relaxed);
+                });
+                (void) loop->queue_size();
+            }
+        });
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+    while (done.load() != kProducers * kFunctors)
+    {
+        this_thread::yield();
+    }
+    assert(in_order);
+
+    // a functor queued by a functor still runs without any other wakeup
+    atomic<bool> nested(false);
+    loop->run_in_loop([&] {
+        loop->queue_in_loop([&] { nested = true; });
+    });
+    while (!nested)
+    {
+        this_thread::yield();
+    }
+
+    while (loop->queue_size() != 0)
+    {
+        this_thread::yield();
+    }
+
+    // a loop switching between spinning and blocking loses no wakeup,
+    //  a lost one would only be noticed after the 10s poll timeout
+    EventLoopThread spin_thread([] (EventLoop *l) {
+        l->set_busy_poll(BusyPollMode::kAdaptive, chrono::microseconds(200));
+    });
+    EventLoop *spin_loop = spin_thread.start_loop();
+    atomic<int> seen(0);
+    for (int i = 1; i <= 2000; ++i)
+    {
+        spin_loop->queue_in_loop([&seen] { seen.fetch_add(1); });
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        while (seen.load() != i)
+        {
+            assert(chrono::steady_clock::now() < deadline);
+            this_thread::yield();
+        }
+        this_thread::sleep_for(chrono::microseconds(i % 400));
+    }
+}
@@ -0,0 +1,288 @@
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthreadpool.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+const uint16_t kPort = 9878;
+const int kLoops = 3;
+
+int connect_client()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd >= 0);
+    int ret = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+    assert(ret == 0);
+    (void) ret;
+    return fd;
+}
+
+size_t connections_of(const vector<EventLoop *> &loops)
+{
+    size_t total = 0;
+    for (auto loop : loops)
+    {
+        total += loop->connection_count();
+    }
+    return total;
+}
+
+// runs the loop until done() holds, at most for a few seconds
+template <typename F>
+bool run_until(EventLoop *loop, F done)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    auto timer = loop->run_every(chrono::milliseconds(5), [&] {
+        if (done() || chrono::steady_clock::now() > deadline)
+        {
+            loop->quit();
+        }
+    });
+    loop->loop();
+    loop->cancel(timer);
+    return done();
+}
+} // namespace
+
+int main()
+{
+    EventLoop base_loop;
+
+    // kRoundRobin by default, the loops in turn
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.start();
+        auto loops = pool.get_all_loops();
+        for (int i = 0; i < 2 * kLoops; ++i)
+        {
+            assert(pool.get_next_loop() == loops[i % kLoops]);
+        }
+    }
+
+    // no io loops, everything runs in the base loop
+    {
+        EventLoopThreadPool pool(&base_loop, 0);
+        pool.set_loop_selection(LoopSelection::kLeastConnections);
+        pool.start();
+        assert(pool.get_next_loop() == &base_loop);
+    }
+
+    // kLeastConnections takes the emptiest loop, ties go round-robin
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.set_loop_selection(LoopSelection::kLeastConnections);
+        pool.start();
+        auto loops = pool.get_all_loops();
+        for (int i = 0; i < kLoops; ++i)
+        {
+            assert(pool.get_next_loop() == loops[i]);
+        }
+
+        loops[0]->connection_opened();
+        loops[0]->connection_opened();
+        loops[2]->connection_opened();
+        for (int i = 0; i < kLoops; ++i)
+        {
+            assert(pool.get_next_loop() == loops[1]);
+        }
+        loops[1]->connection_opened();
+        loops[1]->connection_opened();
+        assert(pool.get_next_loop() == loops[2]);
+
+        loops[0]->connection_closed();
+        loops[0]->connection_closed();
+        loops[1]->connection_closed();
+        loops[1]->connection_closed();
+        loops[2]->connection_closed();
+        assert(connections_of(loops) == 0);
+    }
+
+    // kLeastPendingWork stays away from a loop with a long queue
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.set_loop_selection(LoopSelection::kLeastPendingWork);
+        pool.start();
+        auto loops = pool.get_all_loops();
+
+        promise<void> release;
+        auto released = release.get_future().share();
+        loops[0]->queue_in_loop([released] { released.wait(); });
+        for (int i = 0; i < 1000; ++i)
+        {
+            loops[0]->queue_in_loop([] {});
+        }
+        assert(loops[0]->queue_size() >= 1000);
+
+        set<EventLoop *> chosen;
+        for (int i = 0; i < 2 * kLoops; ++i)
+        {
+            chosen.insert(pool.get_next_loop());
+        }
+        release.set_value();
+        assert(chosen.count(loops[0]) == 0);
+        assert(!chosen.empty());
+    }
+
+    // kPowerOfTwoChoices never takes a loaded loop while the other one of
+    //  the pair is empty, and over many picks uses every empty loop
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.set_loop_selection(LoopSelection::kPowerOfTwoChoices);
+        pool.start();
+        auto loops = pool.get_all_loops();
+        for (int i = 0; i < 5; ++i)
+        {
+            loops[0]->connection_opened();
+        }
+
+        set<EventLoop *> chosen;
+        for (int i = 0; i < 100; ++i)
+        {
+            chosen.insert(pool.get_next_loop());
+        }
+        assert((chosen == set<EventLoop *>{loops[1], loops[2]}));
+
+        for (int i = 0; i < 5; ++i)
+        {
+            loops[0]->connection_closed();
+        }
+        assert(connections_of(loops) == 0);
+    }
+
+    // kConsistentHash keeps a peer ip on one loop whatever its port, and
+    //  spreads many ips over every loop
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.set_loop_selection(LoopSelection::kConsistentHash);
+        pool.start();
+
+        EventLoop *first = pool.get_next_loop(InetAddress("10.0.0.7", 1000));
+        for (uint16_t port = 1001; port < 1100; ++port)
+        {
+            assert(pool.get_next_loop(InetAddress("10.0.0.7", port)) == first);
+        }
+
+        set<EventLoop *> chosen;
+        for (int i = 1; i < 255; ++i)
+        {
+            string ip = "10.0.1." + to_string(i);
+            chosen.insert(pool.get_next_loop(InetAddress(ip.c_str(), 80)));
+        }
+        assert(chosen.size() == static_cast<size_t>(kLoops));
+    }
+
+    // a custom selector replaces the built-in policy and sees the peer
+    {
+        EventLoopThreadPool pool(&base_loop, kLoops);
+        pool.set_loop_selection(LoopSelection::kLeastConnections);
+        InetAddress seen;
+        pool.set_loop_selector([&] (const vector<EventLoop *> &loops, const InetAddress &peer_addr) {
+            seen = peer_addr;
+            return loops.back();
+        });
+        pool.start();
+        auto loops = pool.get_all_loops();
+        loops[2]->connection_opened();
+        assert(pool.get_next_loop(InetAddress("10.0.0.9", 4242)) == loops[2]);
+        assert(seen.to_ip_port() == "10.0.0.9:4242");
+        loops[2]->connection_closed();
+    }
+
+    // the server's connections count while they live and the counts go
+    //  back to zero however they close
+    {
+        TcpServer server(&base_loop, InetAddress(kPort, true), "selection");
+        server.set_thread_num(kLoops);
+        server.set_loop_selection(LoopSelection::kLeastConnections);
+        mutex mutex;
+        vector<TcpConnectionPtr> accepted;
+        server.set_connection_callback([&] (const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                lock_guard<std::mutex> lock(mutex);
+                accepted.push_back(conn);
+            }
+        });
+        server.start();
+
+        vector<int> clients;
+        for (int i = 0; i < 2 * kLoops; ++i)
+        {
+            clients.push_back(connect_client());
+        }
+        auto all_accepted = [&] {
+            lock_guard<std::mutex> lock(mutex);
+            return accepted.size() == clients.size();
+        };
+        bool done = run_until(&base_loop, all_accepted);
+        assert(done);
+
+        vector<EventLoop *> loops;
+        {
+            lock_guard<std::mutex> lock(mutex);
+            for (auto &conn : accepted)
+            {
+                if (find(loops.begin(), loops.end(), conn->get_loop()) == loops.end())
+                {
+                    loops.push_back(conn->get_loop());
+                }
+            }
+        }
+        assert(loops.size() == static_cast<size_t>(kLoops));
+        assert(connections_of(loops) == clients.size());
+        for (auto loop : loops)
+        {
+            assert(loop->connection_count() == 2);
+        }
+        assert(base_loop.connection_count() == 0);
+
+        // half closed by the clients, half by the server
+        size_t half = clients.size() / 2;
+        for (size_t i = 0; i < half; ++i)
+        {
+            ::close(clients[i]);
+        }
+        done = run_until(&base_loop, [&] { return connections_of(loops) == clients.size() - half; });
+        assert(done);
+        {
+            lock_guard<std::mutex> lock(mutex);
+            for (auto &conn : accepted)
+            {
+                if (conn->connected())
+                {
+                    conn->force_close();
+                }
+            }
+            accepted.clear();
+        }
+        done = run_until(&base_loop, [&] { return connections_of(loops) == 0; });
+        assert(done);
+        for (size_t i = half; i < clients.size(); ++i)
+        {
+            ::close(clients[i]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/loopmetrics.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    Histogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v)
+    {
+        histogram.record(v);
+    }
+    histogram.record(0);
+
+    auto snapshot = histogram.snapshot();
+    assert(snapshot.count == 1001);
+    assert(snapshot.sum == 500500);
+    assert(snapshot.max == 1000);
+    assert(snapshot.buckets[0] == 1);
+    assert(snapshot.buckets[1] == 1);   // 1
+    assert(snapshot.buckets[10] == 489); // 512..1000
+    assert(snapshot.percentile(0.5) == 511);
+    assert(snapshot.percentile(1.0) == 1000);
+
+    HistogramSnapshot merged;
+    merged.merge(snapshot);
+    merged.merge(snapshot);
+    assert(merged.count == 2002 && merged.max == 1000);
+    assert(merged.mean() == snapshot.mean());
+
+    // a loop only has metrics when icarus is built with ICARUS_METRICS
+    EventLoop loop;
+    std::thread([&] {
+        loop.queue_in_loop([] {});
+        loop.queue_in_loop([&] { loop.quit(); });
+    }).join();
+    loop.loop();
+
+    auto metrics = loop.metrics();
+    if (loop.metrics_enabled())
+    {
+        assert(metrics.loops == 1);
+        assert(metrics.iteration_ns.count > 0);
+        assert(metrics.iteration_ns.count == metrics.poll_wait_ns.count);
+        assert(metrics.queue_depth.max == 2);
+        assert(metrics.wakeups >= 1);
+    }
+    else
+    {
+        assert(metrics.loops == 0 && metrics.iteration_ns.count == 0);
+    }
+
+    return 0;
+}
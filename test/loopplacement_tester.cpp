@@ -0,0 +1,59 @@
+#include <vector>
+#include <cassert>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/eventloopthreadpool.hpp"
+#include "../icarus/loopplacement.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    auto cpus = LoopPlacement::available_cpus();
+    assert(!cpus.empty());
+
+    assert((LoopPlacement().assign(3) == vector<int>{ -1, -1, -1 }));
+    assert((LoopPlacement::cpu_list({ 2, 5 }).assign(3) == vector<int>{ 2, 5, 2 }));
+
+    // every available cpu gets a loop before any gets a second one
+    for (auto placement : { LoopPlacement::physical_cores(), LoopPlacement::numa_packed() })
+    {
+        auto assigned = placement.assign(static_cast<int>(cpus.size()) * 2);
+        for (size_t i = 0; i < cpus.size(); ++i)
+        {
+            assert(assigned[i] == assigned[i + cpus.size()]);
+            for (size_t j = 0; j < i; ++j)
+            {
+                assert(assigned[i] != assigned[j]);
+            }
+        }
+    }
+
+    EventLoop base_loop;
+    EventLoopThreadPool pool(&base_loop, 2);
+    pool.set_placement(LoopPlacement::cpu_list({ cpus.back().cpu }));
+    pool.start();
+    for (auto loop : pool.get_all_loops())
+    {
+        assert(loop->cpu() == cpus.back().cpu);
+        assert(loop->numa_node() == cpus.back().node);
+    }
+
+    // a cpu outside the affinity mask cannot be pinned to, the loop still runs
+    {
+        EventLoopThread pinned(EventLoopThread::ThreadInitCallback(), kDefaultPollerBackend,
+                               cpus.back().cpu);
+        EventLoop *loop = pinned.start_loop();
+        assert(pinned.pinned());
+        assert(loop->cpu() == cpus.back().cpu);
+
+        EventLoopThread unpinnable(EventLoopThread::ThreadInitCallback(), kDefaultPollerBackend,
+                                   cpus.back().cpu + 4096);
+        loop = unpinnable.start_loop();
+        assert(loop && !unpinnable.pinned());
+    }
+
+    return 0;
+}
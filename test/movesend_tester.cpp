@@ -0,0 +1,122 @@
+#include <string>
+#include <thread>
+#include <memory>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../icarus/buffer.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "socketpair.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+string pattern(size_t len, char first)
+{
+    string s(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = static_cast<char>(first + i % 23);
+    }
+    return s;
+}
+} // namespace
+
+int main()
+{
+    EventLoop loop;
+
+    // larger than the socket buffer, the tail of the string is queued
+    //  without a copy, the buffer's storage swapped in
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+
+        string big = pattern(1 << 20, 'a');
+        conn->send(string(big));
+        size_t queued = conn->queued_output_bytes();
+        assert(queued > 0 && queued < big.size());
+
+        Buffer buf;
+        string middle = pattern(100000, 'A');
+        buf.append(middle);
+        conn->send(std::move(buf));
+        assert(conn->queued_output_bytes() == queued + middle.size());
+
+        conn->send(string("small"));
+        // queued as it is behind the buffered bytes
+        Buffer large;
+        string large_bytes = pattern(40000, '0');
+        large.append(large_bytes);
+        conn->send(std::move(large));
+        Buffer last;
+        last.append("last");
+        conn->send(&last);
+        assert(last.readable_bytes() == 0);
+
+        string expected = big + middle + "small" + large_bytes + "last";
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        string received;
+        thread reader([&] {
+            received = read_exactly(peer, expected.size());
+            loop.quit();
+        });
+        loop.loop();
+        reader.join();
+        assert(received == expected);
+        assert(conn->queued_output_bytes() == 0);
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // from another thread everything is moved through the queue in order
+    {
+        EventLoopThread io_thread;
+        EventLoop *io_loop = io_thread.start_loop();
+        TcpConnectionPtr conn;
+        int peer;
+        in_loop(io_loop, [&] {
+            conn = connected_pair(io_loop, &peer);
+        });
+
+        string expected;
+        for (int i = 0; i < 50; ++i)
+        {
+            string s = pattern(1000 * i + 1, 'a');
+            expected += s;
+            conn->send(std::move(s));
+
+            Buffer buf;
+            buf.set_slab_size(i % 2 ? 4096 : 0);
+            string b = pattern(1500 * i + 1, 'A');
+            buf.append(b);
+            expected += b;
+            if (i % 3 == 0)
+            {
+                conn->send(&buf);
+                assert(buf.readable_bytes() == 0);
+                assert(buf.slab_size() == (i % 2 ? 4096u : 0u));
+            }
+            else
+            {
+                conn->send(std::move(buf));
+            }
+        }
+
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        assert(read_exactly(peer, expected.size()) == expected);
+        in_loop(io_loop, [&] {
+            assert(conn->queued_output_bytes() == 0);
+            conn->connect_destroyed();
+            conn.reset();
+        });
+        ::close(peer);
+    }
+
+    return 0;
+}
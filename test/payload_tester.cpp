@@ -0,0 +1,93 @@
+#include <string>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "socketpair.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    EventLoop loop;
+
+    // larger than the socket buffer, the unsent rest stays in the payload
+    string bytes(1 << 20, '\0');
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<char>('a' + i % 26);
+    }
+    auto payload = make_shared<const string>(bytes);
+
+    // one payload to several connections, ordered with the other sends
+    {
+        const int kConns = 3;
+        vector<int> peers;
+        vector<TcpConnectionPtr> conns;
+        for (int i = 0; i < kConns; ++i)
+        {
+            int peer;
+            auto conn = connected_pair(&loop, &peer);
+            // the second is queued behind a buffered send
+            if (i == 1)
+            {
+                conn->send(bytes);
+            }
+            conn->send(payload);
+            conn->send("tail");
+            conn->send(payload);
+            conns.push_back(conn);
+            peers.push_back(peer);
+        }
+        // queued by reference, not copied
+        assert(payload.use_count() > kConns);
+
+        vector<string> received(kConns);
+        vector<thread> readers;
+        int done = 0;
+        for (int i = 0; i < kConns; ++i)
+        {
+            ::fcntl(peers[i], F_SETFL, ::fcntl(peers[i], F_GETFL) & ~O_NONBLOCK);
+            size_t len = (i == 1 ? 3 : 2) * bytes.size() + 4;
+            readers.emplace_back([&, i, len] {
+                received[i] = read_exactly(peers[i], len);
+                loop.run_in_loop([&] {
+                    if (++done == kConns)
+                    {
+                        loop.quit();
+                    }
+                });
+            });
+        }
+        loop.loop();
+        for (int i = 0; i < kConns; ++i)
+        {
+            readers[i].join();
+            string expected = (i == 1 ? bytes : "") + bytes + "tail" + bytes;
+            assert(received[i] == expected);
+            conns[i]->connect_destroyed();
+            ::close(peers[i]);
+        }
+        assert(payload.use_count() == 1);
+    }
+
+    // a connection that goes away drops its references
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        conn->send(payload);
+        conn->send(payload);
+        assert(payload.use_count() > 1);
+        conn->connect_destroyed();
+        assert(payload.use_count() == 1);
+        ::close(peer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpserver.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+const uint16_t kPort = 9878;
+const int kLoops = 3;
+// enough that the kernel's hash leaves no listener without one
+const int kClients = 60;
+
+// connected as soon as it returns, one of the listeners' backlogs holds it
+int connect_client()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd >= 0);
+    int ret = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+    assert(ret == 0);
+    (void) ret;
+    return fd;
+}
+
+// runs the loop until done() holds, at most for a few seconds
+template <typename F>
+bool run_until(EventLoop *loop, F done)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    auto timer = loop->run_every(chrono::milliseconds(5), [&] {
+        if (done() || chrono::steady_clock::now() > deadline)
+        {
+            loop->quit();
+        }
+    });
+    loop->loop();
+    loop->cancel(timer);
+    return done();
+}
+
+// a loop acceptor names its connections "...#<loop index>.<id>", the
+//  base acceptor "...#<id>"
+int acceptor_index(const string &name)
+{
+    auto hash = name.rfind('#');
+    auto dot = name.find('.', hash);
+    assert(hash != string::npos);
+    return dot == string::npos ? -1 : stoi(name.substr(hash + 1, dot - hash - 1));
+}
+
+struct Accepted
+{
+    EventLoop *loop;
+    int index;
+    bool in_own_loop;
+    weak_ptr<TcpConnection> conn;
+};
+} // namespace
+
+int main()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, InetAddress(kPort, true), "reuseport", TcpServer::kReusePort);
+    server.set_thread_num(kLoops);
+    mutex mutex;
+    vector<Accepted> accepted;
+    server.set_connection_callback([&] (const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            EventLoop *loop = conn->get_loop();
+            lock_guard<std::mutex> lock(mutex);
+            accepted.push_back({loop, acceptor_index(conn->name()), loop->is_in_loop_thread(), conn});
+        }
+    });
+    server.start();
+
+    vector<int> clients;
+    for (int i = 0; i < kClients; ++i)
+    {
+        clients.push_back(connect_client());
+    }
+    auto all_accepted = [&] {
+        lock_guard<std::mutex> lock(mutex);
+        return accepted.size() == clients.size();
+    };
+    bool done = run_until(&base_loop, all_accepted);
+    assert(done);
+
+    // every io loop accepted some, in its own thread, and kept them. the
+    //  base acceptor only holds the port and took none
+    map<int, EventLoop *> loop_of_index;
+    map<EventLoop *, size_t> accepted_by;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        for (auto &entry : accepted)
+        {
+            assert(entry.index >= 0 && entry.index < kLoops);
+            assert(entry.loop != &base_loop);
+            assert(entry.in_own_loop);
+            auto it = loop_of_index.emplace(entry.index, entry.loop).first;
+            assert(it->second == entry.loop);
+            ++accepted_by[entry.loop];
+        }
+    }
+    assert(loop_of_index.size() == static_cast<size_t>(kLoops));
+    assert(accepted_by.size() == static_cast<size_t>(kLoops));
+    for (auto &loop : accepted_by)
+    {
+        assert(loop.first->connection_count() == loop.second);
+    }
+    assert(base_loop.connection_count() == 0);
+
+    // half closed by the clients, the rest by the server. the loops drop
+    //  them from their maps and destroy them
+    size_t half = clients.size() / 2;
+    for (size_t i = 0; i < half; ++i)
+    {
+        ::close(clients[i]);
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        for (auto &entry : accepted)
+        {
+            if (auto conn = entry.conn.lock())
+            {
+                conn->force_close();
+            }
+        }
+    }
+    auto all_destroyed = [&] {
+        lock_guard<std::mutex> lock(mutex);
+        for (auto &entry : accepted)
+        {
+            if (!entry.conn.expired())
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    done = run_until(&base_loop, all_destroyed);
+    assert(done);
+    for (auto &loop : accepted_by)
+    {
+        assert(loop.first->connection_count() == 0);
+    }
+    for (size_t i = half; i < clients.size(); ++i)
+    {
+        ::close(clients[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <memory>
+#include <cstdlib>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "socketpair.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+int temp_file(const string &content)
+{
+    char path[] = "/tmp/sendfile_testerXXXXXX";
+    int fd = ::mkstemp(path);
+    assert(fd >= 0);
+    ::unlink(path);
+    assert(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    return fd;
+}
+
+// polls of the loop while it runs for 100ms, a handful when idle,
+//  thousands when it spins on a writable socket
+uint64_t polls_in_100ms(EventLoop *loop)
+{
+    uint64_t polls = loop->poller_stats().polls;
+    loop->run_after(chrono::milliseconds(100), [loop] { loop->quit(); });
+    loop->loop();
+    return loop->poller_stats().polls - polls;
+}
+} // namespace
+
+int main()
+{
+    EventLoop loop;
+
+    // larger than the socket buffer, so the file and what follows queue up
+    string content(1 << 20, '\0');
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    int file = temp_file(content);
+
+    // sends and files go out in the order they were made
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        int completed = 0;
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) { ++completed; });
+
+        conn->send("head");
+        conn->send_file(file, 3, content.size() - 3);
+        conn->send("middle");
+        conn->send_file(file, 0, 10);
+        conn->send("tail");
+        // the connection keeps its own descriptor
+        int other = ::dup(file);
+        conn->send_file(other, 5, 5);
+        ::close(other);
+
+        string expected = "head" + content.substr(3) + "middle" + content.substr(0, 10)
+                          + "tail" + content.substr(5, 5);
+        // blocking reads on the peer
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        string received;
+        thread reader([&] {
+            received = read_exactly(peer, expected.size());
+            loop.quit();
+        });
+        loop.loop();
+        reader.join();
+        assert(received == expected);
+        assert(completed > 0);
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // a file shorter than promised is cut short, the rest still follows
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) { loop.quit(); });
+        conn->send_file(file, content.size() - 4, 100);
+        conn->send("!");
+        loop.loop();
+        char reply[5];
+        assert(::read(peer, reply, sizeof reply) == 5);
+        assert(string(reply, 5) == content.substr(content.size() - 4) + "!");
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // pipes go through splice
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        int pipefd[2];
+        assert(::pipe(pipefd) == 0);
+        assert(::write(pipefd[1], "from a pipe", 11) == 11);
+        ::close(pipefd[1]);
+
+        bool completed = false;
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) {
+            completed = true;
+            loop.quit();
+        });
+        conn->send_file(pipefd[0], 0, 11);
+        ::close(pipefd[0]);
+        loop.loop();
+        assert(completed);
+        char reply[11];
+        assert(::read(peer, reply, sizeof reply) == 11);
+        assert(string(reply, 11) == "from a pipe");
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // files still queued are closed with the connection
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        // the copies land on the two lowest free descriptors
+        int first = ::dup(file);
+        ::close(first);
+        conn->send_file(file, 0, content.size());
+        conn->send_file(file, 0, content.size());
+        assert(::fcntl(first, F_GETFD) >= 0 && ::fcntl(first + 1, F_GETFD) >= 0);
+        conn->connect_destroyed();
+        assert(::fcntl(first, F_GETFD) < 0 && ::fcntl(first + 1, F_GETFD) < 0);
+        ::close(peer);
+    }
+
+    // a descriptor sendfile cannot read from is closed, not queued
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        int bad = ::eventfd(0, EFD_CLOEXEC);
+        // the copy lands on the lowest free descriptor
+        int copy = ::dup(bad);
+        ::close(copy);
+        conn->send_file(bad, 0, 100);
+        assert(::fcntl(copy, F_GETFD) < 0);
+        assert(conn->queued_output_bytes() == 0);
+        conn->send("after");
+        assert(polls_in_100ms(&loop) < 20);
+        assert(read_exactly(peer, 5) == "after");
+        conn->connect_destroyed();
+        ::close(bad);
+        ::close(peer);
+    }
+
+    // queued behind buffered bytes, it fails once they are out, the
+    //  stream cannot go on without it and the connection is closed
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        bool closed = false;
+        conn->set_close_callback([&] (const TcpConnectionPtr &) {
+            closed = true;
+            loop.quit();
+        });
+        int bad = ::eventfd(0, EFD_CLOEXEC);
+        conn->send(content);
+        int copy = ::dup(bad);
+        ::close(copy);
+        conn->send_file(bad, 0, 100);
+        assert(::fcntl(copy, F_GETFD) >= 0);
+        assert(conn->queued_output_bytes() > 100);
+
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        thread reader([&] {
+            read_exactly(peer, content.size());
+        });
+        loop.loop();
+        reader.join();
+        assert(closed);
+        assert(::fcntl(copy, F_GETFD) < 0);
+        assert(polls_in_100ms(&loop) < 20);
+        conn->connect_destroyed();
+        ::close(bad);
+        ::close(peer);
+    }
+
+    // an empty pipe parks the socket until the pipe has data
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        int pipefd[2];
+        assert(::pipe(pipefd) == 0);
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) { loop.quit(); });
+        conn->send_file(pipefd[0], 0, 5);
+        ::close(pipefd[0]);
+        assert(polls_in_100ms(&loop) < 20);
+        assert(conn->queued_output_bytes() == 5);
+
+        assert(::write(pipefd[1], "later", 5) == 5);
+        loop.loop();
+        assert(read_exactly(peer, 5) == "later");
+        assert(conn->queued_output_bytes() == 0);
+        conn->connect_destroyed();
+        ::close(pipefd[1]);
+        ::close(peer);
+    }
+
+    ::close(file);
+    return 0;
+}
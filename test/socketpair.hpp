@@ -0,0 +1,60 @@
+#ifndef TEST_SOCKETPAIR_HPP
+#define TEST_SOCKETPAIR_HPP
+
+#include <string>
+#include <future>
+#include <memory>
+#include <cassert>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/inetaddress.hpp"
+#include "../icarus/tcpconnection.hpp"
+
+// helpers of the testers which drive a TcpConnection over a unix
+//  socket pair, unlike common.hpp this one does not define main
+
+// an established connection over one end of a non-blocking unix socket
+//  pair, the other end is stored in peer. must run in the loop thread
+inline icarus::TcpConnectionPtr connected_pair(icarus::EventLoop *loop, int *peer)
+{
+    int sv[2];
+    int ret = ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+    assert(ret == 0);
+    (void) ret;
+    auto conn = std::make_shared<icarus::TcpConnection>(loop, "pair", sv[0], icarus::InetAddress(),
+                                                        icarus::InetAddress());
+    conn->set_connection_callback([] (const icarus::TcpConnectionPtr &) {});
+    conn->connect_established();
+    *peer = sv[1];
+    return conn;
+}
+
+// reads exactly len bytes from a blocking fd
+inline std::string read_exactly(int fd, std::size_t len)
+{
+    std::string data(len, '\0');
+    std::size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = ::read(fd, &data[got], len - got);
+        assert(n > 0);
+        got += n;
+    }
+    return data;
+}
+
+// runs f in the loop and waits for it, also for everything queued before
+template <typename F>
+void in_loop(icarus::EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->queue_in_loop([&] {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+#endif // TEST_SOCKETPAIR_HPP
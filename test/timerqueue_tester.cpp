@@ -0,0 +1,42 @@
+#include <chrono>
+#include <vector>
+#include <cassert>
+
+#include "../icarus/eventloop.hpp"
+
+using namespace std;
+using namespace icarus;
+
+int main()
+{
+    EventLoop loop;
+    vector<int> fired;
+    int ticks = 0;
+
+    loop.run_after(chrono::milliseconds(30), [&] { fired.push_back(30); });
+    loop.run_after(chrono::milliseconds(10), [&] { fired.push_back(10); });
+    loop.run_after(chrono::milliseconds(100), [&] { fired.push_back(100); });
+    loop.run_after(chrono::milliseconds(5000), [&] { fired.push_back(5000); });
+
+    auto cancelled = loop.run_after(chrono::milliseconds(20), [&] { fired.push_back(20); });
+    loop.cancel(cancelled);
+
+    TimerId every;
+    every = loop.run_every(chrono::milliseconds(15), [&] {
+        if (++ticks == 3)
+        {
+            loop.cancel(every);
+        }
+    });
+
+    // timer added from another thread
+    std::thread([&] {
+        loop.run_after(chrono::milliseconds(50), [&] { fired.push_back(50); });
+    }).join();
+
+    loop.run_after(chrono::milliseconds(200), [&] { loop.quit(); });
+    loop.loop();
+
+    assert((fired == vector<int>{ 10, 30, 50, 100 }));
+    assert(ticks == 3);
+}
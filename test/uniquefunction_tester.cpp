@@ -0,0 +1,196 @@
+#include <memory>
+#include <string>
+#include <utility>
+#include <cassert>
+#include <functional>
+
+#include "../icarus/uniquefunction.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+using Where = UniqueFunction<const void *()>;
+
+// a callable of exactly Size bytes which tells where it lives
+template <size_t Size>
+struct Sized
+{
+    const void *operator()() const
+    {
+        return this;
+    }
+
+    char pad[Size];
+};
+
+// small, but a throwing move cannot be done in place
+struct ThrowingMove
+{
+    ThrowingMove() = default;
+    ThrowingMove(ThrowingMove &&) noexcept(false)
+    {
+    }
+
+    const void *operator()() const
+    {
+        return this;
+    }
+};
+
+bool stored_inline(const Where &f)
+{
+    auto at = static_cast<const char *>(f());
+    auto begin = reinterpret_cast<const char *>(&f);
+    return at >= begin && at < begin + sizeof f;
+}
+
+// counts the objects alive, and the destructions of objects not moved from
+struct Tracked
+{
+    static int alive;
+    static int destroyed;
+
+    Tracked()
+    {
+        ++alive;
+    }
+
+    Tracked(Tracked &&other) noexcept
+      : moved_from(false)
+    {
+        other.moved_from = true;
+        ++alive;
+    }
+
+    ~Tracked()
+    {
+        --alive;
+        if (!moved_from)
+        {
+            ++destroyed;
+        }
+    }
+
+    int operator()(int x) const
+    {
+        return x + 1;
+    }
+
+    bool moved_from = false;
+};
+
+int Tracked::alive = 0;
+int Tracked::destroyed = 0;
+
+struct BigTracked : Tracked
+{
+    char pad[128];
+};
+} // namespace
+
+int main()
+{
+    // inline up to 64 bytes, boxed from 65 on
+    {
+        static_assert(sizeof(Sized<64>) == 64 && sizeof(Sized<65>) == 65);
+        Where small = Sized<8>();
+        Where edge = Sized<64>();
+        Where over = Sized<65>();
+        assert(stored_inline(small));
+        assert(stored_inline(edge));
+        assert(!stored_inline(over));
+
+        // inline callables move with the object, boxed ones stay put
+        const void *boxed_at = over();
+        Where moved_edge = std::move(edge);
+        Where moved_over = std::move(over);
+        assert(stored_inline(moved_edge));
+        assert(moved_over() == boxed_at);
+    }
+
+    // a callable which may throw while moving goes to the heap
+    {
+        static_assert(sizeof(ThrowingMove) <= 64);
+        Where f = ThrowingMove();
+        assert(!stored_inline(f));
+    }
+
+    // move-only captures
+    {
+        auto p = make_unique<string>("move only");
+        UniqueFunction<string()> f = [p = std::move(p)] { return *p; };
+        assert(f() == "move only");
+        UniqueFunction<string()> g = std::move(f);
+        assert(g() == "move only");
+
+        auto big = make_unique<string>("boxed");
+        char pad[100] = {};
+        UniqueFunction<string()> h = [big = std::move(big), pad] { return *big + pad; };
+        assert(h() == "boxed");
+    }
+
+    // moved from is empty, calling an empty one throws
+    {
+        UniqueFunction<int(int)> f = [] (int x) { return x * 2; };
+        UniqueFunction<int(int)> g = std::move(f);
+        assert(!f);
+        assert(g && g(21) == 42);
+
+        UniqueFunction<int(int)> h;
+        h = std::move(g);
+        assert(!g);
+        assert(h(4) == 8);
+
+        bool threw = false;
+        try
+        {
+            g(1);
+        }
+        catch (const bad_function_call &)
+        {
+            threw = true;
+        }
+        assert(threw);
+
+        int (*none)(int) = nullptr;
+        UniqueFunction<int(int)> from_null = none;
+        assert(!from_null);
+    }
+
+    // every stored callable is destroyed exactly once, inline and boxed,
+    //  through moves, assignments and resets
+    {
+        {
+            UniqueFunction<int(int)> a = Tracked();
+            UniqueFunction<int(int)> b = BigTracked();
+            assert(Tracked::alive == 2);
+            assert(Tracked::destroyed == 0);
+            assert(a(1) == 2 && b(2) == 3);
+
+            UniqueFunction<int(int)> c = std::move(a);
+            UniqueFunction<int(int)> d = std::move(b);
+            assert(Tracked::alive == 2);
+            assert(Tracked::destroyed == 0);
+
+            // the callable held before is destroyed by the assignment
+            c = std::move(d);
+            assert(Tracked::alive == 1);
+            assert(Tracked::destroyed == 1);
+
+            c = nullptr;
+            assert(Tracked::alive == 0);
+            assert(Tracked::destroyed == 2);
+
+            c = Tracked();
+            d = BigTracked();
+            assert(Tracked::alive == 2);
+            assert(Tracked::destroyed == 2);
+        }
+        assert(Tracked::alive == 0);
+        assert(Tracked::destroyed == 4);
+    }
+
+    return 0;
+}
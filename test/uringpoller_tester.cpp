@@ -0,0 +1,217 @@
+#include <string>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cassert>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../icarus/channel.hpp"
+#include "../icarus/poller.hpp"
+#include "../icarus/eventloop.hpp"
+#include "../icarus/uringpoller.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+void write_bytes(int fd, size_t len)
+{
+    string data(len, 'u');
+    ssize_t n = ::write(fd, data.data(), len);
+    assert(n == static_cast<ssize_t>(len));
+    (void) n;
+}
+
+size_t read_some(int fd, size_t len)
+{
+    char buf[4096];
+    ssize_t n = ::read(fd, buf, min(len, sizeof buf));
+    assert(n > 0);
+    return static_cast<size_t>(n);
+}
+
+// gives the loop a few iterations to deliver anything still on its way
+void settle(EventLoop *loop)
+{
+    loop->run_after(chrono::milliseconds(50), [loop] { loop->quit(); });
+    loop->loop();
+}
+} // namespace
+
+int main()
+{
+    // io_uring falls back to epoll when the kernel lacks support
+    {
+        EventLoop loop(PollerBackend::kIoUring);
+        auto expected = UringPoller::supported() ? PollerBackend::kIoUring : PollerBackend::kEpoll;
+        assert(loop.poller_backend() == expected);
+        assert(Poller::new_poller(&loop, PollerBackend::kIoUring)->backend() == expected);
+        if (!UringPoller::supported())
+        {
+            return 0;
+        }
+    }
+
+    EventLoop loop(PollerBackend::kIoUring);
+
+    // a level-triggered channel reading a byte at a time is woken for
+    //  every byte, its one-shot poll armed again after each completion
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+        Channel channel(&loop, sv[0]);
+        int reads = 0;
+        channel.set_read_callback([&] {
+            read_some(sv[0], 1);
+            if (++reads == 5)
+            {
+                loop.quit();
+            }
+        });
+        channel.enable_reading();
+        write_bytes(sv[1], 5);
+        loop.loop();
+        assert(reads == 5);
+
+        channel.disable_all();
+        channel.remove();
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // an edge-triggered channel is woken once per write, its multishot
+    //  poll stays armed across the wakeups
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+        Channel channel(&loop, sv[0]);
+        channel.set_edge_triggered(true);
+        int wakeups = 0;
+        channel.set_read_callback([&] {
+            assert(read_some(sv[0], 4096) == 100);
+            if (++wakeups == 5)
+            {
+                loop.quit();
+            }
+            else
+            {
+                write_bytes(sv[1], 100);
+            }
+        });
+        channel.enable_reading();
+        write_bytes(sv[1], 100);
+        loop.loop();
+        assert(wakeups == 5);
+
+        // not drained, no new edge, no wakeup
+        write_bytes(sv[1], 10);
+        channel.set_read_callback([&] {
+            read_some(sv[0], 1);
+            ++wakeups;
+        });
+        settle(&loop);
+        assert(wakeups == 6);
+
+        channel.disable_all();
+        channel.remove();
+        ::close(sv[0]);
+        ::close(sv[1]);
+    }
+
+    // a completion of a removed channel does not reach the next channel
+    //  on the same fd, the generation tells them apart
+    {
+        int sv[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+        auto old_channel = make_unique<Channel>(&loop, sv[0]);
+        bool old_read = false;
+        old_channel->set_read_callback([&] { old_read = true; });
+        old_channel->enable_reading();
+        settle(&loop);
+
+        unique_ptr<Channel> new_channel;
+        int reused[2];
+        bool new_read = false;
+        loop.queue_in_loop([&] {
+            // completes the armed poll, its completion waits in the ring
+            write_bytes(sv[1], 1);
+            old_channel->disable_all();
+            old_channel->remove();
+            old_channel.reset();
+            ::close(sv[0]);
+            ::close(sv[1]);
+
+            ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, reused);
+            assert(reused[0] == sv[0]);
+            new_channel = make_unique<Channel>(&loop, reused[0]);
+            new_channel->set_read_callback([&] {
+                read_some(reused[0], 1);
+                new_read = true;
+                loop.quit();
+            });
+            new_channel->enable_reading();
+        });
+        settle(&loop);
+        assert(!old_read);
+        assert(!new_read);
+
+        write_bytes(reused[1], 1);
+        loop.loop();
+        assert(new_read);
+
+        new_channel->disable_all();
+        new_channel->remove();
+        ::close(reused[0]);
+        ::close(reused[1]);
+    }
+
+    // more channels armed in one iteration than the submission queue
+    //  holds, none of the requests is lost
+    {
+        const int kPairs = 700;
+        vector<int> fds;
+        vector<unique_ptr<Channel>> channels;
+        int reads = 0;
+        for (int i = 0; i < kPairs; ++i)
+        {
+            int sv[2];
+            ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv);
+            fds.push_back(sv[0]);
+            fds.push_back(sv[1]);
+        }
+        loop.queue_in_loop([&] {
+            for (int fd : fds)
+            {
+                channels.push_back(make_unique<Channel>(&loop, fd));
+                channels.back()->set_read_callback([&, fd] {
+                    read_some(fd, 1);
+                    if (++reads == 2 * kPairs)
+                    {
+                        loop.quit();
+                    }
+                });
+                channels.back()->enable_reading();
+            }
+            for (int fd : fds)
+            {
+                write_bytes(fd, 1);
+            }
+        });
+        loop.loop();
+        assert(reads == 2 * kPairs);
+
+        for (auto &channel : channels)
+        {
+            channel->disable_all();
+            channel->remove();
+        }
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+    }
+
+    return 0;
+}
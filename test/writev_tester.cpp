@@ -0,0 +1,130 @@
+#include <string>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "../icarus/eventloop.hpp"
+#include "../icarus/eventloopthread.hpp"
+#include "../icarus/tcpconnection.hpp"
+#include "socketpair.hpp"
+
+using namespace std;
+using namespace icarus;
+
+namespace
+{
+vector<struct iovec> fragments_of(const vector<string> &parts)
+{
+    vector<struct iovec> iov;
+    for (const auto &part : parts)
+    {
+        iov.push_back({const_cast<char *>(part.data()), part.size()});
+    }
+    return iov;
+}
+
+string joined(const vector<string> &parts)
+{
+    string all;
+    for (const auto &part : parts)
+    {
+        all += part;
+    }
+    return all;
+}
+} // namespace
+
+int main()
+{
+    EventLoop loop;
+
+    // fragments that fit go out with the one writev, nothing is queued
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+        bool completed = false;
+        conn->set_write_complete_callback([&] (const TcpConnectionPtr &) {
+            completed = true;
+            loop.quit();
+        });
+
+        vector<string> parts = {"HTTP/1.1 200 OK\r\n", "Content-Length: 5\r\n\r\n", "", "hello"};
+        auto iov = fragments_of(parts);
+        conn->send(iov);
+        loop.loop();
+        assert(completed);
+        assert(read_exactly(peer, joined(parts).size()) == joined(parts));
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // what the socket does not take is queued from the fragment the
+    //  write stopped in, later sends follow it
+    {
+        int peer;
+        auto conn = connected_pair(&loop, &peer);
+
+        vector<string> parts;
+        for (int i = 0; i < 8; ++i)
+        {
+            parts.push_back(string(100000 + i, static_cast<char>('a' + i)));
+        }
+        auto iov = fragments_of(parts);
+        conn->send(iov);
+        conn->send("after");
+        // queued behind the output buffer this time
+        vector<string> more = {"x", "yz"};
+        auto more_iov = fragments_of(more);
+        conn->send(more_iov);
+
+        string expected = joined(parts) + "after" + joined(more);
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        string received;
+        thread reader([&] {
+            received = read_exactly(peer, expected.size());
+            loop.quit();
+        });
+        loop.loop();
+        reader.join();
+        assert(received == expected);
+        conn->connect_destroyed();
+        ::close(peer);
+    }
+
+    // from another thread the fragments are joined into one message
+    {
+        EventLoopThread io_thread;
+        EventLoop *io_loop = io_thread.start_loop();
+        TcpConnectionPtr conn;
+        int peer;
+        in_loop(io_loop, [&] {
+            conn = connected_pair(io_loop, &peer);
+        });
+
+        vector<string> parts = {"one ", "two ", "three"};
+        auto iov = fragments_of(parts);
+        conn->send(iov);
+        parts.clear();
+        ::fcntl(peer, F_SETFL, ::fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+        assert(read_exactly(peer, 13) == "one two three");
+
+        // larger than the socket buffer, the rest waits in the joined copy
+        vector<string> large = {string(600000, 'l'), "|", string(600000, 'r')};
+        auto large_iov = fragments_of(large);
+        conn->send(large_iov);
+        conn->send("end");
+        assert(read_exactly(peer, 1200004) == joined(large) + "end");
+        in_loop(io_loop, [&] {
+            assert(conn->queued_output_bytes() == 0);
+            conn->connect_destroyed();
+            conn.reset();
+        });
+        ::close(peer);
+    }
+
+    return 0;
+}